@@ -1,5 +1,8 @@
 package com.techsoft3d.hps.sandbox;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
 import android.content.Context;
 import android.os.Handler;
 import android.os.Looper;
@@ -24,15 +27,14 @@ import android.widget.EditText;
  */
 public class AndroidMobileSurfaceView extends SurfaceView implements SurfaceHolder.Callback {
 	
-	public static native long create(AndroidMobileSurfaceView view, int surfaceId);
+	public static native long create(AndroidMobileSurfaceView view, int surfaceId, long savedSurfacePointer);
 	public static native void onTextInputJS(long ptr, String text);
 	public static native void onKeyboardHiddenJ(long ptr);
 	public static native boolean bind(long ptr, Object context, Object surface);
 	public static native void release(long ptr, int flags);
 	public static native void refresh(long ptr);
-	public static native void touchDown(long ptr, int numTouches, int[] xArray, int[] yArray, long[] posArray);
-	public static native void touchMove(long ptr, int numTouches, int[] xArray, int[] yArray, long[] posArray);
-	public static native void touchUp(long ptr, int numTouches, int[] xArray, int[] yArray, long[] posArray);
+	public static native void setTouchRing(long ptr, ByteBuffer ring);
+	public static native void touchSamples(long ptr, int first, int count);
 	public static native void touchesCancel(long ptr);
 	public static native void singleTap(long ptr, int x, int y);
 	public static native void doubleTap(long ptr, int x, int y, long id);
@@ -43,11 +45,66 @@ public class AndroidMobileSurfaceView extends SurfaceView implements SurfaceHold
 	// Surface id integer seen by C++ code
 	private int mGuiSurfaceId;
 	
-	// Pointer to UserMobileSurface instance associated with this SurfaceView
+	// Handle of the UserMobileSurface instance associated with this SurfaceView (see shared/SurfaceRegistry.h).
+	// It is 0 between surfaceDestroyed() and the next surfaceCreated(), while native code has no surface for us.
 	protected long mSurfacePointer;
 
+	// Touch samples ring shared with native code.  Layout of each sample mirrors TouchSample in shared/TouchRing.h
+	private static final int TOUCH_DOWN = 0;
+	private static final int TOUCH_MOVE = 1;
+	private static final int TOUCH_UP = 2;
+	private static final int TOUCH_CANCEL = 3;
+	private static final int TOUCH_MAX_POINTERS = 10;
+	private static final int TOUCH_SAMPLE_BYTES = 176;
+	private static final int TOUCH_TIME_OFFSET = 0;
+	private static final int TOUCH_ACTION_OFFSET = 8;
+	private static final int TOUCH_COUNT_OFFSET = 12;
+	private static final int TOUCH_X_OFFSET = 16;
+	private static final int TOUCH_Y_OFFSET = 56;
+	private static final int TOUCH_ID_OFFSET = 96;
+	private static final int TOUCH_RING_SAMPLES = 64;
+
+	// Layout of the selection written by getSelection() into a direct ByteBuffer (native order).
+	// Mirrors SelectionBufferHeader and SelectionRecord in shared/SelectionBuffer.h: a header, then
+	// SELECTION_RECORD_BYTES per item, then the int sub-entity indices of all items.
+	public static final int SELECTION_HEADER_BYTES = 16;
+	public static final int SELECTION_COUNT_OFFSET = 0;
+	public static final int SELECTION_TOTAL_OFFSET = 4;
+	public static final int SELECTION_INDEX_COUNT_OFFSET = 8;
+	public static final int SELECTION_RECORD_BYTES = 48;
+	public static final int SELECTION_KEY_OFFSET = 0;
+	public static final int SELECTION_COMPONENT_OFFSET = 8;
+	public static final int SELECTION_POSITION_OFFSET = 16;
+	public static final int SELECTION_LEVEL_OFFSET = 28;
+	public static final int SELECTION_INDEX_OFFSET = 32;
+	public static final int SELECTION_FACE_COUNT_OFFSET = 36;
+	public static final int SELECTION_VERTEX_COUNT_OFFSET = 40;
+	public static final int SELECTION_EDGE_COUNT_OFFSET = 44;
+
+	// Layout of the volume set written by getVolumeSet() into a direct ByteBuffer (native order).
+	// Mirrors VolumeBufferHeader and VolumeRecord in shared/VolumeQuery.h: a header, then
+	// VOLUME_RECORD_BYTES per item.
+	public static final int VOLUME_HEADER_BYTES = 16;
+	public static final int VOLUME_COUNT_OFFSET = 0;
+	public static final int VOLUME_TOTAL_OFFSET = 4;
+	public static final int VOLUME_RECORD_BYTES = 24;
+	public static final int VOLUME_KEY_OFFSET = 0;
+	public static final int VOLUME_INCLUDE_OFFSET = 8;
+	public static final int VOLUME_COMPONENT_OFFSET = 16;
+
+	// Measurement modes of setOperatorMeasure() and onMeasurementCompleted(), as in Measurement.h
+	public static final int MEASURE_POINT_TO_POINT = 0;
+	public static final int MEASURE_EDGE_LENGTH = 1;
+	public static final int MEASURE_FACE_TO_FACE = 2;
+	public static final int MEASURE_ANGLE = 3;
+	public static final int MEASURE_MODE_COUNT = 4;
+
+	private ByteBuffer mTouchRing;
+	private int mTouchRingHead;
+
 	private GestureDetector mGestureDetector;
 	private AndroidMobileSurfaceView.Callback mSurfaceViewCallback;
+	private final Handler mMainHandler = new Handler(Looper.getMainLooper());
 
 	public void onTextInput(String text)
 	{
@@ -65,6 +122,22 @@ public class AndroidMobileSurfaceView extends SurfaceView implements SurfaceHold
 		public void onShowKeyboard();
 		public void eraseKeyboardTriggerField();
 		public void onShowPerformanceTestResult(float fps);
+		// Called on the UI thread when an <action>Async() call has run.  result is the action's
+		// return value as a double: booleans are 1 or 0, void actions give 0, and NaN means the
+		// surface was destroyed before the action could run.
+		public void onActionCompleted(int requestId, double result);
+		// Called on the UI thread when a selection has been highlighted.  latencyMs runs from the
+		// request to the highlight; selections overtaken by a newer one are not reported.
+		public void onSelectionCompleted(int requestId, int count, float latencyMs);
+		// Called on the UI thread as a clash detection progresses: once when it starts, with
+		// tested 0, then as each batch of pairs has been tested and its clashes highlighted.
+		public void onClashProgress(int tested, int total, int clashes);
+		// Called on the UI thread when a measurement has been taken.  mode is one of the MEASURE_*
+		// constants; value is a distance in model units, or an angle in degrees.
+		public void onMeasurementCompleted(int mode, float value);
+		// Called on the UI thread when measureSelectionClearance() is done, with the minimum distance
+		// in model units, or a negative value if it could not be computed.
+		public void onClearanceCompleted(float distance);
 	}
 
 	// Constructor should only be called by derived class
@@ -81,6 +154,56 @@ public class AndroidMobileSurfaceView extends SurfaceView implements SurfaceHold
 	{
 		mSurfaceViewCallback.onShowPerformanceTestResult(fps);
 	}
+
+	// Called by native code on the action executor thread
+	public void onAsyncActionCompleted(final int requestId, final double result)
+	{
+		mMainHandler.post(new Runnable() {
+			public void run() {
+				mSurfaceViewCallback.onActionCompleted(requestId, result);
+			}
+		});
+	}
+
+	// Called by native code on a selection worker thread
+	public void onSelectionCompleted(final int requestId, final int count, final float latencyMs)
+	{
+		mMainHandler.post(new Runnable() {
+			public void run() {
+				mSurfaceViewCallback.onSelectionCompleted(requestId, count, latencyMs);
+			}
+		});
+	}
+
+	// Called by native code on a clash detection worker thread
+	public void onClashProgress(final int tested, final int total, final int clashes)
+	{
+		mMainHandler.post(new Runnable() {
+			public void run() {
+				mSurfaceViewCallback.onClashProgress(tested, total, clashes);
+			}
+		});
+	}
+
+	// Called by native code on the HPS event thread
+	public void onMeasurementCompleted(final int mode, final float value)
+	{
+		mMainHandler.post(new Runnable() {
+			public void run() {
+				mSurfaceViewCallback.onMeasurementCompleted(mode, value);
+			}
+		});
+	}
+
+	// Called by native code on a worker thread
+	public void onClearanceCompleted(final float distance)
+	{
+		mMainHandler.post(new Runnable() {
+			public void run() {
+				mSurfaceViewCallback.onClearanceCompleted(distance);
+			}
+		});
+	}
 	
 	// Constructor should only be called by derived class
 	protected AndroidMobileSurfaceView(Context context, AndroidMobileSurfaceView.Callback svcb, int guiSurfaceId, long savedSurfacePointer) {
@@ -88,15 +211,19 @@ public class AndroidMobileSurfaceView extends SurfaceView implements SurfaceHold
 
 		mGuiSurfaceId = guiSurfaceId;
 		
-		if (savedSurfacePointer != 0)
-			mSurfacePointer = savedSurfacePointer;
-		else
-			mSurfacePointer = create(this,mGuiSurfaceId);
-		
 		mSurfaceViewCallback = svcb;
 		getHolder().addCallback(this);
 		
 		mGestureDetector = new GestureDetector(context, new CustomGestureDetector());
+
+		mTouchRing = ByteBuffer.allocateDirect(TOUCH_RING_SAMPLES * TOUCH_SAMPLE_BYTES).order(ByteOrder.nativeOrder());
+		createSurface(savedSurfacePointer);
+	}
+
+	// Reuses the saved surface if native code still has it (after a rotation), else creates a new one
+	private void createSurface(long savedSurfacePointer) {
+		mSurfacePointer = create(this, mGuiSurfaceId, savedSurfacePointer);
+		setTouchRing(mSurfacePointer, mTouchRing);
 	}
 
 	public int getGuiSurfaceId() {
@@ -116,6 +243,9 @@ public class AndroidMobileSurfaceView extends SurfaceView implements SurfaceHold
 		
 		Display display = ((WindowManager) getContext().getSystemService(Context.WINDOW_SERVICE)).getDefaultDisplay();
 		lastRotation = display.getRotation ();
+
+		if (mSurfacePointer == 0)
+			createSurface(0);
 		
 		boolean ret = bind(mSurfacePointer, getContext(), getHolder().getSurface());
 		if (mSurfaceViewCallback != null)
@@ -138,6 +268,10 @@ public class AndroidMobileSurfaceView extends SurfaceView implements SurfaceHold
 			flags |= SCREEN_ROTATING;
 		
 		release(mSurfacePointer, flags);
+
+		// Native code destroys the surface unless rotating
+		if ((flags & SCREEN_ROTATING) == 0)
+			mSurfacePointer = 0;
 		
 		lastRotation = rotation;
 	}
@@ -149,60 +283,26 @@ public class AndroidMobileSurfaceView extends SurfaceView implements SurfaceHold
 			return true;
 		
 		final int action = e.getActionMasked();
-		
-		// Only track multiple move changes.  Each separate touch up/down gets its own action.
-		int pointerCount = 1;
-		if (action == MotionEvent.ACTION_MOVE) {
-			pointerCount = e.getPointerCount();
-		}
 
-		int[] xposArray = new int[pointerCount];
-		int[] yposArray = new int[pointerCount];
-		long[] idArray = new long[pointerCount];
-		
+		// MotionEvent time (uptimeMillis, i.e. CLOCK_MONOTONIC) in microseconds, used by native code to measure touch latency
+		final long eventTime = e.getEventTime() * 1000;
+
 		switch (action) {
-		case MotionEvent.ACTION_DOWN: {
-			// Single touch down
-			xposArray[0] = (int) e.getX();
-			yposArray[0] = (int) e.getY();
-			idArray[0] = e.getPointerId(0);
-			touchDown(mSurfacePointer, pointerCount, xposArray, yposArray, idArray);
-			break;
-		}
-		case MotionEvent.ACTION_UP: {
-			// Last touch went up
-			xposArray[0] = (int) e.getX();
-			yposArray[0] = (int) e.getY();
-			idArray[0] = e.getPointerId(0);
-			touchUp(mSurfacePointer, pointerCount, xposArray, yposArray, idArray);
-			break;
-		}
+		case MotionEvent.ACTION_DOWN:
 		case MotionEvent.ACTION_POINTER_DOWN: {
-			// Additional touch down
-			final int index = e.getActionIndex();
-			xposArray[0] = (int) e.getX(index);
-			yposArray[0] = (int) e.getY(index);
-			idArray[0] = e.getPointerId(index);
-			touchDown(mSurfacePointer, pointerCount, xposArray, yposArray, idArray);
+			// A touch went down; each one gets its own action
+			sendTouchSample(TOUCH_DOWN, e, e.getActionIndex(), eventTime);
 			break;
 		}
+		case MotionEvent.ACTION_UP:
 		case MotionEvent.ACTION_POINTER_UP: {
-			// Touch went up, but not last
-			final int index = e.getActionIndex();
-			xposArray[0] = (int) e.getX(index);
-			yposArray[0] = (int) e.getY(index);
-			idArray[0] = e.getPointerId(index);
-			touchUp(mSurfacePointer, pointerCount, xposArray, yposArray, idArray);
+			// A touch went up; each one gets its own action
+			sendTouchSample(TOUCH_UP, e, e.getActionIndex(), eventTime);
 			break;
 		}
 		case MotionEvent.ACTION_MOVE: {
-			// Multiple touches move
-			for (int i=0; i<pointerCount; i++) {
-				xposArray[i] = (int)e.getX(i);
-				yposArray[i] = (int)e.getY(i);
-				idArray[i] 	 = e.getPointerId(i);	
-			}
-			touchMove(mSurfacePointer, pointerCount, xposArray, yposArray, idArray);
+			// Multiple touches move, with the samples batched since the previous event
+			sendTouchMoves(e);
 			break;
 		}
 		case MotionEvent.ACTION_CANCEL: {
@@ -216,6 +316,50 @@ public class AndroidMobileSurfaceView extends SurfaceView implements SurfaceHold
 		return true;
 	}
 
+	// Writes one sample into the next ring slot and hands its index to native code.
+	// pointerIndex is the pointer that changed, or -1 for all of them.
+	private void sendTouchSample(int action, MotionEvent e, int pointerIndex, long eventTime) {
+		final int slot = mTouchRingHead;
+		writeTouchSample(action, e, pointerIndex, -1, eventTime);
+		touchSamples(mSurfacePointer, slot, 1);
+	}
+
+	// Android batches the samples received since the last frame into one ACTION_MOVE.  They are all
+	// written to the ring, oldest first, and sent in a single call so the camera follows every one.
+	private void sendTouchMoves(MotionEvent e) {
+		final int first = mTouchRingHead;
+
+		// Keep the newest samples if the batch does not fit in the ring
+		final int historySize = e.getHistorySize();
+		final int firstHistory = Math.max(0, historySize - (TOUCH_RING_SAMPLES - 1));
+		for (int h = firstHistory; h < historySize; h++)
+			writeTouchSample(TOUCH_MOVE, e, -1, h, e.getHistoricalEventTime(h) * 1000);
+		writeTouchSample(TOUCH_MOVE, e, -1, -1, e.getEventTime() * 1000);
+
+		touchSamples(mSurfacePointer, first, historySize - firstHistory + 1);
+	}
+
+	// historyIndex selects a historical sample of the event, -1 for the current one
+	private void writeTouchSample(int action, MotionEvent e, int pointerIndex, int historyIndex, long eventTime) {
+		final int base = mTouchRingHead * TOUCH_SAMPLE_BYTES;
+		mTouchRingHead = (mTouchRingHead + 1) % TOUCH_RING_SAMPLES;
+
+		final int first = pointerIndex < 0 ? 0 : pointerIndex;
+		final int count = pointerIndex < 0 ? Math.min(e.getPointerCount(), TOUCH_MAX_POINTERS) : 1;
+
+		mTouchRing.putLong(base + TOUCH_TIME_OFFSET, eventTime);
+		mTouchRing.putInt(base + TOUCH_ACTION_OFFSET, action);
+		mTouchRing.putInt(base + TOUCH_COUNT_OFFSET, count);
+		for (int i = 0; i < count; i++) {
+			final int p = first + i;
+			final float x = historyIndex < 0 ? e.getX(p) : e.getHistoricalX(p, historyIndex);
+			final float y = historyIndex < 0 ? e.getY(p) : e.getHistoricalY(p, historyIndex);
+			mTouchRing.putInt(base + TOUCH_X_OFFSET + 4 * i, (int) x);
+			mTouchRing.putInt(base + TOUCH_Y_OFFSET + 4 * i, (int) y);
+			mTouchRing.putLong(base + TOUCH_ID_OFFSET + 8 * i, e.getPointerId(p));
+		}
+	}
+
 	private class CustomGestureDetector extends GestureDetector.SimpleOnGestureListener {
 		@Override
 		public boolean onDoubleTap(MotionEvent e) {
@@ -2,23 +2,94 @@ package com.techsoft3d.hps.sandbox;
 
 // Auto-generated file
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.charset.Charset;
+
 import android.content.Context;
 
 public class AndroidUserMobileSurfaceView extends AndroidMobileSurfaceView {
 	private static native boolean loadFileS(long ptr, String fileName);
+	private static native boolean generateSceneIIIFIFI(long ptr, int segmentCount, int shellCount, int triangleCount, float instanceRatio, int materialCount, float dispersion, int seed);
 	private static native void setOperatorOrbitV(long ptr);
 	private static native void setOperatorZoomAreaV(long ptr);
 	private static native void setOperatorFlyV(long ptr);
 	private static native void setOperatorSelectPointV(long ptr);
 	private static native void setOperatorSelectAreaV(long ptr);
+	private static native void setOperatorSelectLassoV(long ptr);
+	private static native void setOperatorPreselectV(long ptr);
+	private static native void setOperatorMeasureI(long ptr, int mode);
+	private static native void clearMeasurementsV(long ptr);
+	private static native boolean measureSelectionClearanceV(long ptr);
+	private static native void cancelClearanceV(long ptr);
 	private static native void onModeSimpleShadowZ(long ptr, boolean enable);
 	private static native void onModeSmoothV(long ptr);
 	private static native void onModeHiddenLineV(long ptr);
 	private static native void onModeFrameRateV(long ptr);
+	private static native void onModePerformanceHUDV(long ptr);
+	private static native int getSelectionBB(long ptr, ByteBuffer buffer);
+	private static native int highlightSegmentsNamedSI(long ptr, String name, int style);
+	private static native void unhighlightStyleI(long ptr, int style);
+	private static native void unhighlightAllV(long ptr);
+	private static native void setHighlightColorIFFF(long ptr, int style, float r, float g, float b);
+	private static native int detectClashesSSFI(long ptr, String groupA, String groupB, float tolerance, int style);
+	private static native void cancelClashesV(long ptr);
+	private static native int queryBoxFFFFFFZZ(long ptr, float minX, float minY, float minZ, float maxX, float maxY, float maxZ, boolean contained, boolean exact);
+	private static native int queryWindowFrustumFFFFZ(long ptr, float left, float bottom, float right, float top, boolean contained);
+	private static native int getVolumeSetBB(long ptr, ByteBuffer buffer);
+	private static native int hideOutsideVolumeSetV(long ptr);
+	private static native void showAllItemsV(long ptr);
+	private static native int highlightVolumeSetI(long ptr, int style);
+	private static native int getTouchLatencySFA(long ptr, String operatorName, float[] stats);
+	private static native void resetTouchLatencyV(long ptr);
+	private static native int getSelectionLatencyFA(long ptr, float[] stats);
+	private static native void resetSelectionLatencyV(long ptr);
+	private static native void startTouchRecordingV(long ptr);
+	private static native boolean stopTouchRecordingS(long ptr, String fileName);
+	private static native int getReplayStatsFA(long ptr, float[] stats);
 	private static native void onUserCode1V(long ptr);
 	private static native void onUserCode2V(long ptr);
 	private static native void onUserCode3V(long ptr);
 	private static native void onUserCode4V(long ptr);
+	private static native int loadFileSAsync(long ptr, String fileName);
+	private static native int generateSceneIIIFIFIAsync(long ptr, int segmentCount, int shellCount, int triangleCount, float instanceRatio, int materialCount, float dispersion, int seed);
+	private static native int setOperatorOrbitVAsync(long ptr);
+	private static native int setOperatorZoomAreaVAsync(long ptr);
+	private static native int setOperatorFlyVAsync(long ptr);
+	private static native int setOperatorSelectPointVAsync(long ptr);
+	private static native int setOperatorSelectAreaVAsync(long ptr);
+	private static native int setOperatorSelectLassoVAsync(long ptr);
+	private static native int setOperatorPreselectVAsync(long ptr);
+	private static native int setOperatorMeasureIAsync(long ptr, int mode);
+	private static native int clearMeasurementsVAsync(long ptr);
+	private static native int measureSelectionClearanceVAsync(long ptr);
+	private static native int cancelClearanceVAsync(long ptr);
+	private static native int onModeSimpleShadowZAsync(long ptr, boolean enable);
+	private static native int onModeSmoothVAsync(long ptr);
+	private static native int onModeHiddenLineVAsync(long ptr);
+	private static native int onModeFrameRateVAsync(long ptr);
+	private static native int onModePerformanceHUDVAsync(long ptr);
+	private static native int highlightSegmentsNamedSIAsync(long ptr, String name, int style);
+	private static native int unhighlightStyleIAsync(long ptr, int style);
+	private static native int unhighlightAllVAsync(long ptr);
+	private static native int setHighlightColorIFFFAsync(long ptr, int style, float r, float g, float b);
+	private static native int detectClashesSSFIAsync(long ptr, String groupA, String groupB, float tolerance, int style);
+	private static native int cancelClashesVAsync(long ptr);
+	private static native int queryBoxFFFFFFZZAsync(long ptr, float minX, float minY, float minZ, float maxX, float maxY, float maxZ, boolean contained, boolean exact);
+	private static native int queryWindowFrustumFFFFZAsync(long ptr, float left, float bottom, float right, float top, boolean contained);
+	private static native int hideOutsideVolumeSetVAsync(long ptr);
+	private static native int showAllItemsVAsync(long ptr);
+	private static native int highlightVolumeSetIAsync(long ptr, int style);
+	private static native int resetTouchLatencyVAsync(long ptr);
+	private static native int resetSelectionLatencyVAsync(long ptr);
+	private static native int startTouchRecordingVAsync(long ptr);
+	private static native int stopTouchRecordingSAsync(long ptr, String fileName);
+	private static native int replayTouchesSZAsync(long ptr, String fileName, boolean realTime);
+	private static native int onUserCode1VAsync(long ptr);
+	private static native int onUserCode2VAsync(long ptr);
+	private static native int onUserCode3VAsync(long ptr);
+	private static native int onUserCode4VAsync(long ptr);
+	private static native void executeCommands(long ptr, ByteBuffer commands, int size);
 
 	public AndroidUserMobileSurfaceView(Context context) {
 		super(context);
@@ -33,6 +104,11 @@ public class AndroidUserMobileSurfaceView extends AndroidMobileSurfaceView {
 	}
 
 
+	public  boolean generateScene(int segmentCount, int shellCount, int triangleCount, float instanceRatio, int materialCount, float dispersion, int seed) {
+		return  generateSceneIIIFIFI(mSurfacePointer, segmentCount, shellCount, triangleCount, instanceRatio, materialCount, dispersion, seed);
+	}
+
+
 	public  void setOperatorOrbit() {
 		 setOperatorOrbitV(mSurfacePointer);
 	}
@@ -58,6 +134,36 @@ public class AndroidUserMobileSurfaceView extends AndroidMobileSurfaceView {
 	}
 
 
+	public  void setOperatorSelectLasso() {
+		 setOperatorSelectLassoV(mSurfacePointer);
+	}
+
+
+	public  void setOperatorPreselect() {
+		 setOperatorPreselectV(mSurfacePointer);
+	}
+
+
+	public  void setOperatorMeasure(int mode) {
+		 setOperatorMeasureI(mSurfacePointer, mode);
+	}
+
+
+	public  void clearMeasurements() {
+		 clearMeasurementsV(mSurfacePointer);
+	}
+
+
+	public  boolean measureSelectionClearance() {
+		return  measureSelectionClearanceV(mSurfacePointer);
+	}
+
+
+	public  void cancelClearance() {
+		 cancelClearanceV(mSurfacePointer);
+	}
+
+
 	public  void onModeSimpleShadow(boolean enable) {
 		 onModeSimpleShadowZ(mSurfacePointer, enable);
 	}
@@ -78,6 +184,111 @@ public class AndroidUserMobileSurfaceView extends AndroidMobileSurfaceView {
 	}
 
 
+	public  void onModePerformanceHUD() {
+		 onModePerformanceHUDV(mSurfacePointer);
+	}
+
+
+	public  int getSelection(ByteBuffer buffer) {
+		return  getSelectionBB(mSurfacePointer, buffer);
+	}
+
+
+	public  int highlightSegmentsNamed(String name, int style) {
+		return  highlightSegmentsNamedSI(mSurfacePointer, name, style);
+	}
+
+
+	public  void unhighlightStyle(int style) {
+		 unhighlightStyleI(mSurfacePointer, style);
+	}
+
+
+	public  void unhighlightAll() {
+		 unhighlightAllV(mSurfacePointer);
+	}
+
+
+	public  void setHighlightColor(int style, float r, float g, float b) {
+		 setHighlightColorIFFF(mSurfacePointer, style, r, g, b);
+	}
+
+
+	public  int detectClashes(String groupA, String groupB, float tolerance, int style) {
+		return  detectClashesSSFI(mSurfacePointer, groupA, groupB, tolerance, style);
+	}
+
+
+	public  void cancelClashes() {
+		 cancelClashesV(mSurfacePointer);
+	}
+
+
+	public  int queryBox(float minX, float minY, float minZ, float maxX, float maxY, float maxZ, boolean contained, boolean exact) {
+		return  queryBoxFFFFFFZZ(mSurfacePointer, minX, minY, minZ, maxX, maxY, maxZ, contained, exact);
+	}
+
+
+	public  int queryWindowFrustum(float left, float bottom, float right, float top, boolean contained) {
+		return  queryWindowFrustumFFFFZ(mSurfacePointer, left, bottom, right, top, contained);
+	}
+
+
+	public  int getVolumeSet(ByteBuffer buffer) {
+		return  getVolumeSetBB(mSurfacePointer, buffer);
+	}
+
+
+	public  int hideOutsideVolumeSet() {
+		return  hideOutsideVolumeSetV(mSurfacePointer);
+	}
+
+
+	public  void showAllItems() {
+		 showAllItemsV(mSurfacePointer);
+	}
+
+
+	public  int highlightVolumeSet(int style) {
+		return  highlightVolumeSetI(mSurfacePointer, style);
+	}
+
+
+	public  int getTouchLatency(String operatorName, float[] stats) {
+		return  getTouchLatencySFA(mSurfacePointer, operatorName, stats);
+	}
+
+
+	public  void resetTouchLatency() {
+		 resetTouchLatencyV(mSurfacePointer);
+	}
+
+
+	public  int getSelectionLatency(float[] stats) {
+		return  getSelectionLatencyFA(mSurfacePointer, stats);
+	}
+
+
+	public  void resetSelectionLatency() {
+		 resetSelectionLatencyV(mSurfacePointer);
+	}
+
+
+	public  void startTouchRecording() {
+		 startTouchRecordingV(mSurfacePointer);
+	}
+
+
+	public  boolean stopTouchRecording(String fileName) {
+		return  stopTouchRecordingS(mSurfacePointer, fileName);
+	}
+
+
+	public  int getReplayStats(float[] stats) {
+		return  getReplayStatsFA(mSurfacePointer, stats);
+	}
+
+
 	public  void onUserCode1() {
 		 onUserCode1V(mSurfacePointer);
 	}
@@ -98,5 +309,421 @@ public class AndroidUserMobileSurfaceView extends AndroidMobileSurfaceView {
 	}
 
 
+	public int loadFileAsync(String fileName) {
+		return loadFileSAsync(mSurfacePointer, fileName);
+	}
+
+
+	public int generateSceneAsync(int segmentCount, int shellCount, int triangleCount, float instanceRatio, int materialCount, float dispersion, int seed) {
+		return generateSceneIIIFIFIAsync(mSurfacePointer, segmentCount, shellCount, triangleCount, instanceRatio, materialCount, dispersion, seed);
+	}
+
+
+	public int setOperatorOrbitAsync() {
+		return setOperatorOrbitVAsync(mSurfacePointer);
+	}
+
+
+	public int setOperatorZoomAreaAsync() {
+		return setOperatorZoomAreaVAsync(mSurfacePointer);
+	}
+
+
+	public int setOperatorFlyAsync() {
+		return setOperatorFlyVAsync(mSurfacePointer);
+	}
+
+
+	public int setOperatorSelectPointAsync() {
+		return setOperatorSelectPointVAsync(mSurfacePointer);
+	}
+
+
+	public int setOperatorSelectAreaAsync() {
+		return setOperatorSelectAreaVAsync(mSurfacePointer);
+	}
+
+
+	public int setOperatorSelectLassoAsync() {
+		return setOperatorSelectLassoVAsync(mSurfacePointer);
+	}
+
+
+	public int setOperatorPreselectAsync() {
+		return setOperatorPreselectVAsync(mSurfacePointer);
+	}
+
+
+	public int setOperatorMeasureAsync(int mode) {
+		return setOperatorMeasureIAsync(mSurfacePointer, mode);
+	}
+
+
+	public int clearMeasurementsAsync() {
+		return clearMeasurementsVAsync(mSurfacePointer);
+	}
+
+
+	public int measureSelectionClearanceAsync() {
+		return measureSelectionClearanceVAsync(mSurfacePointer);
+	}
+
+
+	public int cancelClearanceAsync() {
+		return cancelClearanceVAsync(mSurfacePointer);
+	}
+
+
+	public int onModeSimpleShadowAsync(boolean enable) {
+		return onModeSimpleShadowZAsync(mSurfacePointer, enable);
+	}
+
+
+	public int onModeSmoothAsync() {
+		return onModeSmoothVAsync(mSurfacePointer);
+	}
+
+
+	public int onModeHiddenLineAsync() {
+		return onModeHiddenLineVAsync(mSurfacePointer);
+	}
+
+
+	public int onModeFrameRateAsync() {
+		return onModeFrameRateVAsync(mSurfacePointer);
+	}
+
+
+	public int onModePerformanceHUDAsync() {
+		return onModePerformanceHUDVAsync(mSurfacePointer);
+	}
+
+
+	public int highlightSegmentsNamedAsync(String name, int style) {
+		return highlightSegmentsNamedSIAsync(mSurfacePointer, name, style);
+	}
+
+
+	public int unhighlightStyleAsync(int style) {
+		return unhighlightStyleIAsync(mSurfacePointer, style);
+	}
+
+
+	public int unhighlightAllAsync() {
+		return unhighlightAllVAsync(mSurfacePointer);
+	}
+
+
+	public int setHighlightColorAsync(int style, float r, float g, float b) {
+		return setHighlightColorIFFFAsync(mSurfacePointer, style, r, g, b);
+	}
+
+
+	public int detectClashesAsync(String groupA, String groupB, float tolerance, int style) {
+		return detectClashesSSFIAsync(mSurfacePointer, groupA, groupB, tolerance, style);
+	}
+
+
+	public int cancelClashesAsync() {
+		return cancelClashesVAsync(mSurfacePointer);
+	}
+
+
+	public int queryBoxAsync(float minX, float minY, float minZ, float maxX, float maxY, float maxZ, boolean contained, boolean exact) {
+		return queryBoxFFFFFFZZAsync(mSurfacePointer, minX, minY, minZ, maxX, maxY, maxZ, contained, exact);
+	}
+
+
+	public int queryWindowFrustumAsync(float left, float bottom, float right, float top, boolean contained) {
+		return queryWindowFrustumFFFFZAsync(mSurfacePointer, left, bottom, right, top, contained);
+	}
+
+
+	public int hideOutsideVolumeSetAsync() {
+		return hideOutsideVolumeSetVAsync(mSurfacePointer);
+	}
+
+
+	public int showAllItemsAsync() {
+		return showAllItemsVAsync(mSurfacePointer);
+	}
+
+
+	public int highlightVolumeSetAsync(int style) {
+		return highlightVolumeSetIAsync(mSurfacePointer, style);
+	}
+
+
+	public int resetTouchLatencyAsync() {
+		return resetTouchLatencyVAsync(mSurfacePointer);
+	}
+
+
+	public int resetSelectionLatencyAsync() {
+		return resetSelectionLatencyVAsync(mSurfacePointer);
+	}
+
+
+	public int startTouchRecordingAsync() {
+		return startTouchRecordingVAsync(mSurfacePointer);
+	}
+
+
+	public int stopTouchRecordingAsync(String fileName) {
+		return stopTouchRecordingSAsync(mSurfacePointer, fileName);
+	}
+
+
+	public int replayTouchesAsync(String fileName, boolean realTime) {
+		return replayTouchesSZAsync(mSurfacePointer, fileName, realTime);
+	}
+
+
+	public int onUserCode1Async() {
+		return onUserCode1VAsync(mSurfacePointer);
+	}
+
+
+	public int onUserCode2Async() {
+		return onUserCode2VAsync(mSurfacePointer);
+	}
+
+
+	public int onUserCode3Async() {
+		return onUserCode3VAsync(mSurfacePointer);
+	}
+
+
+	public int onUserCode4Async() {
+		return onUserCode4VAsync(mSurfacePointer);
+	}
+
+
+	// Records surface actions so execute() can run them in a single native call, with one
+	// canvas update at the end.  Actions returning a value or taking arrays are not recorded.
+	public static final class CommandBuffer {
+		private static final Charset UTF8 = Charset.forName("UTF-8");
+		private ByteBuffer mBuffer;
+
+		public CommandBuffer() {
+			this(256);
+		}
+
+		public CommandBuffer(int capacity) {
+			mBuffer = ByteBuffer.allocateDirect(capacity).order(ByteOrder.nativeOrder());
+		}
+
+		public boolean isEmpty() {
+			return mBuffer.position() == 0;
+		}
+
+		public void clear() {
+			mBuffer.clear();
+		}
+
+		public CommandBuffer setOperatorOrbit() {
+			putCommand(0);
+			return this;
+		}
+
+		public CommandBuffer setOperatorZoomArea() {
+			putCommand(1);
+			return this;
+		}
+
+		public CommandBuffer setOperatorFly() {
+			putCommand(2);
+			return this;
+		}
+
+		public CommandBuffer setOperatorSelectPoint() {
+			putCommand(3);
+			return this;
+		}
+
+		public CommandBuffer setOperatorSelectArea() {
+			putCommand(4);
+			return this;
+		}
+
+		public CommandBuffer setOperatorSelectLasso() {
+			putCommand(5);
+			return this;
+		}
+
+		public CommandBuffer setOperatorPreselect() {
+			putCommand(6);
+			return this;
+		}
+
+		public CommandBuffer setOperatorMeasure(int mode) {
+			putCommand(7);
+			putInt(mode);
+			return this;
+		}
+
+		public CommandBuffer clearMeasurements() {
+			putCommand(8);
+			return this;
+		}
+
+		public CommandBuffer cancelClearance() {
+			putCommand(9);
+			return this;
+		}
+
+		public CommandBuffer onModeSimpleShadow(boolean enable) {
+			putCommand(10);
+			putBoolean(enable);
+			return this;
+		}
+
+		public CommandBuffer onModeSmooth() {
+			putCommand(11);
+			return this;
+		}
+
+		public CommandBuffer onModeHiddenLine() {
+			putCommand(12);
+			return this;
+		}
+
+		public CommandBuffer onModeFrameRate() {
+			putCommand(13);
+			return this;
+		}
+
+		public CommandBuffer onModePerformanceHUD() {
+			putCommand(14);
+			return this;
+		}
+
+		public CommandBuffer unhighlightStyle(int style) {
+			putCommand(15);
+			putInt(style);
+			return this;
+		}
+
+		public CommandBuffer unhighlightAll() {
+			putCommand(16);
+			return this;
+		}
+
+		public CommandBuffer setHighlightColor(int style, float r, float g, float b) {
+			putCommand(17);
+			putInt(style);
+			putFloat(r);
+			putFloat(g);
+			putFloat(b);
+			return this;
+		}
+
+		public CommandBuffer cancelClashes() {
+			putCommand(18);
+			return this;
+		}
+
+		public CommandBuffer showAllItems() {
+			putCommand(19);
+			return this;
+		}
+
+		public CommandBuffer resetTouchLatency() {
+			putCommand(20);
+			return this;
+		}
+
+		public CommandBuffer resetSelectionLatency() {
+			putCommand(21);
+			return this;
+		}
+
+		public CommandBuffer startTouchRecording() {
+			putCommand(22);
+			return this;
+		}
+
+		public CommandBuffer onUserCode1() {
+			putCommand(23);
+			return this;
+		}
+
+		public CommandBuffer onUserCode2() {
+			putCommand(24);
+			return this;
+		}
+
+		public CommandBuffer onUserCode3() {
+			putCommand(25);
+			return this;
+		}
+
+		public CommandBuffer onUserCode4() {
+			putCommand(26);
+			return this;
+		}
+
+		private void reserve(int bytes) {
+			if (mBuffer.remaining() >= bytes)
+				return;
+
+			int capacity = Math.max(mBuffer.capacity() * 2, mBuffer.position() + bytes);
+			ByteBuffer grown = ByteBuffer.allocateDirect(capacity).order(ByteOrder.nativeOrder());
+			mBuffer.flip();
+			grown.put(mBuffer);
+			mBuffer = grown;
+		}
+
+		private void putCommand(int opcode) {
+			putInt(opcode);
+		}
+
+		private void putBoolean(boolean value) {
+			reserve(1);
+			mBuffer.put((byte)(value ? 1 : 0));
+		}
+
+		private void putByte(byte value) {
+			reserve(1);
+			mBuffer.put(value);
+		}
+
+		private void putInt(int value) {
+			reserve(4);
+			mBuffer.putInt(value);
+		}
+
+		private void putLong(long value) {
+			reserve(8);
+			mBuffer.putLong(value);
+		}
+
+		private void putFloat(float value) {
+			reserve(4);
+			mBuffer.putFloat(value);
+		}
+
+		private void putDouble(double value) {
+			reserve(8);
+			mBuffer.putDouble(value);
+		}
+
+		private void putString(String value) {
+			byte[] bytes = value.getBytes(UTF8);
+			reserve(4 + bytes.length);
+			mBuffer.putInt(bytes.length);
+			mBuffer.put(bytes);
+		}
+	}
+
+	// Runs the recorded actions, then clears the buffer
+	public void execute(CommandBuffer commands) {
+		if (commands.isEmpty())
+			return;
+
+		executeCommands(mSurfacePointer, commands.mBuffer, commands.mBuffer.position());
+		commands.clear();
+	}
+
 }
 
@@ -2,9 +2,14 @@ package com.techsoft3d.hps.sandbox;
 
 // Auto-generated file
 
+import java.nio.ByteBuffer;
+
 public class MobileApp {
 	private static native void setFontDirectoryS(String fontDir);
 	private static native void setMaterialsDirectoryS(String materialsDir);
+	private static native void startTracingV();
+	private static native boolean stopTracingS(String traceFile);
+	private static native void setThreadPlacementIII(int latencyCores, int throughputCores, int backgroundCores);
 
 	public static void setFontDirectory(String fontDir) {
 		 setFontDirectoryS(fontDir);
@@ -16,5 +21,20 @@ public class MobileApp {
 	}
 
 
+	public static void startTracing() {
+		 startTracingV();
+	}
+
+
+	public static boolean stopTracing(String traceFile) {
+		return  stopTracingS(traceFile);
+	}
+
+
+	public static void setThreadPlacement(int latencyCores, int throughputCores, int backgroundCores) {
+		 setThreadPlacementIII(latencyCores, throughputCores, backgroundCores);
+	}
+
+
 }
 
@@ -17,7 +17,6 @@ import android.content.IntentFilter;
 import android.content.res.Configuration;
 import android.database.Cursor;
 import android.net.Uri;
-import android.os.AsyncTask;
 import android.os.Bundle;
 import android.os.Environment;
 import android.os.Handler;
@@ -50,11 +49,29 @@ public class MobileSurfaceActivity extends Activity implements
 	private String mPath = "";
 	private boolean mShouldLoadFile = false;
 	private ProgressDialog mProgress;
+	private int mLoadRequestId = 0;
 
 	private boolean mFileNeedsDownload = false;
 
 	private boolean mModeSimpleShadowEnabled;
 
+	// Measurement taken by the measure button, one of the AndroidMobileSurfaceView.MEASURE_* modes
+	private int mMeasureMode = -1;
+
+	// Toolbar actions are sent to native code at most once per frame, so presses in
+	// quick succession cost a single JNI call and a single redraw
+	private static final long TOOLBAR_FLUSH_DELAY_MS = 16;
+	private final AndroidUserMobileSurfaceView.CommandBuffer mToolbarCommands = new AndroidUserMobileSurfaceView.CommandBuffer();
+	private final Handler mToolbarHandler = new Handler(Looper.getMainLooper());
+	private boolean mToolbarFlushPending = false;
+	private final Runnable mFlushToolbarCommands = new Runnable() {
+		@Override
+		public void run() {
+			mToolbarFlushPending = false;
+			mSurfaceView.execute(mToolbarCommands);
+		}
+	};
+
 	private FrameLayout mMainLayout;
 	private View mCurrentToolbarView;
 	private View mKeyboardTriggerView;
@@ -133,7 +150,7 @@ public class MobileSurfaceActivity extends Activity implements
 		mFileNeedsDownload = false;
 		
 		Toast.makeText(getApplicationContext(), name + " Added to My Documents", Toast.LENGTH_SHORT).show();
-		new LoadFileAsyncTask().execute(mPath);
+		mLoadRequestId = mSurfaceView.loadFileAsync(mPath);
 	}	
 	
 	private void copyFileIfNecessary() {
@@ -269,7 +286,7 @@ public class MobileSurfaceActivity extends Activity implements
 		}
 
 		if (mShouldLoadFile) {
-			new LoadFileAsyncTask().execute(mPath);
+			mLoadRequestId = mSurfaceView.loadFileAsync(mPath);
 		}
 	}
 
@@ -321,29 +338,45 @@ public class MobileSurfaceActivity extends Activity implements
 		mainHandler.post(runnable);
 	}
 	
-	// AsyncTask for performing file load on a separate thread.
-	// Note that calling cancel() on this task will *not* abort the file load.
-	private class LoadFileAsyncTask extends AsyncTask<String, Void[], Boolean> {
-		@Override
-		protected Boolean doInBackground(String... paths) {
-			// Perform file load on separate thread
-			return mSurfaceView.loadFile(paths[0]);
-		}
+	// Completion of the file load started with loadFileAsync()
+	public void onActionCompleted(int requestId, double result) {
+		if (requestId != mLoadRequestId)
+			return;
+		mLoadRequestId = 0;
 
-		@Override
-		protected void onPostExecute(Boolean result) {
-			if (result == false)
-				showToast("File failed to load");
+		if (result == 0)
+			showToast("File failed to load");
 
-			if (mProgress != null) {
-				mProgress.dismiss();
-				mProgress = null;
-			}
+		if (mProgress != null) {
+			mProgress.dismiss();
+			mProgress = null;
 		}
 	}
 
+	// Selections are shown by their highlights; nothing else to update here
+	public void onSelectionCompleted(int requestId, int count, float latencyMs) {
+	}
+
+	public void onMeasurementCompleted(int mode, float value) {
+		showToast(mode == AndroidMobileSurfaceView.MEASURE_ANGLE ? String.format("%.1f\u00b0", value) : String.format("%.4g", value));
+	}
+
+	public void onClearanceCompleted(float distance) {
+		showToast(distance >= 0 ? "Clearance " + String.format("%.4g", distance) : "No clearance found");
+	}
+
+	public void onClashProgress(int tested, int total, int clashes) {
+		if (tested == total)
+			showToast(clashes + " clashes in " + total + " pairs");
+	}
+
 	@Override
 	protected void onPause() {
+		// Run any toolbar action still waiting before the surface goes away
+		if (mToolbarFlushPending) {
+			mToolbarHandler.removeCallbacks(mFlushToolbarCommands);
+			mFlushToolbarCommands.run();
+		}
 		super.onPause();
 	}
 
@@ -414,45 +447,68 @@ public class MobileSurfaceActivity extends Activity implements
 
 		switch (view.getId()) {
 		case R.id.orbitButton:
-			mSurfaceView.setOperatorOrbit();
+			mToolbarCommands.setOperatorOrbit();
 			break;
 		case R.id.zoomAreaButton:
-			mSurfaceView.setOperatorZoomArea();
+			mToolbarCommands.setOperatorZoomArea();
 			break;
 		case R.id.selectButton:
-			mSurfaceView.setOperatorSelectPoint();
+			mToolbarCommands.setOperatorSelectPoint();
 			break;
 		case R.id.selectAreaButton:
-			mSurfaceView.setOperatorSelectArea();
+			mToolbarCommands.setOperatorSelectArea();
+			break;
+		case R.id.selectLassoButton:
+			mToolbarCommands.setOperatorSelectLasso();
+			break;
+		case R.id.preselectButton:
+			mToolbarCommands.setOperatorPreselect();
+			break;
+		case R.id.measureButton:
+			// Each press moves on to the next kind of measurement
+			mMeasureMode = (mMeasureMode + 1) % AndroidMobileSurfaceView.MEASURE_MODE_COUNT;
+			mToolbarCommands.setOperatorMeasure(mMeasureMode);
+			showToast(getResources().getStringArray(R.array.measure_modes)[mMeasureMode]);
+			break;
+		case R.id.clearanceButton:
+			mToolbarCommands.measureSelectionClearance();
 			break;
 		case R.id.flyButton:
-			mSurfaceView.setOperatorFly();
+			mToolbarCommands.setOperatorFly();
 			break;
 		case R.id.simpleShadowButton:
 			mModeSimpleShadowEnabled = !mModeSimpleShadowEnabled;
-			mSurfaceView.onModeSimpleShadow(mModeSimpleShadowEnabled);
+			mToolbarCommands.onModeSimpleShadow(mModeSimpleShadowEnabled);
 			break;
 		case R.id.smoothButton:
-			mSurfaceView.onModeSmooth();
+			mToolbarCommands.onModeSmooth();
 			break;
 		case R.id.hiddenLineButton:
-			mSurfaceView.onModeHiddenLine();
+			mToolbarCommands.onModeHiddenLine();
 			break;
 		case R.id.frameRateButton:
-			mSurfaceView.onModeFrameRate();
+			mToolbarCommands.onModeFrameRate();
+			break;
+		case R.id.performanceHUDButton:
+			mToolbarCommands.onModePerformanceHUD();
 			break;
 		case R.id.userCode1Button:
-			mSurfaceView.onUserCode1();
+			mToolbarCommands.onUserCode1();
 			break;
 		case R.id.userCode2Button:
-			mSurfaceView.onUserCode2();
+			mToolbarCommands.onUserCode2();
 			break;
 		case R.id.userCode3Button:
-			mSurfaceView.onUserCode3();
+			mToolbarCommands.onUserCode3();
 			break;
 		case R.id.userCode4Button:
-			mSurfaceView.onUserCode4();
+			mToolbarCommands.onUserCode4();
 			break;
 		}
+
+		if (!mToolbarCommands.isEmpty() && !mToolbarFlushPending) {
+			mToolbarFlushPending = true;
+			mToolbarHandler.postDelayed(mFlushToolbarCommands, TOOLBAR_FLUSH_DELAY_MS);
+		}
 	}
 }
@@ -12,14 +12,18 @@
 #include <stdlib.h>
 #include <math.h>
 
+#include "MobileApp.h"
 #include "MobileSurface.h"
+#include "SurfaceRegistry.h"
 #include "JNIHelpers.h"
+#include "JNICallbacks.h"
+#include "Trace.h"
 
 #include "jpaths.h"
 
-#define  LOG_TAG    "AndroidMobileSurfaceJNI"
-#define  LOGI(...)  __android_log_print(ANDROID_LOG_INFO,LOG_TAG,__VA_ARGS__)
-#define  LOGE(...)  __android_log_print(ANDROID_LOG_ERROR,LOG_TAG,__VA_ARGS__)
+#define  JNI_LOG_TAG    "AndroidMobileSurfaceJNI"
+#define  LOGI(...)  __android_log_print(ANDROID_LOG_INFO,JNI_LOG_TAG,__VA_ARGS__)
+#define  LOGE(...)  __android_log_print(ANDROID_LOG_ERROR,JNI_LOG_TAG,__VA_ARGS__)
 
 static void * platform_data[] = {(void*)2, 0, 0};
 extern JavaVM *g_javaVM;
@@ -27,111 +31,149 @@ extern HPS::PlatformData g_android_platform_data;
 
 JNIHelpers::ShowKeyboardHandler show_keyboard_handler;
 
-jobject classObject;
-jclass classz;
-
-static jlong create(JNIEnv * env, jclass cobj, jobject classObj, int guiSurfaceId)
+// Returns 'ptr' when it is still a live surface (the view is recreated on rotation), else a new surface
+static jlong create(JNIEnv * env, jclass cobj, jobject classObj, int guiSurfaceId, jlong ptr)
 {
-	classObject = env->NewGlobalRef(classObj);
-	classz = (jclass)env->NewGlobalRef(env->GetObjectClass(classObject));
-	return (jlong)createMobileSurface(guiSurfaceId);
+	TRACE_SCOPE("jni", "create");
+	SurfaceHandle handle = ptr;
+	if (!SurfaceRegistry::Ref<MobileSurface>(ptr))
+	{
+		handle = SurfaceRegistry::add(createMobileSurface(guiSurfaceId));
+		if (handle == 0)
+			LOGE("Too many surfaces, at most %d are supported", SurfaceRegistry::MAX_SURFACES);
+	}
+
+	// The view is new when rotating too: callbacks of this surface go to it from now on
+	JNICallbacks::setTarget(env, handle, classObj);
+	return handle;
 }
 
 static void onTextInputJS(JNIEnv *env, jclass cobj, jlong ptr, jstring text)
 {
+	TRACE_SCOPE("jni", "onTextInputJS");
 	JNIHelpers::String ctext(env, text);
 	HPS::TextInputEvent hps_event(HPS::UTF8(ctext.str()));
-	((MobileSurface*)ptr)->GetCanvas().GetWindowKey().GetEventDispatcher().InjectEvent(hps_event);
+	SurfaceRegistry::Ref<MobileSurface> surface(ptr);
+	if (surface)
+		surface->GetCanvas().GetWindowKey().GetEventDispatcher().InjectEvent(hps_event);
 }
 
 static void onKeyboardHiddenJ(JNIEnv *env, jclass cobj, jlong ptr)
 {
+	TRACE_SCOPE("jni", "onKeyboardHiddenJ");
 	HPS::HideKeyboardEvent hps_event;
 	HPS::Database::GetEventDispatcher().InjectEventWithNotifier(hps_event).Wait();
 }
 
 static jboolean bind(JNIEnv * env, jclass cobj, jlong ptr, jobject context, jobject surface)
 {
+	TRACE_SCOPE("jni", "bind");
+	SurfaceRegistry::Ref<MobileSurface> mobileSurface(ptr);
+	if (!mobileSurface)
+		return false;
+
 	g_android_platform_data = (intptr_t)platform_data;
 	platform_data[1] = g_javaVM;
 	platform_data[2] = env->NewGlobalRef(context);
 	EGLNativeWindowType		nativeWindow = ANativeWindow_fromSurface(env, surface);
 
+	// bind() waits for the World, which has to exist before subscribing
+	bool bound = false;
+	MobileApp::inst().actionExecutor().call([&]() {
+		bound = mobileSurface->bind(nativeWindow);
+	});
 	HPS::Database::GetEventDispatcher().Subscribe(show_keyboard_handler, HPS::Object::ClassID<HPS::ShowKeyboardEvent>());
 
-	return ((MobileSurface*)ptr)->bind(nativeWindow);
+	return bound;
 }
 
 static void release(JNIEnv *env, jclass cobj, jlong ptr, jint flags)
 {
-	((MobileSurface*)ptr)->release(flags);
+	TRACE_SCOPE("jni", "release");
+	{
+		SurfaceRegistry::Ref<MobileSurface> surface(ptr);
+		if (!surface)
+			return;
+
+		// A long action in progress stops rather than keeping the UI thread waiting
+		surface->cancelActions();
+		MobileApp::inst().actionExecutor().call([&]() {
+			surface->release(flags);
+		});
+	}
+
+	// Unless rotating, release() discarded the canvas and the scene: the view creates a new surface
+	//  when it is shown again, and anything still holding this handle is turned away from now on.
+	if ((flags & SCREEN_ROTATING) == 0)
+	{
+		SurfaceRegistry::destroy(ptr);
+		JNICallbacks::clearTarget(env, ptr);
+	}
 }
 
 static void refresh(JNIEnv *env, jclass cobj, jlong ptr)
 {
-	((MobileSurface*)ptr)->refresh();
+	TRACE_SCOPE("jni", "refresh");
+	// Nothing to wait for: the refresh runs after the actions queued before it
+	MobileApp::inst().actionExecutor().post([ptr]() {
+		SurfaceRegistry::Ref<MobileSurface> surface(ptr);
+		if (surface)
+			surface->refresh();
+	});
 }
 
-static void touchDown(JNIEnv * env, jclass cobj, jlong ptr, jint numTouches, jintArray xposArray, jintArray yposArray, jlongArray idArray)
+static void setTouchRing(JNIEnv * env, jclass cobj, jlong ptr, jobject ring)
 {
-	JNIHelpers::IntArray xa(env, xposArray);
-	JNIHelpers::IntArray ya(env, yposArray);
-	JNIHelpers::LongArray ida(env, idArray);
-	((MobileSurface*)ptr)->touchDown(numTouches, xa.arr(), ya.arr(), (HPS::TouchID*)ida.arr(), 1);
-}
+	TRACE_SCOPE("jni", "setTouchRing");
+	void *memory = env->GetDirectBufferAddress(ring);
+	jlong capacity = env->GetDirectBufferCapacity(ring);
+	if (memory == nullptr || capacity < 0) {
+		LOGE("Touch ring is not a direct ByteBuffer");
+		return;
+	}
 
-static void touchMove(JNIEnv * env, jclass cobj, jlong ptr, jint numTouches, jintArray xposArray, jintArray yposArray, jlongArray idArray)
-{
-	JNIHelpers::IntArray xa(env, xposArray);
-	JNIHelpers::IntArray ya(env, yposArray);
-	JNIHelpers::LongArray ida(env, idArray);
-	((MobileSurface*)ptr)->touchMove(numTouches, xa.arr(), ya.arr(), (HPS::TouchID*)ida.arr());
+	SurfaceRegistry::Ref<MobileSurface> surface(ptr);
+	if (surface)
+		surface->setTouchRing(memory, (size_t)capacity);
 }
 
-static void touchUp(JNIEnv * env, jclass cobj, jlong ptr, jint numTouches, jintArray xposArray, jintArray yposArray, jlongArray idArray)
+static void touchSamples(JNIEnv * env, jclass cobj, jlong ptr, jint first, jint count)
 {
-	JNIHelpers::IntArray xa(env, xposArray);
-	JNIHelpers::IntArray ya(env, yposArray);
-	JNIHelpers::LongArray ida(env, idArray);
-	((MobileSurface*)ptr)->touchUp(numTouches, xa.arr(), ya.arr(), (HPS::TouchID*)ida.arr());
+	TRACE_SCOPE("jni", "touchSamples");
+	SurfaceRegistry::Ref<MobileSurface> surface(ptr);
+	if (surface)
+		surface->processTouchSamples(first, count);
 }
 
 static void touchesCancel(JNIEnv * env, jclass obj, jlong ptr)
 {
-	((MobileSurface*)ptr)->touchesCancel();
+	TRACE_SCOPE("jni", "touchesCancel");
+	SurfaceRegistry::Ref<MobileSurface> surface(ptr);
+	if (surface)
+		surface->touchesCancel();
 }
 
 static void singleTap(JNIEnv * env, jclass cobj, jlong ptr, jint x, jint y)
 {
-	((MobileSurface*)ptr)->singleTap(x, y);
+	TRACE_SCOPE("jni", "singleTap");
+	SurfaceRegistry::Ref<MobileSurface> surface(ptr);
+	if (surface)
+		surface->singleTap(x, y);
 }
 
 static void doubleTap(JNIEnv * env, jclass cobj, jlong ptr, jint x, jint y, jlong id)
 {
-	((MobileSurface*)ptr)->doubleTap(x, y, id);
+	TRACE_SCOPE("jni", "doubleTap");
+	SurfaceRegistry::Ref<MobileSurface> surface(ptr);
+	if (surface)
+		surface->doubleTap(x, y, id);
 }
 
 static void onShowKeyboard()
 {
-	JNIEnv *env = nullptr;
-	int status = g_javaVM->GetEnv((void **)&env, JNI_VERSION_1_6);
-	if (status == JNI_EDETACHED) {
-		int new_status = g_javaVM->AttachCurrentThread(&env, nullptr);
-		if( new_status != JNI_OK) {
-			return;
-		}
-	}
-
-	jmethodID callback = env->GetMethodID(classz, "ShowKeyboard", "()V");
-	if (callback == nullptr) {
-		return;
-	}
-
-	env->CallVoidMethod(classObject,callback);
-	if (status == JNI_EDETACHED) {
-		g_javaVM->DetachCurrentThread();
-	}
-	return;
+	TRACE_SCOPE("jni", "onShowKeyboard");
+	// Keyboard requests come from the database dispatcher, for no surface in particular
+	JNICallbacks::invoke(0, JNICallbacks::ShowKeyboard);
 }
 
 bool registerMobileSurfaceViewNatives(JNIEnv *env)
@@ -143,13 +185,12 @@ bool registerMobileSurfaceViewNatives(JNIEnv *env)
 	}
 
 	JNINativeMethod	methods[] = {
-		{"create", "(Lcom/techsoft3d/hps/sandbox/AndroidMobileSurfaceView;I)J", (void*)create},
+		{"create", "(Lcom/techsoft3d/hps/sandbox/AndroidMobileSurfaceView;IJ)J", (void*)create},
 		{"bind", "(JLjava/lang/Object;Ljava/lang/Object;)Z", (void*)bind},
 		{"release", "(JI)V", (void*)release},
 		{"refresh", "(J)V", (void*)refresh},
-		{"touchDown", "(JI[I[I[J)V", (void*)touchDown},
-		{"touchMove", "(JI[I[I[J)V", (void*)touchMove},
-		{"touchUp", "(JI[I[I[J)V", (void*)touchUp},
+		{"setTouchRing", "(JLjava/nio/ByteBuffer;)V", (void*)setTouchRing},
+		{"touchSamples", "(JII)V", (void*)touchSamples},
 		{"touchesCancel", "(J)V", (void*)touchesCancel},
 		{"singleTap", "(JII)V", (void*)singleTap},
 		{"doubleTap", "(JIIJ)V", (void*)doubleTap},
@@ -181,26 +222,33 @@ HPS::EventHandler::HandleResult JNIHelpers::ShowKeyboardHandler::Handle(HPS::Eve
 	return HPS::EventHandler::HandleResult::Handled;
 }
 
-void ShowPerformanceTestResult(float fps)
+void ShowPerformanceTestResult(SurfaceHandle surface, float fps)
 {
-	JNIEnv *env = nullptr;
-	int status = g_javaVM->GetEnv((void **)&env, JNI_VERSION_1_6);
-	if (status == JNI_EDETACHED) {
-		int new_status = g_javaVM->AttachCurrentThread(&env, nullptr);
-		if( new_status != JNI_OK) {
-			return;
-		}
-	}
+	TRACE_SCOPE("jni", "ShowPerformanceTestResult");
+	JNICallbacks::invoke(surface, JNICallbacks::ShowPerformanceTestResult, fps);
+}
 
-	jmethodID callback = env->GetMethodID(classz, "ShowPerformanceTestResult", "(F)V");
-	if (callback == nullptr) {
-		return;
-	}
+void ShowSelectionResult(SurfaceHandle surface, int requestId, int count, float latency)
+{
+	TRACE_SCOPE("jni", "ShowSelectionResult");
+	JNICallbacks::invoke(surface, JNICallbacks::SelectionCompleted, (jint)requestId, (jint)count, latency);
+}
 
-	env->CallVoidMethod(classObject,callback, fps);
-	if (status == JNI_EDETACHED) {
-		g_javaVM->DetachCurrentThread();
-	}
-	return;
+void ShowClashProgress(SurfaceHandle surface, int tested, int total, int clashes)
+{
+	TRACE_SCOPE("jni", "ShowClashProgress");
+	JNICallbacks::invoke(surface, JNICallbacks::ClashProgress, (jint)tested, (jint)total, (jint)clashes);
+}
+
+void ShowMeasurement(SurfaceHandle surface, int mode, float value)
+{
+	TRACE_SCOPE("jni", "ShowMeasurement");
+	JNICallbacks::invoke(surface, JNICallbacks::MeasurementCompleted, (jint)mode, value);
+}
+
+void ShowClearance(SurfaceHandle surface, float distance)
+{
+	TRACE_SCOPE("jni", "ShowClearance");
+	JNICallbacks::invoke(surface, JNICallbacks::ClearanceCompleted, distance);
 }
 
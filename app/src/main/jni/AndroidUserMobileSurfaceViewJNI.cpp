@@ -5,128 +5,1352 @@
 
 #include <jni.h>
 #include <android/log.h>
+#include <math.h>
 #include <stdio.h>
 
+#include <string>
+#include <vector>
+
 #include "jpaths.h"
 
 #define  JNI_LOG_TAG    "AndroidUserMobileSurfaceView"
 #define  LOGI(...)  __android_log_print(ANDROID_LOG_INFO,JNI_LOG_TAG,__VA_ARGS__)
 #define  LOGE(...)  __android_log_print(ANDROID_LOG_ERROR,JNI_LOG_TAG,__VA_ARGS__)
 
+#include "AsyncActions.h"
 #include "JNIHelpers.h"
+#include "MobileApp.h"
+#include "SurfaceRegistry.h"
+#include "Trace.h"
 
 static jboolean loadFileS(JNIEnv *env, jclass cobj, jlong ptr, jstring fileName)
 {
+	TRACE_SCOPE("jni", "loadFile");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return 0;
 	JNIHelpers::String cfileName(env, fileName);
-	jboolean ret =((UserMobileSurface*)ptr)->loadFile(cfileName.str());
+	jboolean ret = 0;
+	MobileApp::inst().actionExecutor().call([&]() {
+		ret = surface->loadFile(cfileName.str());
+	});
+	return ret;
+}
+
+
+static jboolean generateSceneIIIFIFI(JNIEnv *env, jclass cobj, jlong ptr, jint segmentCount, jint shellCount, jint triangleCount, jfloat instanceRatio, jint materialCount, jfloat dispersion, jint seed)
+{
+	TRACE_SCOPE("jni", "generateScene");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return 0;
+	
+	jboolean ret = 0;
+	MobileApp::inst().actionExecutor().call([&]() {
+		ret = surface->generateScene(segmentCount, shellCount, triangleCount, instanceRatio, materialCount, dispersion, seed);
+	});
 	return ret;
 }
 
 
 static void setOperatorOrbitV(JNIEnv *env, jclass cobj, jlong ptr)
 {
+	TRACE_SCOPE("jni", "setOperatorOrbit");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
 	
-	((UserMobileSurface*)ptr)->setOperatorOrbit();
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->setOperatorOrbit();
+	});
 	
 }
 
 
 static void setOperatorZoomAreaV(JNIEnv *env, jclass cobj, jlong ptr)
 {
+	TRACE_SCOPE("jni", "setOperatorZoomArea");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
 	
-	((UserMobileSurface*)ptr)->setOperatorZoomArea();
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->setOperatorZoomArea();
+	});
 	
 }
 
 
 static void setOperatorFlyV(JNIEnv *env, jclass cobj, jlong ptr)
 {
+	TRACE_SCOPE("jni", "setOperatorFly");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
 	
-	((UserMobileSurface*)ptr)->setOperatorFly();
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->setOperatorFly();
+	});
 	
 }
 
 
 static void setOperatorSelectPointV(JNIEnv *env, jclass cobj, jlong ptr)
 {
+	TRACE_SCOPE("jni", "setOperatorSelectPoint");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
 	
-	((UserMobileSurface*)ptr)->setOperatorSelectPoint();
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->setOperatorSelectPoint();
+	});
 	
 }
 
 
 static void setOperatorSelectAreaV(JNIEnv *env, jclass cobj, jlong ptr)
 {
+	TRACE_SCOPE("jni", "setOperatorSelectArea");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->setOperatorSelectArea();
+	});
+	
+}
+
+
+static void setOperatorSelectLassoV(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "setOperatorSelectLasso");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->setOperatorSelectLasso();
+	});
+	
+}
+
+
+static void setOperatorPreselectV(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "setOperatorPreselect");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->setOperatorPreselect();
+	});
+	
+}
+
+
+static void setOperatorMeasureI(JNIEnv *env, jclass cobj, jlong ptr, jint mode)
+{
+	TRACE_SCOPE("jni", "setOperatorMeasure");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->setOperatorMeasure(mode);
+	});
+	
+}
+
+
+static void clearMeasurementsV(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "clearMeasurements");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
 	
-	((UserMobileSurface*)ptr)->setOperatorSelectArea();
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->clearMeasurements();
+	});
+	
+}
+
+
+static jboolean measureSelectionClearanceV(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "measureSelectionClearance");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return 0;
+	
+	jboolean ret = 0;
+	MobileApp::inst().actionExecutor().call([&]() {
+		ret = surface->measureSelectionClearance();
+	});
+	return ret;
+}
+
+
+static void cancelClearanceV(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "cancelClearance");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->cancelClearance();
+	});
 	
 }
 
 
 static void onModeSimpleShadowZ(JNIEnv *env, jclass cobj, jlong ptr, jboolean enable)
 {
+	TRACE_SCOPE("jni", "onModeSimpleShadow");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
 	
-	((UserMobileSurface*)ptr)->onModeSimpleShadow(enable);
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->onModeSimpleShadow(enable);
+	});
 	
 }
 
 
 static void onModeSmoothV(JNIEnv *env, jclass cobj, jlong ptr)
 {
+	TRACE_SCOPE("jni", "onModeSmooth");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
 	
-	((UserMobileSurface*)ptr)->onModeSmooth();
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->onModeSmooth();
+	});
 	
 }
 
 
 static void onModeHiddenLineV(JNIEnv *env, jclass cobj, jlong ptr)
 {
+	TRACE_SCOPE("jni", "onModeHiddenLine");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
 	
-	((UserMobileSurface*)ptr)->onModeHiddenLine();
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->onModeHiddenLine();
+	});
 	
 }
 
 
 static void onModeFrameRateV(JNIEnv *env, jclass cobj, jlong ptr)
 {
+	TRACE_SCOPE("jni", "onModeFrameRate");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->onModeFrameRate();
+	});
+	
+}
+
+
+static void onModePerformanceHUDV(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "onModePerformanceHUD");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->onModePerformanceHUD();
+	});
+	
+}
+
+
+static jint getSelectionBB(JNIEnv *env, jclass cobj, jlong ptr, jobject buffer)
+{
+	TRACE_SCOPE("jni", "getSelection");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return 0;
+	JNIHelpers::ByteBuffer buffer_buf(env, buffer);
+	jint ret = 0;
+	MobileApp::inst().actionExecutor().call([&]() {
+		ret = surface->getSelection(buffer_buf.buffer());
+	});
+	return ret;
+}
+
+
+static jint highlightSegmentsNamedSI(JNIEnv *env, jclass cobj, jlong ptr, jstring name, jint style)
+{
+	TRACE_SCOPE("jni", "highlightSegmentsNamed");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return 0;
+	JNIHelpers::String cname(env, name);
+	jint ret = 0;
+	MobileApp::inst().actionExecutor().call([&]() {
+		ret = surface->highlightSegmentsNamed(cname.str(), style);
+	});
+	return ret;
+}
+
+
+static void unhighlightStyleI(JNIEnv *env, jclass cobj, jlong ptr, jint style)
+{
+	TRACE_SCOPE("jni", "unhighlightStyle");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->unhighlightStyle(style);
+	});
+	
+}
+
+
+static void unhighlightAllV(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "unhighlightAll");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->unhighlightAll();
+	});
+	
+}
+
+
+static void setHighlightColorIFFF(JNIEnv *env, jclass cobj, jlong ptr, jint style, jfloat r, jfloat g, jfloat b)
+{
+	TRACE_SCOPE("jni", "setHighlightColor");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->setHighlightColor(style, r, g, b);
+	});
+	
+}
+
+
+static jint detectClashesSSFI(JNIEnv *env, jclass cobj, jlong ptr, jstring groupA, jstring groupB, jfloat tolerance, jint style)
+{
+	TRACE_SCOPE("jni", "detectClashes");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return 0;
+	JNIHelpers::String cgroupA(env, groupA);
+	JNIHelpers::String cgroupB(env, groupB);
+	jint ret = 0;
+	MobileApp::inst().actionExecutor().call([&]() {
+		ret = surface->detectClashes(cgroupA.str(), cgroupB.str(), tolerance, style);
+	});
+	return ret;
+}
+
+
+static void cancelClashesV(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "cancelClashes");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->cancelClashes();
+	});
+	
+}
+
+
+static jint queryBoxFFFFFFZZ(JNIEnv *env, jclass cobj, jlong ptr, jfloat minX, jfloat minY, jfloat minZ, jfloat maxX, jfloat maxY, jfloat maxZ, jboolean contained, jboolean exact)
+{
+	TRACE_SCOPE("jni", "queryBox");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return 0;
+	
+	jint ret = 0;
+	MobileApp::inst().actionExecutor().call([&]() {
+		ret = surface->queryBox(minX, minY, minZ, maxX, maxY, maxZ, contained, exact);
+	});
+	return ret;
+}
+
+
+static jint queryWindowFrustumFFFFZ(JNIEnv *env, jclass cobj, jlong ptr, jfloat left, jfloat bottom, jfloat right, jfloat top, jboolean contained)
+{
+	TRACE_SCOPE("jni", "queryWindowFrustum");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return 0;
 	
-	((UserMobileSurface*)ptr)->onModeFrameRate();
+	jint ret = 0;
+	MobileApp::inst().actionExecutor().call([&]() {
+		ret = surface->queryWindowFrustum(left, bottom, right, top, contained);
+	});
+	return ret;
+}
+
+
+static jint getVolumeSetBB(JNIEnv *env, jclass cobj, jlong ptr, jobject buffer)
+{
+	TRACE_SCOPE("jni", "getVolumeSet");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return 0;
+	JNIHelpers::ByteBuffer buffer_buf(env, buffer);
+	jint ret = 0;
+	MobileApp::inst().actionExecutor().call([&]() {
+		ret = surface->getVolumeSet(buffer_buf.buffer());
+	});
+	return ret;
+}
+
+
+static jint hideOutsideVolumeSetV(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "hideOutsideVolumeSet");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return 0;
+	
+	jint ret = 0;
+	MobileApp::inst().actionExecutor().call([&]() {
+		ret = surface->hideOutsideVolumeSet();
+	});
+	return ret;
+}
+
+
+static void showAllItemsV(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "showAllItems");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->showAllItems();
+	});
 	
 }
 
 
+static jint highlightVolumeSetI(JNIEnv *env, jclass cobj, jlong ptr, jint style)
+{
+	TRACE_SCOPE("jni", "highlightVolumeSet");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return 0;
+	
+	jint ret = 0;
+	MobileApp::inst().actionExecutor().call([&]() {
+		ret = surface->highlightVolumeSet(style);
+	});
+	return ret;
+}
+
+
+static jint getTouchLatencySFA(JNIEnv *env, jclass cobj, jlong ptr, jstring operatorName, jfloatArray stats)
+{
+	TRACE_SCOPE("jni", "getTouchLatency");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return 0;
+	if (stats == nullptr || env->GetArrayLength(stats) < (LatencyMonitor::StatCount))
+		return -1;
+	JNIHelpers::String coperatorName(env, operatorName);
+	JNIHelpers::CriticalArray<float, jfloatArray> stats_arr(env, stats);
+	jint ret = surface->getTouchLatency(coperatorName.str(), stats_arr.arr());
+	return ret;
+}
+
+
+static void resetTouchLatencyV(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "resetTouchLatency");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->resetTouchLatency();
+	});
+	
+}
+
+
+static jint getSelectionLatencyFA(JNIEnv *env, jclass cobj, jlong ptr, jfloatArray stats)
+{
+	TRACE_SCOPE("jni", "getSelectionLatency");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return 0;
+	if (stats == nullptr || env->GetArrayLength(stats) < (LatencyMonitor::StatCount))
+		return -1;
+	JNIHelpers::CriticalArray<float, jfloatArray> stats_arr(env, stats);
+	jint ret = surface->getSelectionLatency(stats_arr.arr());
+	return ret;
+}
+
+
+static void resetSelectionLatencyV(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "resetSelectionLatency");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->resetSelectionLatency();
+	});
+	
+}
+
+
+static void startTouchRecordingV(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "startTouchRecording");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->startTouchRecording();
+	});
+	
+}
+
+
+static jboolean stopTouchRecordingS(JNIEnv *env, jclass cobj, jlong ptr, jstring fileName)
+{
+	TRACE_SCOPE("jni", "stopTouchRecording");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return 0;
+	JNIHelpers::String cfileName(env, fileName);
+	jboolean ret = 0;
+	MobileApp::inst().actionExecutor().call([&]() {
+		ret = surface->stopTouchRecording(cfileName.str());
+	});
+	return ret;
+}
+
+
+static jint getReplayStatsFA(JNIEnv *env, jclass cobj, jlong ptr, jfloatArray stats)
+{
+	TRACE_SCOPE("jni", "getReplayStats");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return 0;
+	if (stats == nullptr || env->GetArrayLength(stats) < (TouchRecording::ReplayStatCount))
+		return -1;
+	JNIHelpers::CriticalArray<float, jfloatArray> stats_arr(env, stats);
+	jint ret = surface->getReplayStats(stats_arr.arr());
+	return ret;
+}
+
+
 static void onUserCode1V(JNIEnv *env, jclass cobj, jlong ptr)
 {
+	TRACE_SCOPE("jni", "onUserCode1");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
 	
-	((UserMobileSurface*)ptr)->onUserCode1();
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->onUserCode1();
+	});
 	
 }
 
 
 static void onUserCode2V(JNIEnv *env, jclass cobj, jlong ptr)
 {
+	TRACE_SCOPE("jni", "onUserCode2");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
 	
-	((UserMobileSurface*)ptr)->onUserCode2();
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->onUserCode2();
+	});
 	
 }
 
 
 static void onUserCode3V(JNIEnv *env, jclass cobj, jlong ptr)
 {
+	TRACE_SCOPE("jni", "onUserCode3");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
 	
-	((UserMobileSurface*)ptr)->onUserCode3();
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->onUserCode3();
+	});
 	
 }
 
 
 static void onUserCode4V(JNIEnv *env, jclass cobj, jlong ptr)
 {
+	TRACE_SCOPE("jni", "onUserCode4");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+	
+	
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->onUserCode4();
+	});
+	
+}
+
+
+static jint loadFileSAsync(JNIEnv *env, jclass cobj, jlong ptr, jstring fileName)
+{
+	TRACE_SCOPE("jni", "loadFileAsync");
+	std::string fileName_copy(JNIHelpers::String(env, fileName).str());
+	return AsyncActions::post("loadFile", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		return surface->loadFile(fileName_copy.c_str()) ? 1.0 : 0.0;
+	});
+}
+
+
+static jint generateSceneIIIFIFIAsync(JNIEnv *env, jclass cobj, jlong ptr, jint segmentCount, jint shellCount, jint triangleCount, jfloat instanceRatio, jint materialCount, jfloat dispersion, jint seed)
+{
+	TRACE_SCOPE("jni", "generateSceneAsync");
+	
+	return AsyncActions::post("generateScene", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		return surface->generateScene(segmentCount, shellCount, triangleCount, instanceRatio, materialCount, dispersion, seed) ? 1.0 : 0.0;
+	});
+}
+
+
+static jint setOperatorOrbitVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "setOperatorOrbitAsync");
+	
+	return AsyncActions::post("setOperatorOrbit", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->setOperatorOrbit();
+		return 0.0;
+	});
+}
+
+
+static jint setOperatorZoomAreaVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "setOperatorZoomAreaAsync");
+	
+	return AsyncActions::post("setOperatorZoomArea", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->setOperatorZoomArea();
+		return 0.0;
+	});
+}
+
+
+static jint setOperatorFlyVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "setOperatorFlyAsync");
+	
+	return AsyncActions::post("setOperatorFly", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->setOperatorFly();
+		return 0.0;
+	});
+}
+
+
+static jint setOperatorSelectPointVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "setOperatorSelectPointAsync");
+	
+	return AsyncActions::post("setOperatorSelectPoint", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->setOperatorSelectPoint();
+		return 0.0;
+	});
+}
+
+
+static jint setOperatorSelectAreaVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "setOperatorSelectAreaAsync");
+	
+	return AsyncActions::post("setOperatorSelectArea", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->setOperatorSelectArea();
+		return 0.0;
+	});
+}
+
+
+static jint setOperatorSelectLassoVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "setOperatorSelectLassoAsync");
+	
+	return AsyncActions::post("setOperatorSelectLasso", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->setOperatorSelectLasso();
+		return 0.0;
+	});
+}
+
+
+static jint setOperatorPreselectVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "setOperatorPreselectAsync");
+	
+	return AsyncActions::post("setOperatorPreselect", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->setOperatorPreselect();
+		return 0.0;
+	});
+}
+
+
+static jint setOperatorMeasureIAsync(JNIEnv *env, jclass cobj, jlong ptr, jint mode)
+{
+	TRACE_SCOPE("jni", "setOperatorMeasureAsync");
+	
+	return AsyncActions::post("setOperatorMeasure", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->setOperatorMeasure(mode);
+		return 0.0;
+	});
+}
+
+
+static jint clearMeasurementsVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "clearMeasurementsAsync");
+	
+	return AsyncActions::post("clearMeasurements", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->clearMeasurements();
+		return 0.0;
+	});
+}
+
+
+static jint measureSelectionClearanceVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "measureSelectionClearanceAsync");
+	
+	return AsyncActions::post("measureSelectionClearance", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		return surface->measureSelectionClearance() ? 1.0 : 0.0;
+	});
+}
+
+
+static jint cancelClearanceVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "cancelClearanceAsync");
+	
+	return AsyncActions::post("cancelClearance", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->cancelClearance();
+		return 0.0;
+	});
+}
+
+
+static jint onModeSimpleShadowZAsync(JNIEnv *env, jclass cobj, jlong ptr, jboolean enable)
+{
+	TRACE_SCOPE("jni", "onModeSimpleShadowAsync");
+	
+	return AsyncActions::post("onModeSimpleShadow", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->onModeSimpleShadow(enable);
+		return 0.0;
+	});
+}
+
+
+static jint onModeSmoothVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "onModeSmoothAsync");
+	
+	return AsyncActions::post("onModeSmooth", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->onModeSmooth();
+		return 0.0;
+	});
+}
+
+
+static jint onModeHiddenLineVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "onModeHiddenLineAsync");
+	
+	return AsyncActions::post("onModeHiddenLine", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->onModeHiddenLine();
+		return 0.0;
+	});
+}
+
+
+static jint onModeFrameRateVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "onModeFrameRateAsync");
+	
+	return AsyncActions::post("onModeFrameRate", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->onModeFrameRate();
+		return 0.0;
+	});
+}
+
+
+static jint onModePerformanceHUDVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "onModePerformanceHUDAsync");
+	
+	return AsyncActions::post("onModePerformanceHUD", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->onModePerformanceHUD();
+		return 0.0;
+	});
+}
+
+
+static jint highlightSegmentsNamedSIAsync(JNIEnv *env, jclass cobj, jlong ptr, jstring name, jint style)
+{
+	TRACE_SCOPE("jni", "highlightSegmentsNamedAsync");
+	std::string name_copy(JNIHelpers::String(env, name).str());
+	return AsyncActions::post("highlightSegmentsNamed", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		return (double)surface->highlightSegmentsNamed(name_copy.c_str(), style);
+	});
+}
+
+
+static jint unhighlightStyleIAsync(JNIEnv *env, jclass cobj, jlong ptr, jint style)
+{
+	TRACE_SCOPE("jni", "unhighlightStyleAsync");
+	
+	return AsyncActions::post("unhighlightStyle", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->unhighlightStyle(style);
+		return 0.0;
+	});
+}
+
+
+static jint unhighlightAllVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "unhighlightAllAsync");
+	
+	return AsyncActions::post("unhighlightAll", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->unhighlightAll();
+		return 0.0;
+	});
+}
+
+
+static jint setHighlightColorIFFFAsync(JNIEnv *env, jclass cobj, jlong ptr, jint style, jfloat r, jfloat g, jfloat b)
+{
+	TRACE_SCOPE("jni", "setHighlightColorAsync");
+	
+	return AsyncActions::post("setHighlightColor", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->setHighlightColor(style, r, g, b);
+		return 0.0;
+	});
+}
+
+
+static jint detectClashesSSFIAsync(JNIEnv *env, jclass cobj, jlong ptr, jstring groupA, jstring groupB, jfloat tolerance, jint style)
+{
+	TRACE_SCOPE("jni", "detectClashesAsync");
+	std::string groupA_copy(JNIHelpers::String(env, groupA).str());
+	std::string groupB_copy(JNIHelpers::String(env, groupB).str());
+	return AsyncActions::post("detectClashes", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		return (double)surface->detectClashes(groupA_copy.c_str(), groupB_copy.c_str(), tolerance, style);
+	});
+}
+
+
+static jint cancelClashesVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "cancelClashesAsync");
+	
+	return AsyncActions::post("cancelClashes", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->cancelClashes();
+		return 0.0;
+	});
+}
+
+
+static jint queryBoxFFFFFFZZAsync(JNIEnv *env, jclass cobj, jlong ptr, jfloat minX, jfloat minY, jfloat minZ, jfloat maxX, jfloat maxY, jfloat maxZ, jboolean contained, jboolean exact)
+{
+	TRACE_SCOPE("jni", "queryBoxAsync");
+	
+	return AsyncActions::post("queryBox", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		return (double)surface->queryBox(minX, minY, minZ, maxX, maxY, maxZ, contained, exact);
+	});
+}
+
+
+static jint queryWindowFrustumFFFFZAsync(JNIEnv *env, jclass cobj, jlong ptr, jfloat left, jfloat bottom, jfloat right, jfloat top, jboolean contained)
+{
+	TRACE_SCOPE("jni", "queryWindowFrustumAsync");
+	
+	return AsyncActions::post("queryWindowFrustum", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		return (double)surface->queryWindowFrustum(left, bottom, right, top, contained);
+	});
+}
+
+
+static jint hideOutsideVolumeSetVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "hideOutsideVolumeSetAsync");
+	
+	return AsyncActions::post("hideOutsideVolumeSet", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		return (double)surface->hideOutsideVolumeSet();
+	});
+}
+
+
+static jint showAllItemsVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "showAllItemsAsync");
 	
-	((UserMobileSurface*)ptr)->onUserCode4();
+	return AsyncActions::post("showAllItems", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->showAllItems();
+		return 0.0;
+	});
+}
+
+
+static jint highlightVolumeSetIAsync(JNIEnv *env, jclass cobj, jlong ptr, jint style)
+{
+	TRACE_SCOPE("jni", "highlightVolumeSetAsync");
 	
+	return AsyncActions::post("highlightVolumeSet", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		return (double)surface->highlightVolumeSet(style);
+	});
 }
 
 
+static jint resetTouchLatencyVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "resetTouchLatencyAsync");
+	
+	return AsyncActions::post("resetTouchLatency", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->resetTouchLatency();
+		return 0.0;
+	});
+}
+
+
+static jint resetSelectionLatencyVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "resetSelectionLatencyAsync");
+	
+	return AsyncActions::post("resetSelectionLatency", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->resetSelectionLatency();
+		return 0.0;
+	});
+}
+
+
+static jint startTouchRecordingVAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "startTouchRecordingAsync");
+	
+	return AsyncActions::post("startTouchRecording", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->startTouchRecording();
+		return 0.0;
+	});
+}
+
+
+static jint stopTouchRecordingSAsync(JNIEnv *env, jclass cobj, jlong ptr, jstring fileName)
+{
+	TRACE_SCOPE("jni", "stopTouchRecordingAsync");
+	std::string fileName_copy(JNIHelpers::String(env, fileName).str());
+	return AsyncActions::post("stopTouchRecording", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		return surface->stopTouchRecording(fileName_copy.c_str()) ? 1.0 : 0.0;
+	});
+}
+
+
+static jint replayTouchesSZAsync(JNIEnv *env, jclass cobj, jlong ptr, jstring fileName, jboolean realTime)
+{
+	TRACE_SCOPE("jni", "replayTouchesAsync");
+	std::string fileName_copy(JNIHelpers::String(env, fileName).str());
+	return AsyncActions::post("replayTouches", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		return surface->replayTouches(fileName_copy.c_str(), realTime) ? 1.0 : 0.0;
+	});
+}
+
+
+static jint onUserCode1VAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "onUserCode1Async");
+	
+	return AsyncActions::post("onUserCode1", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->onUserCode1();
+		return 0.0;
+	});
+}
+
+
+static jint onUserCode2VAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "onUserCode2Async");
+	
+	return AsyncActions::post("onUserCode2", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->onUserCode2();
+		return 0.0;
+	});
+}
+
+
+static jint onUserCode3VAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "onUserCode3Async");
+	
+	return AsyncActions::post("onUserCode3", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->onUserCode3();
+		return 0.0;
+	});
+}
+
+
+static jint onUserCode4VAsync(JNIEnv *env, jclass cobj, jlong ptr)
+{
+	TRACE_SCOPE("jni", "onUserCode4Async");
+	
+	return AsyncActions::post("onUserCode4", ptr, [=]() -> double {
+		SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+		if (!surface)
+			return NAN;
+		surface->onUserCode4();
+		return 0.0;
+	});
+}
+
+
+// Runs the actions recorded by AndroidUserMobileSurfaceView.CommandBuffer in one JNI call.
+// Their canvas updates are merged into a single one issued at the end of the batch.  Like every
+// sync action, the batch runs on the action executor while this thread waits.
+static void executeCommands(JNIEnv *env, jclass cobj, jlong ptr, jobject buffer, jint size)
+{
+	TRACE_SCOPE("jni", "executeCommands");
+	SurfaceRegistry::Ref<UserMobileSurface> surface(ptr);
+	if (!surface)
+		return;
+
+	JNIHelpers::CommandReader in(env, buffer, size);
+
+	MobileApp::inst().actionExecutor().call([&]() {
+		surface->beginBatch();
+		while (in.next())
+		{
+			switch (in.opcode())
+			{
+			case 0:
+			{
+				surface->setOperatorOrbit();
+				break;
+			}
+			case 1:
+			{
+				surface->setOperatorZoomArea();
+				break;
+			}
+			case 2:
+			{
+				surface->setOperatorFly();
+				break;
+			}
+			case 3:
+			{
+				surface->setOperatorSelectPoint();
+				break;
+			}
+			case 4:
+			{
+				surface->setOperatorSelectArea();
+				break;
+			}
+			case 5:
+			{
+				surface->setOperatorSelectLasso();
+				break;
+			}
+			case 6:
+			{
+				surface->setOperatorPreselect();
+				break;
+			}
+			case 7:
+			{
+				int mode = in.readInt();
+				if (in.ok())
+					surface->setOperatorMeasure(mode);
+				break;
+			}
+			case 8:
+			{
+				surface->clearMeasurements();
+				break;
+			}
+			case 9:
+			{
+				surface->cancelClearance();
+				break;
+			}
+			case 10:
+			{
+				bool enable = in.readBool();
+				if (in.ok())
+					surface->onModeSimpleShadow(enable);
+				break;
+			}
+			case 11:
+			{
+				surface->onModeSmooth();
+				break;
+			}
+			case 12:
+			{
+				surface->onModeHiddenLine();
+				break;
+			}
+			case 13:
+			{
+				surface->onModeFrameRate();
+				break;
+			}
+			case 14:
+			{
+				surface->onModePerformanceHUD();
+				break;
+			}
+			case 15:
+			{
+				int style = in.readInt();
+				if (in.ok())
+					surface->unhighlightStyle(style);
+				break;
+			}
+			case 16:
+			{
+				surface->unhighlightAll();
+				break;
+			}
+			case 17:
+			{
+				int style = in.readInt();
+				float r = in.readFloat();
+				float g = in.readFloat();
+				float b = in.readFloat();
+				if (in.ok())
+					surface->setHighlightColor(style, r, g, b);
+				break;
+			}
+			case 18:
+			{
+				surface->cancelClashes();
+				break;
+			}
+			case 19:
+			{
+				surface->showAllItems();
+				break;
+			}
+			case 20:
+			{
+				surface->resetTouchLatency();
+				break;
+			}
+			case 21:
+			{
+				surface->resetSelectionLatency();
+				break;
+			}
+			case 22:
+			{
+				surface->startTouchRecording();
+				break;
+			}
+			case 23:
+			{
+				surface->onUserCode1();
+				break;
+			}
+			case 24:
+			{
+				surface->onUserCode2();
+				break;
+			}
+			case 25:
+			{
+				surface->onUserCode3();
+				break;
+			}
+			case 26:
+			{
+				surface->onUserCode4();
+				break;
+			}
+			default:
+				LOGE("Unknown command %d", in.opcode());
+				in.abort();
+				break;
+			}
+		}
+		surface->endBatch();
+	});
+
+	if (!in.ok())
+		LOGE("Command buffer is corrupt");
+}
+
 
 bool registerAndroidUserMobileSurfaceViewNatives(JNIEnv *env)
 {
@@ -138,19 +1362,86 @@ bool registerAndroidUserMobileSurfaceViewNatives(JNIEnv *env)
 
 	JNINativeMethod	methods[] = {
 		{"loadFileS", "(JLjava/lang/String;)Z", (void*)loadFileS},
+		{"generateSceneIIIFIFI", "(JIIIFIFI)Z", (void*)generateSceneIIIFIFI},
 		{"setOperatorOrbitV", "(J)V", (void*)setOperatorOrbitV},
 		{"setOperatorZoomAreaV", "(J)V", (void*)setOperatorZoomAreaV},
 		{"setOperatorFlyV", "(J)V", (void*)setOperatorFlyV},
 		{"setOperatorSelectPointV", "(J)V", (void*)setOperatorSelectPointV},
 		{"setOperatorSelectAreaV", "(J)V", (void*)setOperatorSelectAreaV},
+		{"setOperatorSelectLassoV", "(J)V", (void*)setOperatorSelectLassoV},
+		{"setOperatorPreselectV", "(J)V", (void*)setOperatorPreselectV},
+		{"setOperatorMeasureI", "(JI)V", (void*)setOperatorMeasureI},
+		{"clearMeasurementsV", "(J)V", (void*)clearMeasurementsV},
+		{"measureSelectionClearanceV", "(J)Z", (void*)measureSelectionClearanceV},
+		{"cancelClearanceV", "(J)V", (void*)cancelClearanceV},
 		{"onModeSimpleShadowZ", "(JZ)V", (void*)onModeSimpleShadowZ},
 		{"onModeSmoothV", "(J)V", (void*)onModeSmoothV},
 		{"onModeHiddenLineV", "(J)V", (void*)onModeHiddenLineV},
 		{"onModeFrameRateV", "(J)V", (void*)onModeFrameRateV},
+		{"onModePerformanceHUDV", "(J)V", (void*)onModePerformanceHUDV},
+		{"getSelectionBB", "(JLjava/nio/ByteBuffer;)I", (void*)getSelectionBB},
+		{"highlightSegmentsNamedSI", "(JLjava/lang/String;I)I", (void*)highlightSegmentsNamedSI},
+		{"unhighlightStyleI", "(JI)V", (void*)unhighlightStyleI},
+		{"unhighlightAllV", "(J)V", (void*)unhighlightAllV},
+		{"setHighlightColorIFFF", "(JIFFF)V", (void*)setHighlightColorIFFF},
+		{"detectClashesSSFI", "(JLjava/lang/String;Ljava/lang/String;FI)I", (void*)detectClashesSSFI},
+		{"cancelClashesV", "(J)V", (void*)cancelClashesV},
+		{"queryBoxFFFFFFZZ", "(JFFFFFFZZ)I", (void*)queryBoxFFFFFFZZ},
+		{"queryWindowFrustumFFFFZ", "(JFFFFZ)I", (void*)queryWindowFrustumFFFFZ},
+		{"getVolumeSetBB", "(JLjava/nio/ByteBuffer;)I", (void*)getVolumeSetBB},
+		{"hideOutsideVolumeSetV", "(J)I", (void*)hideOutsideVolumeSetV},
+		{"showAllItemsV", "(J)V", (void*)showAllItemsV},
+		{"highlightVolumeSetI", "(JI)I", (void*)highlightVolumeSetI},
+		{"getTouchLatencySFA", "(JLjava/lang/String;[F)I", (void*)getTouchLatencySFA},
+		{"resetTouchLatencyV", "(J)V", (void*)resetTouchLatencyV},
+		{"getSelectionLatencyFA", "(J[F)I", (void*)getSelectionLatencyFA},
+		{"resetSelectionLatencyV", "(J)V", (void*)resetSelectionLatencyV},
+		{"startTouchRecordingV", "(J)V", (void*)startTouchRecordingV},
+		{"stopTouchRecordingS", "(JLjava/lang/String;)Z", (void*)stopTouchRecordingS},
+		{"getReplayStatsFA", "(J[F)I", (void*)getReplayStatsFA},
 		{"onUserCode1V", "(J)V", (void*)onUserCode1V},
 		{"onUserCode2V", "(J)V", (void*)onUserCode2V},
 		{"onUserCode3V", "(J)V", (void*)onUserCode3V},
 		{"onUserCode4V", "(J)V", (void*)onUserCode4V},
+		{"loadFileSAsync", "(JLjava/lang/String;)I", (void*)loadFileSAsync},
+		{"generateSceneIIIFIFIAsync", "(JIIIFIFI)I", (void*)generateSceneIIIFIFIAsync},
+		{"setOperatorOrbitVAsync", "(J)I", (void*)setOperatorOrbitVAsync},
+		{"setOperatorZoomAreaVAsync", "(J)I", (void*)setOperatorZoomAreaVAsync},
+		{"setOperatorFlyVAsync", "(J)I", (void*)setOperatorFlyVAsync},
+		{"setOperatorSelectPointVAsync", "(J)I", (void*)setOperatorSelectPointVAsync},
+		{"setOperatorSelectAreaVAsync", "(J)I", (void*)setOperatorSelectAreaVAsync},
+		{"setOperatorSelectLassoVAsync", "(J)I", (void*)setOperatorSelectLassoVAsync},
+		{"setOperatorPreselectVAsync", "(J)I", (void*)setOperatorPreselectVAsync},
+		{"setOperatorMeasureIAsync", "(JI)I", (void*)setOperatorMeasureIAsync},
+		{"clearMeasurementsVAsync", "(J)I", (void*)clearMeasurementsVAsync},
+		{"measureSelectionClearanceVAsync", "(J)I", (void*)measureSelectionClearanceVAsync},
+		{"cancelClearanceVAsync", "(J)I", (void*)cancelClearanceVAsync},
+		{"onModeSimpleShadowZAsync", "(JZ)I", (void*)onModeSimpleShadowZAsync},
+		{"onModeSmoothVAsync", "(J)I", (void*)onModeSmoothVAsync},
+		{"onModeHiddenLineVAsync", "(J)I", (void*)onModeHiddenLineVAsync},
+		{"onModeFrameRateVAsync", "(J)I", (void*)onModeFrameRateVAsync},
+		{"onModePerformanceHUDVAsync", "(J)I", (void*)onModePerformanceHUDVAsync},
+		{"highlightSegmentsNamedSIAsync", "(JLjava/lang/String;I)I", (void*)highlightSegmentsNamedSIAsync},
+		{"unhighlightStyleIAsync", "(JI)I", (void*)unhighlightStyleIAsync},
+		{"unhighlightAllVAsync", "(J)I", (void*)unhighlightAllVAsync},
+		{"setHighlightColorIFFFAsync", "(JIFFF)I", (void*)setHighlightColorIFFFAsync},
+		{"detectClashesSSFIAsync", "(JLjava/lang/String;Ljava/lang/String;FI)I", (void*)detectClashesSSFIAsync},
+		{"cancelClashesVAsync", "(J)I", (void*)cancelClashesVAsync},
+		{"queryBoxFFFFFFZZAsync", "(JFFFFFFZZ)I", (void*)queryBoxFFFFFFZZAsync},
+		{"queryWindowFrustumFFFFZAsync", "(JFFFFZ)I", (void*)queryWindowFrustumFFFFZAsync},
+		{"hideOutsideVolumeSetVAsync", "(J)I", (void*)hideOutsideVolumeSetVAsync},
+		{"showAllItemsVAsync", "(J)I", (void*)showAllItemsVAsync},
+		{"highlightVolumeSetIAsync", "(JI)I", (void*)highlightVolumeSetIAsync},
+		{"resetTouchLatencyVAsync", "(J)I", (void*)resetTouchLatencyVAsync},
+		{"resetSelectionLatencyVAsync", "(J)I", (void*)resetSelectionLatencyVAsync},
+		{"startTouchRecordingVAsync", "(J)I", (void*)startTouchRecordingVAsync},
+		{"stopTouchRecordingSAsync", "(JLjava/lang/String;)I", (void*)stopTouchRecordingSAsync},
+		{"replayTouchesSZAsync", "(JLjava/lang/String;Z)I", (void*)replayTouchesSZAsync},
+		{"onUserCode1VAsync", "(J)I", (void*)onUserCode1VAsync},
+		{"onUserCode2VAsync", "(J)I", (void*)onUserCode2VAsync},
+		{"onUserCode3VAsync", "(J)I", (void*)onUserCode3VAsync},
+		{"onUserCode4VAsync", "(J)I", (void*)onUserCode4VAsync},
+		{"executeCommands", "(JLjava/nio/ByteBuffer;I)V", (void*)executeCommands},
 	};
 	const size_t	count = sizeof(methods) / sizeof(methods[0]);
 
@@ -0,0 +1,44 @@
+#include "AsyncActions.h"
+
+#include <atomic>
+#include <math.h>
+#include <stdexcept>
+
+#include "JNICallbacks.h"
+#include "MobileApp.h"
+#include "ThreadPlacement.h"
+#include "Trace.h"
+
+#include "dprintf.h"
+
+namespace
+{
+	std::atomic<jint>		nextRequestId(1);
+}
+
+jint AsyncActions::post(const char *name, SurfaceHandle surface, std::function<double()> action)
+{
+	jint const requestId = nextRequestId++;
+
+	MobileApp::inst().actionExecutor().post([=]() {
+		ThreadPlacement::apply(ThreadPlacement::Throughput);
+		MobileApp::inst().waitForWorld();
+
+		// A failed action still completes, with no result, like one on a destroyed surface
+		double result = NAN;
+		{
+			TRACE_SCOPE("async", name);
+			try
+			{
+				result = action();
+			}
+			catch (std::exception const & e)
+			{
+				eprintf("%s failed: %s\n", name, e.what());
+			}
+		}
+		JNICallbacks::invoke(surface, JNICallbacks::AsyncActionCompleted, requestId, result);
+	});
+
+	return requestId;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <jni.h>
+
+#include "SurfaceRegistry.h"
+
+#include <functional>
+
+// Support for the generated <action>Async variants of the SURFACE_ACTIONs.
+//
+// Each call queues the action on MobileApp's action executor and returns straight away
+//  with a request id.  When the action has run, its result is delivered to
+//  AndroidMobileSurfaceView.onAsyncActionCompleted(requestId, result) of the view of 'surface'
+//  through JNICallbacks.
+
+namespace AsyncActions
+{
+	// 'name' must be a string literal, it labels the action in traces.  The action's result is
+	//  returned as a double: booleans as 0 or 1, and 0 for void actions.  It is NaN when the
+	//  action threw, or when the surface is gone.
+	jint		post(const char *name, SurfaceHandle surface, std::function<double()> action);
+}
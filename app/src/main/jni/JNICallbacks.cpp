@@ -0,0 +1,179 @@
+#include "JNICallbacks.h"
+
+#include <android/log.h>
+#include <pthread.h>
+#include <stdarg.h>
+
+#include <mutex>
+
+#include "jpaths.h"
+
+#define  LOG_TAG    "JNICallbacks"
+#define  LOGE(...)  __android_log_print(ANDROID_LOG_ERROR,LOG_TAG,__VA_ARGS__)
+
+namespace
+{
+	struct MethodInfo
+	{
+		const char *	name;
+		const char *	signature;
+	};
+
+	// Indexed by JNICallbacks::Method
+	const MethodInfo		METHODS[] = {
+		{"ShowKeyboard", "()V"},
+		{"ShowPerformanceTestResult", "(F)V"},
+		{"onAsyncActionCompleted", "(ID)V"},
+		{"onSelectionCompleted", "(IIF)V"},
+		{"onClashProgress", "(III)V"},
+		{"onMeasurementCompleted", "(IF)V"},
+		{"onClearanceCompleted", "(F)V"},
+	};
+	static_assert(sizeof(METHODS) / sizeof(METHODS[0]) == JNICallbacks::MethodCount, "One entry per JNICallbacks::Method");
+
+	JavaVM *				javaVM = nullptr;
+	jmethodID				methodIDs[JNICallbacks::MethodCount];
+
+	struct Target
+	{
+		SurfaceHandle		surface;
+		jobject				view;			// Global reference
+	};
+
+	// Guards the targets: invoke() takes a local reference under it, so a view replaced
+	//  meanwhile is not collected during the call
+	std::mutex				targetMutex;
+	Target					targets[SurfaceRegistry::MAX_SURFACES];
+	SurfaceHandle			latestSurface = 0;
+
+	Target * findTarget(SurfaceHandle surface)
+	{
+		for (Target & target : targets) {
+			if (target.view != nullptr && target.surface == surface)
+				return &target;
+		}
+		return nullptr;
+	}
+
+	Target * freeTarget()
+	{
+		for (Target & target : targets) {
+			if (target.view == nullptr)
+				return &target;
+		}
+		return nullptr;
+	}
+
+	// Set for threads attached by getEnv(); its destructor detaches them when they exit
+	pthread_key_t			attachedKey;
+
+	void detachThread(void *)
+	{
+		javaVM->DetachCurrentThread();
+	}
+}
+
+bool JNICallbacks::initialize(JavaVM *vm, JNIEnv *env)
+{
+	javaVM = vm;
+
+	if (pthread_key_create(&attachedKey, detachThread) != 0) {
+		LOGE("Error creating thread key");
+		return false;
+	}
+
+	jclass k = env->FindClass(JPATH_ANDROID_MOBILE_SURFACE_VIEW);
+	if (k == NULL) {
+		LOGE("Error loading class %s", JPATH_ANDROID_MOBILE_SURFACE_VIEW);
+		return false;
+	}
+
+	for (int i = 0; i < MethodCount; ++i) {
+		methodIDs[i] = env->GetMethodID(k, METHODS[i].name, METHODS[i].signature);
+		if (methodIDs[i] == nullptr) {
+			LOGE("Error resolving %s%s", METHODS[i].name, METHODS[i].signature);
+			env->ExceptionClear();
+			return false;
+		}
+	}
+
+	env->DeleteLocalRef(k);
+	return true;
+}
+
+JNIEnv * JNICallbacks::getEnv()
+{
+	JNIEnv *env = nullptr;
+	int status = javaVM->GetEnv((void **)&env, JNI_VERSION_1_6);
+	if (status == JNI_OK)
+		return env;
+
+	if (status != JNI_EDETACHED || javaVM->AttachCurrentThread(&env, nullptr) != JNI_OK) {
+		LOGE("Error attaching thread");
+		return nullptr;
+	}
+
+	// Any non-null value makes the key destructor run on thread exit
+	pthread_setspecific(attachedKey, env);
+	return env;
+}
+
+void JNICallbacks::setTarget(JNIEnv *env, SurfaceHandle surface, jobject view)
+{
+	if (surface == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(targetMutex);
+	Target *target = findTarget(surface);
+	if (target == nullptr)
+		target = freeTarget();
+	if (target == nullptr)
+		return;
+
+	if (target->view != nullptr)
+		env->DeleteGlobalRef(target->view);
+	target->surface = surface;
+	target->view = env->NewGlobalRef(view);
+	latestSurface = surface;
+}
+
+void JNICallbacks::clearTarget(JNIEnv *env, SurfaceHandle surface)
+{
+	std::lock_guard<std::mutex> lock(targetMutex);
+	Target *target = findTarget(surface);
+	if (target == nullptr)
+		return;
+
+	env->DeleteGlobalRef(target->view);
+	target->view = nullptr;
+	target->surface = 0;
+}
+
+void JNICallbacks::invoke(SurfaceHandle surface, Method method, ...)
+{
+	JNIEnv *env = getEnv();
+	if (env == nullptr)
+		return;
+
+	jobject object = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(targetMutex);
+		Target const *target = findTarget(surface != 0 ? surface : latestSurface);
+		if (target != nullptr)
+			object = env->NewLocalRef(target->view);
+	}
+	if (object == nullptr)
+		return;
+
+	va_list args;
+	va_start(args, method);
+	env->CallVoidMethodV(object, methodIDs[method], args);
+	va_end(args);
+	env->DeleteLocalRef(object);
+
+	// An exception left pending would break every later call made by this thread
+	if (env->ExceptionCheck()) {
+		env->ExceptionDescribe();
+		env->ExceptionClear();
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <jni.h>
+
+#include "SurfaceRegistry.h"
+
+// Calls from native code (HPS event, driver and worker threads) back into Java.
+//
+// Method IDs are resolved once in JNI_OnLoad, and a thread calling into Java is attached
+// to the VM the first time and stays attached until it exits, when a pthread key
+// destructor detaches it.  A callback then costs a single Call<Type>Method, which keeps
+// frequent notifications (load progress, selection results, frame stats) cheap.
+//
+// Each surface has its own AndroidMobileSurfaceView target, replaced when the view is recreated
+// on rotation.  A callback made while the target changes still reaches a live view object.
+//
+// To add a callback: add an entry to Method, its name and signature to the table in
+// JNICallbacks.cpp, and a wrapper calling invoke().
+
+namespace JNICallbacks
+{
+	enum Method
+	{
+		ShowKeyboard,
+		ShowPerformanceTestResult,
+		AsyncActionCompleted,
+		SelectionCompleted,
+		ClashProgress,
+		MeasurementCompleted,
+		ClearanceCompleted,
+		MethodCount
+	};
+
+	// Called from JNI_OnLoad
+	bool		initialize(JavaVM *vm, JNIEnv *env);
+
+	// JNIEnv of the calling thread, attaching the thread if needed.  Returns nullptr on failure.
+	JNIEnv *	getEnv();
+
+	// AndroidMobileSurfaceView instance receiving the callbacks of 'surface'
+	void		setTarget(JNIEnv *env, SurfaceHandle surface, jobject view);
+	void		clearTarget(JNIEnv *env, SurfaceHandle surface);
+
+	// Calls a void method of the surface's target with the given arguments, from any thread.
+	//  Surface 0 stands for the latest target set, for events which belong to no surface.
+	void		invoke(SurfaceHandle surface, Method method, ...);
+}
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <string>
+#include <string.h>
+
+#include "DirectBuffer.h"
+
 namespace JNIHelpers
 {
 
@@ -60,14 +65,17 @@ private:
 	char *				_str;
 };
 
+// The array classes below pin a Java array for the duration of a call.  Arrays passed as
+// 'const' are read-only: they are released with JNI_ABORT, so no copy is written back.
+
 class IntArray {
 public:
-	IntArray(JNIEnv *env, jintArray arr) : _env(env), _arr(arr) {
+	IntArray(JNIEnv *env, jintArray arr, bool readOnly = false) : _env(env), _arr(arr), _readOnly(readOnly) {
 		_carr = _env->GetIntArrayElements(_arr, 0);
 	}
 
 	~IntArray() {
-		_env->ReleaseIntArrayElements(_arr, _carr, 0);
+		_env->ReleaseIntArrayElements(_arr, _carr, _readOnly ? JNI_ABORT : 0);
 	}
 
 	int *arr() {
@@ -77,17 +85,18 @@ public:
 private:
 	JNIEnv *			_env;
 	jintArray			_arr;
+	bool				_readOnly;
 	int *				_carr;
 };
 
 class LongArray {
 public:
-	LongArray(JNIEnv *env, jlongArray arr) : _env(env), _arr(arr) {
+	LongArray(JNIEnv *env, jlongArray arr, bool readOnly = false) : _env(env), _arr(arr), _readOnly(readOnly) {
 		_carr = _env->GetLongArrayElements(_arr, 0);
 	}
 
 	~LongArray() {
-		_env->ReleaseLongArrayElements(_arr, _carr, 0);
+		_env->ReleaseLongArrayElements(_arr, _carr, _readOnly ? JNI_ABORT : 0);
 	}
 
 	jlong *arr() {
@@ -97,17 +106,18 @@ public:
 private:
 	JNIEnv *			_env;
 	jlongArray			_arr;
+	bool				_readOnly;
 	jlong *				_carr;
 };
 
 class FloatArray {
 public:
-	FloatArray(JNIEnv *env, jfloatArray arr) : _env(env), _arr(arr) {
+	FloatArray(JNIEnv *env, jfloatArray arr, bool readOnly = false) : _env(env), _arr(arr), _readOnly(readOnly) {
 		_carr = _env->GetFloatArrayElements(_arr, 0);
 	}
 
 	~FloatArray() {
-		_env->ReleaseFloatArrayElements(_arr, _carr, 0);
+		_env->ReleaseFloatArrayElements(_arr, _carr, _readOnly ? JNI_ABORT : 0);
 	}
 
 	float *arr() {
@@ -117,17 +127,18 @@ public:
 private:
 	JNIEnv *			_env;
 	jfloatArray			_arr;
+	bool				_readOnly;
 	float *				_carr;
 };
 
 class DoubleArray {
 public:
-	DoubleArray(JNIEnv *env, jdoubleArray arr) : _env(env), _arr(arr) {
+	DoubleArray(JNIEnv *env, jdoubleArray arr, bool readOnly = false) : _env(env), _arr(arr), _readOnly(readOnly) {
 		_carr = _env->GetDoubleArrayElements(_arr, 0);
 	}
 
 	~DoubleArray() {
-		_env->ReleaseDoubleArrayElements(_arr, _carr, 0);
+		_env->ReleaseDoubleArrayElements(_arr, _carr, _readOnly ? JNI_ABORT : 0);
 	}
 
 	double *arr() {
@@ -137,17 +148,18 @@ public:
 private:
 	JNIEnv *			_env;
 	jdoubleArray		_arr;
+	bool				_readOnly;
 	double *			_carr;
 };
 
 class ByteArray {
 public:
-	ByteArray(JNIEnv *env, jbyteArray arr) : _env(env), _arr(arr) {
+	ByteArray(JNIEnv *env, jbyteArray arr, bool readOnly = false) : _env(env), _arr(arr), _readOnly(readOnly) {
 		_carr = _env->GetByteArrayElements(_arr, 0);
 	}
 
 	~ByteArray() {
-		_env->ReleaseByteArrayElements(_arr, _carr, 0);
+		_env->ReleaseByteArrayElements(_arr, _carr, _readOnly ? JNI_ABORT : 0);
 	}
 
 	// Note that jbyte is a 'signed char'
@@ -159,9 +171,140 @@ public:
 private:
 	JNIEnv *			_env;
 	jbyteArray			_arr;
+	bool				_readOnly;
 	jbyte *				_carr;
 };
 
+// Pins a Java array with GetPrimitiveArrayCritical, which avoids the copy Get<Type>ArrayElements
+// may make.  Until it is released the thread must not call JNI or block, and the GC may be held
+// off, so it is only used by actions declared *_ACTION_CRITICAL, which must return quickly.
+template <typename T, typename JArray>
+class CriticalArray {
+public:
+	CriticalArray(JNIEnv *env, JArray arr, bool readOnly = false) : _env(env), _arr(arr), _readOnly(readOnly) {
+		_carr = (T *)_env->GetPrimitiveArrayCritical(_arr, 0);
+	}
+
+	~CriticalArray() {
+		_env->ReleasePrimitiveArrayCritical(_arr, _carr, _readOnly ? JNI_ABORT : 0);
+	}
+
+	T *arr() {
+		return _carr;
+	}
+
+private:
+	JNIEnv *			_env;
+	JArray				_arr;
+	bool				_readOnly;
+	T *					_carr;
+};
+
+// Memory of a direct java.nio.ByteBuffer, used in place.  A non-direct buffer gives a null DirectBuffer.
+class ByteBuffer {
+public:
+	ByteBuffer(JNIEnv *env, jobject buffer) {
+		_buffer.data = buffer != 0 ? env->GetDirectBufferAddress(buffer) : 0;
+		jlong capacity = _buffer.data != 0 ? env->GetDirectBufferCapacity(buffer) : 0;
+		_buffer.size = capacity > 0 ? (size_t)capacity : 0;
+	}
+
+	DirectBuffer buffer() const {
+		return _buffer;
+	}
+
+private:
+	DirectBuffer		_buffer;
+};
+
+// Decodes the surface actions recorded by the generated Java CommandBuffer into a direct ByteBuffer.
+// Each command is an int opcode followed by its parameters in native byte order; booleans are one
+// byte and strings are an int byte count followed by the UTF-8 bytes.
+class CommandReader {
+public:
+	CommandReader(JNIEnv *env, jobject buffer, jint size) : _data(0), _size(0), _offset(0), _opcode(-1), _ok(true) {
+		_data = (const char *)env->GetDirectBufferAddress(buffer);
+		jlong capacity = env->GetDirectBufferCapacity(buffer);
+		if (_data != 0 && size >= 0 && size <= capacity)
+			_size = size;
+	}
+
+	// Reads the next opcode; false at the end of the buffer or after an error
+	bool next() {
+		if (!_ok || _offset >= _size)
+			return false;
+		_opcode = read<jint>();
+		return _ok;
+	}
+
+	int opcode() const {
+		return _opcode;
+	}
+
+	// False if the buffer ended in the middle of a command
+	bool ok() const {
+		return _ok;
+	}
+
+	void abort() {
+		_ok = false;
+	}
+
+	bool readBool() {
+		return read<jbyte>() != 0;
+	}
+
+	char readByte() {
+		return (char)read<jbyte>();
+	}
+
+	int readInt() {
+		return read<jint>();
+	}
+
+	long long readLong() {
+		return read<jlong>();
+	}
+
+	float readFloat() {
+		return read<jfloat>();
+	}
+
+	double readDouble() {
+		return read<jdouble>();
+	}
+
+	std::string readString() {
+		jint length = read<jint>();
+		if (!_ok || length < 0 || length > _size - _offset) {
+			_ok = false;
+			return std::string();
+		}
+		std::string s(_data + _offset, length);
+		_offset += length;
+		return s;
+	}
+
+private:
+	template <typename T>
+	T read() {
+		T value = T();
+		if (_offset + (jint)sizeof(T) > _size) {
+			_ok = false;
+			return value;
+		}
+		memcpy(&value, _data + _offset, sizeof(T));
+		_offset += sizeof(T);
+		return value;
+	}
+
+	const char *		_data;
+	jint				_size;
+	jint				_offset;
+	int					_opcode;
+	bool				_ok;
+};
+
 class ShowKeyboardHandler : public HPS::EventHandler
 {
 public:
@@ -5,18 +5,27 @@
 
 #include <jni.h>
 #include <android/log.h>
+#include <math.h>
 #include <stdio.h>
 
+#include <string>
+#include <vector>
+
 #include "jpaths.h"
 
 #define  JNI_LOG_TAG    "MobileApp"
 #define  LOGI(...)  __android_log_print(ANDROID_LOG_INFO,JNI_LOG_TAG,__VA_ARGS__)
 #define  LOGE(...)  __android_log_print(ANDROID_LOG_ERROR,JNI_LOG_TAG,__VA_ARGS__)
 
+#include "AsyncActions.h"
 #include "JNIHelpers.h"
+#include "MobileApp.h"
+#include "SurfaceRegistry.h"
+#include "Trace.h"
 
 static void setFontDirectoryS(JNIEnv *env, jclass cobj, jstring fontDir)
 {
+	TRACE_SCOPE("jni", "setFontDirectory");
 	JNIHelpers::String cfontDir(env, fontDir);
 	MobileApp::inst().setFontDirectory(cfontDir.str());
 	
@@ -25,12 +34,40 @@ static void setFontDirectoryS(JNIEnv *env, jclass cobj, jstring fontDir)
 
 static void setMaterialsDirectoryS(JNIEnv *env, jclass cobj, jstring materialsDir)
 {
+	TRACE_SCOPE("jni", "setMaterialsDirectory");
 	JNIHelpers::String cmaterialsDir(env, materialsDir);
 	MobileApp::inst().setMaterialsDirectory(cmaterialsDir.str());
 	
 }
 
 
+static void startTracingV(JNIEnv *env, jclass cobj)
+{
+	TRACE_SCOPE("jni", "startTracing");
+	
+	MobileApp::inst().startTracing();
+	
+}
+
+
+static jboolean stopTracingS(JNIEnv *env, jclass cobj, jstring traceFile)
+{
+	TRACE_SCOPE("jni", "stopTracing");
+	JNIHelpers::String ctraceFile(env, traceFile);
+	jboolean ret = MobileApp::inst().stopTracing(ctraceFile.str());
+	return ret;
+}
+
+
+static void setThreadPlacementIII(JNIEnv *env, jclass cobj, jint latencyCores, jint throughputCores, jint backgroundCores)
+{
+	TRACE_SCOPE("jni", "setThreadPlacement");
+	
+	MobileApp::inst().setThreadPlacement(latencyCores, throughputCores, backgroundCores);
+	
+}
+
+
 
 bool registerMobileAppNatives(JNIEnv *env)
 {
@@ -43,6 +80,9 @@ bool registerMobileAppNatives(JNIEnv *env)
 	JNINativeMethod	methods[] = {
 		{"setFontDirectoryS", "(Ljava/lang/String;)V", (void*)setFontDirectoryS},
 		{"setMaterialsDirectoryS", "(Ljava/lang/String;)V", (void*)setMaterialsDirectoryS},
+		{"startTracingV", "()V", (void*)startTracingV},
+		{"stopTracingS", "(Ljava/lang/String;)Z", (void*)stopTracingS},
+		{"setThreadPlacementIII", "(III)V", (void*)setThreadPlacementIII},
 	};
 	const size_t	count = sizeof(methods) / sizeof(methods[0]);
 
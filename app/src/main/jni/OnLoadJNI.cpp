@@ -3,9 +3,13 @@
 #include <android/log.h>
 #include <stdio.h>
 
-#define  LOG_TAG    "AndroidSandbox"
-#define  LOGI(...)  __android_log_print(ANDROID_LOG_INFO,LOG_TAG,__VA_ARGS__)
-#define  LOGE(...)  __android_log_print(ANDROID_LOG_ERROR,LOG_TAG,__VA_ARGS__)
+#include "JNICallbacks.h"
+#include "MobileApp.h"
+#include "Startup.h"
+
+#define  JNI_LOG_TAG    "AndroidSandbox"
+#define  LOGI(...)  __android_log_print(ANDROID_LOG_INFO,JNI_LOG_TAG,__VA_ARGS__)
+#define  LOGE(...)  __android_log_print(ANDROID_LOG_ERROR,JNI_LOG_TAG,__VA_ARGS__)
 
 bool registerMobileSurfaceViewNatives(JNIEnv *env);
 bool registerAndroidUserMobileSurfaceViewNatives(JNIEnv *env);
@@ -15,6 +19,8 @@ JavaVM *g_javaVM;
 
 JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved)
 {
+	Startup::reached(Startup::LibraryLoaded);
+
 	JNIEnv *env = NULL;
 	if ((vm->GetEnv((void**)&env, JNI_VERSION_1_6) != JNI_OK) || (env == NULL)) {
 		LOGE("Error calling GetEnv");
@@ -23,6 +29,9 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved)
 
 	g_javaVM = vm;
 
+	if (!JNICallbacks::initialize(vm, env))
+		return -1;
+
 	if (!registerMobileSurfaceViewNatives(env))
 		return -1;
 
@@ -32,6 +41,9 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved)
 	if (!registerMobileAppNatives(env))
 		return -1;
 
+	// Starts creating the HPS::World in the background, while Java sets up its activity
+	MobileApp::inst();
+
 	return JNI_VERSION_1_6;
 }
 
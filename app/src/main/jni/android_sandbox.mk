@@ -17,6 +17,11 @@ ifeq ($(USING_EXCHANGE),1)
 	LOCAL_CFLAGS += -DUSING_EXCHANGE=1
 endif
 
+# Set USING_TRACING := 1 to compile in the TRACE_* spans (see shared/Trace.h)
+ifeq ($(USING_TRACING),1)
+	LOCAL_CFLAGS += -DUSING_TRACING=1
+endif
+
 LOCAL_CPP_FEATURES := exceptions
 
 LOCAL_C_INCLUDES += ./jni/shared
@@ -30,10 +35,37 @@ $(info $(shell python $(TOP_PATH)/../../../../sip/sip.py))
 # --- MobileSurface Base & JNI files ---
 LOCAL_SRC_FILES += OnLoadJNI.cpp
 LOCAL_SRC_FILES += AndroidMobileSurfaceViewJNI.cpp
+LOCAL_SRC_FILES += JNICallbacks.cpp
+LOCAL_SRC_FILES += AsyncActions.cpp
 LOCAL_SRC_FILES += AndroidUserMobileSurfaceViewJNI.cpp		# Generated
 LOCAL_SRC_FILES += MobileAppJNI.cpp							# Generated
 LOCAL_SRC_FILES += shared/MobileApp.cpp
 LOCAL_SRC_FILES += shared/MobileSurface.cpp
+LOCAL_SRC_FILES += shared/Trace.cpp
+LOCAL_SRC_FILES += shared/PerformanceHUD.cpp
+LOCAL_SRC_FILES += shared/LatencyMonitor.cpp
+LOCAL_SRC_FILES += shared/TouchRecording.cpp
+LOCAL_SRC_FILES += shared/SceneGenerator.cpp
+LOCAL_SRC_FILES += shared/SerialExecutor.cpp
+LOCAL_SRC_FILES += shared/SurfaceRegistry.cpp
+LOCAL_SRC_FILES += shared/CpuTopology.cpp
+LOCAL_SRC_FILES += shared/TaskScheduler.cpp
+LOCAL_SRC_FILES += shared/ThreadPlacement.cpp
+LOCAL_SRC_FILES += shared/Startup.cpp
+LOCAL_SRC_FILES += shared/BVH.cpp
+LOCAL_SRC_FILES += shared/SpatialIndex.cpp
+LOCAL_SRC_FILES += shared/SelectionService.cpp
+LOCAL_SRC_FILES += shared/SelectionOperators.cpp
+LOCAL_SRC_FILES += shared/Preselection.cpp
+LOCAL_SRC_FILES += shared/HighlightStyles.cpp
+LOCAL_SRC_FILES += shared/SelectionBuffer.cpp
+LOCAL_SRC_FILES += shared/ClashDetector.cpp
+LOCAL_SRC_FILES += shared/KDTree.cpp
+LOCAL_SRC_FILES += shared/Snapper.cpp
+LOCAL_SRC_FILES += shared/Measurement.cpp
+LOCAL_SRC_FILES += shared/MinimumDistance.cpp
+LOCAL_SRC_FILES += shared/TriangleDistance.cpp
+LOCAL_SRC_FILES += shared/VolumeQuery.cpp
 # ---
 
 # --- User files ---
@@ -0,0 +1,704 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <utility>
+
+namespace
+{
+	const uint32_t		MAX_LEAF_ITEMS = 4;
+	const int			BIN_COUNT = 12;
+
+	// Deeper nodes stay leaves, which bounds the traversal stacks below
+	const uint32_t		MAX_DEPTH = 48;
+	const int			STACK_SIZE = 64;
+
+	// Distance along the ray to where it enters the box, or FLT_MAX if it misses
+	inline float slabs(float const nodeMin[3], float const nodeMax[3], float const origin[3], float const inverse[3], float limit)
+	{
+		float tmin = 0.0f;
+		float tmax = limit;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float const t0 = (nodeMin[axis] - origin[axis]) * inverse[axis];
+			float const t1 = (nodeMax[axis] - origin[axis]) * inverse[axis];
+			// Written so a NaN (ray in the plane of a slab) leaves the interval unchanged
+			tmin = std::max(tmin, std::min(t0, t1));
+			tmax = std::min(tmax, std::max(t0, t1));
+		}
+		return tmin <= tmax ? tmin : FLT_MAX;
+	}
+
+	inline float squaredDistance(float const nodeMin[3], float const nodeMax[3], float const point[3])
+	{
+		float d2 = 0.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float const d = std::max(std::max(nodeMin[axis] - point[axis], point[axis] - nodeMax[axis]), 0.0f);
+			d2 += d * d;
+		}
+		return d2;
+	}
+
+	inline float squaredDistance(float const aMin[3], float const aMax[3], float const bMin[3], float const bMax[3])
+	{
+		float d2 = 0.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float const d = std::max(std::max(aMin[axis] - bMax[axis], bMin[axis] - aMax[axis]), 0.0f);
+			d2 += d * d;
+		}
+		return d2;
+	}
+
+	enum Side
+	{
+		Outside,
+		Crossing,
+		Inside
+	};
+
+	// Box against a convex volume, plane by plane: conservative, a box near an edge of the
+	//  volume may be found crossing while it lies outside
+	inline Side side(float const boxMin[3], float const boxMax[3], std::vector<float> const & planes)
+	{
+		Side result = Inside;
+		for (size_t p = 0; p + 3 < planes.size(); p += 4)
+		{
+			float const * plane = &planes[p];
+			float nearest = plane[3], farthest = plane[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float const low = plane[axis] * boxMin[axis];
+				float const high = plane[axis] * boxMax[axis];
+				nearest += std::min(low, high);
+				farthest += std::max(low, high);
+			}
+			if (farthest < 0.0f)
+				return Outside;
+			if (nearest < 0.0f)
+				result = Crossing;
+		}
+		return result;
+	}
+
+	// Pair of nodes waiting in BVH::nearestPair(), nearest boxes first out of the heap
+	struct NodePair
+	{
+		float		distance;		// Squared, between the boxes
+		uint32_t	node;
+		uint32_t	otherNode;
+
+		bool operator<(NodePair const & pair) const { return distance > pair.distance; }
+	};
+
+	// Node or item waiting in the ordered BVH::raycast(), nearest entry first out of the heap
+	struct RayEntry
+	{
+		float		distance;		// Where the ray enters its box
+		uint32_t	index;
+		bool		item;
+
+		bool operator<(RayEntry const & entry) const { return distance > entry.distance; }
+	};
+
+	inline bool hitFarther(BVH::Hit const & a, BVH::Hit const & b)
+	{
+		return a.distance < b.distance;
+	}
+}
+
+BVH::Box BVH::Box::empty()
+{
+	Box box;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		box.min[axis] = FLT_MAX;
+		box.max[axis] = -FLT_MAX;
+	}
+	return box;
+}
+
+void BVH::Box::expand(Box const & box)
+{
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		min[axis] = std::min(min[axis], box.min[axis]);
+		max[axis] = std::max(max[axis], box.max[axis]);
+	}
+}
+
+void BVH::Box::expand(float const point[3])
+{
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		min[axis] = std::min(min[axis], point[axis]);
+		max[axis] = std::max(max[axis], point[axis]);
+	}
+}
+
+float BVH::Box::area() const
+{
+	if (isEmpty())
+		return 0.0f;
+	float const dx = max[0] - min[0];
+	float const dy = max[1] - min[1];
+	float const dz = max[2] - min[2];
+	return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+bool BVH::Box::overlaps(Box const & box) const
+{
+	return min[0] <= box.max[0] && box.min[0] <= max[0] &&
+		min[1] <= box.max[1] && box.min[1] <= max[1] &&
+		min[2] <= box.max[2] && box.min[2] <= max[2];
+}
+
+void BVH::clear()
+{
+	_nodes.clear();
+	_order.clear();
+	_boxes.clear();
+}
+
+void BVH::build(std::vector<Box> const & boxes)
+{
+	clear();
+	if (boxes.empty())
+		return;
+
+	_boxes = boxes;
+	uint32_t const count = (uint32_t)boxes.size();
+
+	_order.resize(count);
+	std::vector<float> centroids(3 * (size_t)count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		_order[i] = i;
+		for (int axis = 0; axis < 3; ++axis)
+			centroids[3 * i + axis] = 0.5f * (boxes[i].min[axis] + boxes[i].max[axis]);
+	}
+
+	// A binary tree with at least one item per leaf has at most 2n - 1 nodes
+	_nodes.reserve(2 * (size_t)count);
+
+	Node root;
+	root.first = 0;
+	root.count = count;
+	_nodes.push_back(root);
+	updateBounds(0);
+
+	// Depth first, with an explicit stack of (node, depth) so degenerate inputs cannot overflow the call stack
+	std::vector<std::pair<uint32_t, uint32_t>> pending(1, std::make_pair(0u, 0u));
+	while (!pending.empty())
+	{
+		uint32_t const node = pending.back().first;
+		uint32_t const depth = pending.back().second;
+		pending.pop_back();
+
+		if (depth >= MAX_DEPTH)
+			continue;
+
+		subdivide(node, centroids);
+		if (_nodes[node].count == 0)
+		{
+			pending.push_back(std::make_pair(_nodes[node].first, depth + 1));
+			pending.push_back(std::make_pair(_nodes[node].first + 1, depth + 1));
+		}
+	}
+}
+
+void BVH::refit(std::vector<Box> const & boxes)
+{
+	if (boxes.size() != _boxes.size())
+	{
+		build(boxes);
+		return;
+	}
+
+	// Children are always stored after their parent
+	_boxes = boxes;
+	for (size_t node = _nodes.size(); node-- > 0; )
+		updateBounds((uint32_t)node);
+}
+
+void BVH::updateBounds(uint32_t node)
+{
+	Node & n = _nodes[node];
+	Box box = Box::empty();
+	if (n.count > 0)
+	{
+		for (uint32_t i = 0; i < n.count; ++i)
+			box.expand(_boxes[_order[n.first + i]]);
+	}
+	else
+	{
+		for (uint32_t child = n.first; child < n.first + 2; ++child)
+		{
+			Box childBox;
+			std::copy(_nodes[child].min, _nodes[child].min + 3, childBox.min);
+			std::copy(_nodes[child].max, _nodes[child].max + 3, childBox.max);
+			box.expand(childBox);
+		}
+	}
+	std::copy(box.min, box.min + 3, n.min);
+	std::copy(box.max, box.max + 3, n.max);
+}
+
+void BVH::subdivide(uint32_t node, std::vector<float> const & centroids)
+{
+	uint32_t const first = _nodes[node].first;
+	uint32_t const count = _nodes[node].count;
+	if (count <= MAX_LEAF_ITEMS)
+		return;
+
+	// Bin the centroids along each axis and keep the cheapest split
+	Box centroidBounds = Box::empty();
+	for (uint32_t i = 0; i < count; ++i)
+		centroidBounds.expand(&centroids[3 * (size_t)_order[first + i]]);
+
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	int bestSplit = 0;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float const extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+		if (extent <= 0.0f)
+			continue;
+
+		Box binBoxes[BIN_COUNT];
+		uint32_t binCounts[BIN_COUNT] = {};
+		for (int b = 0; b < BIN_COUNT; ++b)
+			binBoxes[b] = Box::empty();
+
+		float const scale = BIN_COUNT / extent;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			uint32_t const item = _order[first + i];
+			int const b = std::min(BIN_COUNT - 1, (int)((centroids[3 * (size_t)item + axis] - centroidBounds.min[axis]) * scale));
+			binBoxes[b].expand(_boxes[item]);
+			++binCounts[b];
+		}
+
+		// Sweep from the right to get the cost of every right side, then from the left
+		float rightAreas[BIN_COUNT];
+		uint32_t rightCounts[BIN_COUNT];
+		Box right = Box::empty();
+		uint32_t rightCount = 0;
+		for (int b = BIN_COUNT - 1; b > 0; --b)
+		{
+			right.expand(binBoxes[b]);
+			rightCount += binCounts[b];
+			rightAreas[b] = right.area();
+			rightCounts[b] = rightCount;
+		}
+
+		Box left = Box::empty();
+		uint32_t leftCount = 0;
+		for (int b = 0; b < BIN_COUNT - 1; ++b)
+		{
+			left.expand(binBoxes[b]);
+			leftCount += binCounts[b];
+			if (leftCount == 0 || rightCounts[b + 1] == 0)
+				continue;
+
+			float const cost = left.area() * leftCount + rightAreas[b + 1] * rightCounts[b + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b + 1;
+			}
+		}
+	}
+
+	Box nodeBox;
+	std::copy(_nodes[node].min, _nodes[node].min + 3, nodeBox.min);
+	std::copy(_nodes[node].max, _nodes[node].max + 3, nodeBox.max);
+
+	uint32_t leftCount;
+	if (bestAxis < 0 || bestCost >= nodeBox.area() * count)
+	{
+		// No split beats a leaf; split large leaves at the median of the longest axis anyway so
+		//  queries stay bounded
+		if (count <= 4 * MAX_LEAF_ITEMS)
+			return;
+
+		int axis = 0;
+		for (int a = 1; a < 3; ++a)
+		{
+			if (centroidBounds.max[a] - centroidBounds.min[a] > centroidBounds.max[axis] - centroidBounds.min[axis])
+				axis = a;
+		}
+
+		leftCount = count / 2;
+		uint32_t * const begin = &_order[first];
+		std::nth_element(begin, begin + leftCount, begin + count, [&](uint32_t a, uint32_t b) {
+			return centroids[3 * (size_t)a + axis] < centroids[3 * (size_t)b + axis];
+		});
+	}
+	else
+	{
+		float const scale = BIN_COUNT / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+		uint32_t * const begin = &_order[first];
+		uint32_t * const middle = std::partition(begin, begin + count, [&](uint32_t item) {
+			int const b = std::min(BIN_COUNT - 1, (int)((centroids[3 * (size_t)item + bestAxis] - centroidBounds.min[bestAxis]) * scale));
+			return b < bestSplit;
+		});
+		leftCount = (uint32_t)(middle - begin);
+	}
+
+	uint32_t const left = (uint32_t)_nodes.size();
+	Node child;
+	child.first = first;
+	child.count = leftCount;
+	_nodes.push_back(child);
+	child.first = first + leftCount;
+	child.count = count - leftCount;
+	_nodes.push_back(child);
+
+	_nodes[node].first = left;
+	_nodes[node].count = 0;
+	updateBounds(left);
+	updateBounds(left + 1);
+}
+
+size_t BVH::raycast(float const origin[3], float const direction[3], size_t maxHits, std::vector<Hit> & hits) const
+{
+	hits.clear();
+	if (_nodes.empty() || maxHits == 0)
+		return 0;
+
+	float const inverse[3] = {1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2]};
+
+	// 'hits' is kept as a heap with the farthest hit on top while it is full, to prune farther nodes
+	uint32_t stack[STACK_SIZE];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		Node const & n = _nodes[stack[--top]];
+		float const limit = hits.size() == maxHits ? hits.front().distance : FLT_MAX;
+		if (slabs(n.min, n.max, origin, inverse, limit) == FLT_MAX)
+			continue;
+
+		if (n.count > 0)
+		{
+			for (uint32_t i = 0; i < n.count; ++i)
+			{
+				uint32_t const item = _order[n.first + i];
+				float const itemLimit = hits.size() == maxHits ? hits.front().distance : FLT_MAX;
+				float const distance = slabs(_boxes[item].min, _boxes[item].max, origin, inverse, itemLimit);
+				if (distance == FLT_MAX)
+					continue;
+
+				if (hits.size() == maxHits)
+				{
+					std::pop_heap(hits.begin(), hits.end(), hitFarther);
+					hits.pop_back();
+				}
+				Hit hit = {item, distance};
+				hits.push_back(hit);
+				std::push_heap(hits.begin(), hits.end(), hitFarther);
+			}
+			continue;
+		}
+
+		// Visit the nearer child first so the heap fills with close hits early
+		Node const & a = _nodes[n.first];
+		Node const & b = _nodes[n.first + 1];
+		float const da = slabs(a.min, a.max, origin, inverse, FLT_MAX);
+		float const db = slabs(b.min, b.max, origin, inverse, FLT_MAX);
+		uint32_t const nearChild = da <= db ? n.first : n.first + 1;
+		uint32_t const farChild = da <= db ? n.first + 1 : n.first;
+		if (std::max(da, db) != FLT_MAX && top < STACK_SIZE - 1)
+			stack[top++] = farChild;
+		if (std::min(da, db) != FLT_MAX && top < STACK_SIZE)
+			stack[top++] = nearChild;
+	}
+
+	std::sort_heap(hits.begin(), hits.end(), hitFarther);
+	return hits.size();
+}
+
+void BVH::raycast(float const origin[3], float const direction[3], RayVisitor const & visit) const
+{
+	if (_nodes.empty())
+		return;
+
+	float const inverse[3] = {1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2]};
+	float limit = FLT_MAX;
+
+	std::vector<RayEntry> heap;
+	float const rootDistance = slabs(_nodes[0].min, _nodes[0].max, origin, inverse, limit);
+	if (rootDistance != FLT_MAX)
+		heap.push_back(RayEntry{rootDistance, 0, false});
+
+	auto push = [&heap](float distance, uint32_t index, bool item) {
+		if (distance == FLT_MAX)
+			return;
+		heap.push_back(RayEntry{distance, index, item});
+		std::push_heap(heap.begin(), heap.end());
+	};
+
+	while (!heap.empty())
+	{
+		std::pop_heap(heap.begin(), heap.end());
+		RayEntry const entry = heap.back();
+		heap.pop_back();
+		if (entry.distance > limit)
+			break;
+
+		if (entry.item)
+		{
+			limit = visit(entry.index, entry.distance);
+			continue;
+		}
+
+		Node const & n = _nodes[entry.index];
+		if (n.count > 0)
+		{
+			for (uint32_t i = 0; i < n.count; ++i)
+			{
+				uint32_t const item = _order[n.first + i];
+				push(slabs(_boxes[item].min, _boxes[item].max, origin, inverse, limit), item, true);
+			}
+		}
+		else
+		{
+			for (uint32_t child = n.first; child < n.first + 2; ++child)
+				push(slabs(_nodes[child].min, _nodes[child].max, origin, inverse, limit), child, false);
+		}
+	}
+}
+
+size_t BVH::overlap(Box const & box, std::vector<uint32_t> & items) const
+{
+	items.clear();
+	if (_nodes.empty())
+		return 0;
+
+	uint32_t stack[STACK_SIZE];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		Node const & n = _nodes[stack[--top]];
+		if (n.min[0] > box.max[0] || box.min[0] > n.max[0] ||
+			n.min[1] > box.max[1] || box.min[1] > n.max[1] ||
+			n.min[2] > box.max[2] || box.min[2] > n.max[2])
+			continue;
+
+		if (n.count > 0)
+		{
+			for (uint32_t i = 0; i < n.count; ++i)
+			{
+				uint32_t const item = _order[n.first + i];
+				if (_boxes[item].overlaps(box))
+					items.push_back(item);
+			}
+		}
+		else if (top < STACK_SIZE - 1)
+		{
+			stack[top++] = n.first;
+			stack[top++] = n.first + 1;
+		}
+	}
+
+	return items.size();
+}
+
+size_t BVH::volume(std::vector<float> const & planes, std::vector<uint32_t> & inside, std::vector<uint32_t> & crossing) const
+{
+	inside.clear();
+	crossing.clear();
+	if (_nodes.empty())
+		return 0;
+
+	uint32_t stack[STACK_SIZE];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		uint32_t const node = stack[--top];
+		Node const & n = _nodes[node];
+		Side const nodeSide = side(n.min, n.max, planes);
+		if (nodeSide == Outside)
+			continue;
+
+		if (nodeSide == Inside)
+		{
+			// Inner nodes keep no item range of their own, so walk down to the leaves
+			uint32_t subtree[STACK_SIZE];
+			int subtreeTop = 0;
+			subtree[subtreeTop++] = node;
+			while (subtreeTop > 0)
+			{
+				Node const & s = _nodes[subtree[--subtreeTop]];
+				if (s.count > 0)
+					inside.insert(inside.end(), _order.begin() + s.first, _order.begin() + s.first + s.count);
+				else if (subtreeTop < STACK_SIZE - 1)
+				{
+					subtree[subtreeTop++] = s.first;
+					subtree[subtreeTop++] = s.first + 1;
+				}
+			}
+			continue;
+		}
+
+		if (n.count > 0)
+		{
+			for (uint32_t i = 0; i < n.count; ++i)
+			{
+				uint32_t const item = _order[n.first + i];
+				Side const itemSide = side(_boxes[item].min, _boxes[item].max, planes);
+				if (itemSide == Inside)
+					inside.push_back(item);
+				else if (itemSide == Crossing)
+					crossing.push_back(item);
+			}
+		}
+		else if (top < STACK_SIZE - 1)
+		{
+			stack[top++] = n.first;
+			stack[top++] = n.first + 1;
+		}
+	}
+
+	return inside.size() + crossing.size();
+}
+
+bool BVH::nearest(float const point[3], float maxDistance, uint32_t & item, float & distance) const
+{
+	if (_nodes.empty())
+		return false;
+
+	float best = maxDistance * maxDistance;
+	bool found = false;
+
+	uint32_t stack[STACK_SIZE];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		Node const & n = _nodes[stack[--top]];
+		if (squaredDistance(n.min, n.max, point) > best)
+			continue;
+
+		if (n.count > 0)
+		{
+			for (uint32_t i = 0; i < n.count; ++i)
+			{
+				uint32_t const candidate = _order[n.first + i];
+				float const d2 = squaredDistance(_boxes[candidate].min, _boxes[candidate].max, point);
+				if (d2 <= best)
+				{
+					best = d2;
+					item = candidate;
+					found = true;
+				}
+			}
+			continue;
+		}
+
+		Node const & a = _nodes[n.first];
+		Node const & b = _nodes[n.first + 1];
+		float const da = squaredDistance(a.min, a.max, point);
+		float const db = squaredDistance(b.min, b.max, point);
+		if (top < STACK_SIZE - 1)
+		{
+			stack[top++] = da <= db ? n.first + 1 : n.first;
+			stack[top++] = da <= db ? n.first : n.first + 1;
+		}
+	}
+
+	if (found)
+		distance = sqrtf(best);
+	return found;
+}
+
+bool BVH::nearestPair(BVH const & other, float maxDistance, PairDistance const & distance,
+	uint32_t & item, uint32_t & otherItem, float & best, std::atomic<bool> const * cancelled) const
+{
+	if (_nodes.empty() || other._nodes.empty())
+		return false;
+
+	auto area = [](Node const & node) {
+		float const dx = node.max[0] - node.min[0];
+		float const dy = node.max[1] - node.min[1];
+		float const dz = node.max[2] - node.min[2];
+		return dx * dy + dy * dz + dz * dx;
+	};
+
+	float best2 = maxDistance < sqrtf(FLT_MAX) ? maxDistance * maxDistance : FLT_MAX;
+	bool found = false;
+
+	std::vector<NodePair> heap;
+	heap.push_back(NodePair{squaredDistance(_nodes[0].min, _nodes[0].max, other._nodes[0].min, other._nodes[0].max), 0, 0});
+
+	while (!heap.empty())
+	{
+		if (cancelled != nullptr && cancelled->load(std::memory_order_relaxed))
+			return false;
+
+		std::pop_heap(heap.begin(), heap.end());
+		NodePair const pair = heap.back();
+		heap.pop_back();
+		if (pair.distance > best2)
+			break;
+
+		Node const & a = _nodes[pair.node];
+		Node const & b = other._nodes[pair.otherNode];
+
+		if (a.count > 0 && b.count > 0)
+		{
+			for (uint32_t i = 0; i < a.count; ++i)
+			{
+				uint32_t const candidate = _order[a.first + i];
+				Box const & box = _boxes[candidate];
+				for (uint32_t j = 0; j < b.count; ++j)
+				{
+					uint32_t const otherCandidate = other._order[b.first + j];
+					Box const & otherBox = other._boxes[otherCandidate];
+					if (squaredDistance(box.min, box.max, otherBox.min, otherBox.max) > best2)
+						continue;
+
+					float const d = distance(candidate, otherCandidate);
+					if (d < FLT_MAX && d * d <= best2)
+					{
+						best2 = d * d;
+						best = d;
+						item = candidate;
+						otherItem = otherCandidate;
+						found = true;
+					}
+				}
+			}
+			continue;
+		}
+
+		// Open the larger node, or the one which is not a leaf
+		bool const openFirst = b.count > 0 || (a.count == 0 && area(a) >= area(b));
+		for (uint32_t child = 0; child < 2; ++child)
+		{
+			NodePair next = pair;
+			if (openFirst)
+				next.node = a.first + child;
+			else
+				next.otherNode = b.first + child;
+
+			Node const & na = _nodes[next.node];
+			Node const & nb = other._nodes[next.otherNode];
+			next.distance = squaredDistance(na.min, na.max, nb.min, nb.max);
+			if (next.distance <= best2)
+			{
+				heap.push_back(next);
+				std::push_heap(heap.begin(), heap.end());
+			}
+		}
+	}
+
+	return found;
+}
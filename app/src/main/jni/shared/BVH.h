@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+// BVH is a bounding volume hierarchy over axis-aligned boxes, used by SpatialIndex to answer
+//  picks and proximity queries without going through HPS selection.
+//
+// Nodes are stored flattened in one array, 32 bytes each, with the two children of a node next
+//  to each other.  Each node keeps its box as min/max float triples, each followed by a 32-bit
+//  index, so the slab tests can load them as 16-byte aligned 4-wide vectors.  The tree
+//  is built with a binned surface area heuristic.
+//
+// Items are identified by their index in the boxes given to build().  A BVH is not thread
+//  safe: concurrent queries are fine, but build() and refit() need exclusive access.
+
+class BVH
+{
+public:
+	struct Box
+	{
+		float		min[3];
+		float		max[3];
+
+		static Box	empty();
+		bool		isEmpty() const { return min[0] > max[0]; }
+		void		expand(Box const & box);
+		void		expand(float const point[3]);
+		float		area() const;
+		bool		overlaps(Box const & box) const;
+	};
+
+	struct Hit
+	{
+		uint32_t	item;
+		float		distance;		// Along the ray, where it enters the item's box
+	};
+
+	void			build(std::vector<Box> const & boxes);
+	void			clear();
+
+	// Replaces the item boxes, as many as build() was given, and recomputes the node boxes bottom
+	//  up while keeping the tree's shape.  Much cheaper than build(), but queries slow down as
+	//  items drift away from where the tree was built for.
+	void			refit(std::vector<Box> const & boxes);
+
+	size_t			itemCount() const { return _boxes.size(); }
+	size_t			nodeCount() const { return _nodes.size(); }
+	Box const &		bounds(uint32_t item) const { return _boxes[item]; }
+
+	// Items whose box is crossed by the ray, nearest first, at most maxHits of them.  'direction'
+	//  need not be normalized; distances are then in units of its length.
+	size_t			raycast(float const origin[3], float const direction[3], size_t maxHits, std::vector<Hit> & hits) const;
+
+	// Called with each item whose box the ray crosses, in order of where the ray enters them.  It
+	//  returns how far along the ray later items are still wanted, FLT_MAX for all of them.
+	typedef std::function<float(uint32_t item, float distance)>	RayVisitor;
+
+	// Same, without a limit on the number of hits: items are visited nearest box first until the
+	//  next box starts beyond what 'visit' last returned
+	void			raycast(float const origin[3], float const direction[3], RayVisitor const & visit) const;
+
+	// Items whose box overlaps 'box'
+	size_t			overlap(Box const & box, std::vector<uint32_t> & items) const;
+
+	// Items whose box touches the convex volume bounded by 'planes', four coefficients (a, b, c, d)
+	//  per plane, inside being where a x + b y + c z + d >= 0 for every plane.  They are split between those whose
+	//  box lies inside the volume and those which cross, or may cross, its boundary.  A node
+	//  inside the volume takes all its items without testing them.
+	size_t			volume(std::vector<float> const & planes, std::vector<uint32_t> & inside, std::vector<uint32_t> & crossing) const;
+
+	// Item whose box is closest to 'point', if one lies within maxDistance
+	bool			nearest(float const point[3], float maxDistance, uint32_t & item, float & distance) const;
+
+	// Exact distance between an item of this tree and one of another, or FLT_MAX to skip the pair
+	typedef std::function<float(uint32_t item, uint32_t otherItem)>	PairDistance;
+
+	// Closest pair of items, one from each tree, if one lies within maxDistance.  Pairs of nodes
+	//  are visited nearest boxes first, and the search ends once the nearest boxes left are
+	//  farther than the best pair found; 'distance' is only called for items whose boxes are
+	//  nearer than that.  Returns false, too, once 'cancelled' is set.
+	bool			nearestPair(BVH const & other, float maxDistance, PairDistance const & distance,
+						uint32_t & item, uint32_t & otherItem, float & best, std::atomic<bool> const * cancelled = nullptr) const;
+
+private:
+	struct alignas(16) Node
+	{
+		float		min[3];
+		uint32_t	first;		// Leaf: first entry in _order.  Inner node: left child, the right one follows.
+		float		max[3];
+		uint32_t	count;		// Items in a leaf, 0 for inner nodes
+	};
+
+	static_assert(sizeof(Node) == 32, "BVH::Node should stay 32 bytes");
+
+	void			updateBounds(uint32_t node);
+	void			subdivide(uint32_t node, std::vector<float> const & centroids);
+
+	std::vector<Node>		_nodes;
+	std::vector<uint32_t>	_order;			// Item indices, contiguous per leaf
+	std::vector<Box>		_boxes;
+};
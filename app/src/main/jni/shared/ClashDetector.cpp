@@ -0,0 +1,270 @@
+#include "ClashDetector.h"
+#include "HighlightStyles.h"
+#include "MobileApp.h"
+#include "Trace.h"
+#include "TriangleDistance.h"
+
+#include <unordered_set>
+
+#include "dprintf.h"
+
+// Implemented by the gui
+void ShowClashProgress(SurfaceHandle surface, int tested, int total, int clashes);
+
+namespace
+{
+	// True if a segment above the shell has 'name' in its name
+	bool inGroup(SpatialIndex::Item const & item, std::string const & name)
+	{
+		if (name.empty())
+			return true;
+
+		auto matches = [&name](HPS::SegmentKey segment) {
+			for (; segment.Type() != HPS::Type::None; segment = segment.Owner())
+			{
+				if (strstr(segment.Name().GetBytes(), name.c_str()) != nullptr)
+					return true;
+			}
+			return false;
+		};
+
+		// Shells reached through includes are named by the segments including them as well
+		if (matches(item.shell.Owner()))
+			return true;
+		for (auto const & include : item.includes)
+		{
+			if (matches(include.Owner()))
+				return true;
+		}
+		return false;
+	}
+
+	// True if a triangle of one instance comes within 'tolerance' of a triangle of the other
+	bool touches(SpatialIndex::Instance const & first, SpatialIndex::Instance const & second, float tolerance,
+		std::atomic<bool> const & cancelled)
+	{
+		std::vector<Triangle> firstTriangles, secondTriangles;
+		if (appendTriangles(first.item.shell, first.matrix, firstTriangles) == 0 ||
+			appendTriangles(second.item.shell, second.matrix, secondTriangles) == 0)
+			return false;
+
+		std::vector<BVH::Box> boxes;
+		boxes.reserve(secondTriangles.size());
+		for (auto const & triangle : secondTriangles)
+			boxes.push_back(triangle.bounds());
+		BVH bvh;
+		bvh.build(boxes);
+
+		float const tolerance2 = tolerance * tolerance;
+		std::vector<uint32_t> near;
+		for (auto const & triangle : firstTriangles)
+		{
+			if (cancelled.load(std::memory_order_relaxed))
+				return false;
+
+			BVH::Box box = triangle.bounds();
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				box.min[axis] -= tolerance;
+				box.max[axis] += tolerance;
+			}
+
+			bvh.overlap(box, near);
+			for (uint32_t other : near)
+			{
+				float onFirst[3], onSecond[3];
+				if (triangleDistance(triangle, secondTriangles[other], onFirst, onSecond) <= tolerance2)
+					return true;
+			}
+		}
+		return false;
+	}
+
+	// True if 'inner' lies inside 'outer', once their surfaces are known not to meet: then any
+	//  vertex of 'inner' tells
+	bool encloses(SpatialIndex::Instance const & outer, SpatialIndex::Instance const & inner, HPS::ShellRelationOptionsKit const & options)
+	{
+		HPS::PointArray vertices;
+		inner.item.shell.ShowPoints(vertices);
+		if (vertices.empty())
+			return false;
+
+		// Object space of the inner shell to the outer's: through world space
+		HPS::MatrixKit outerInverse;
+		outer.matrix.ShowInverse(outerInverse);
+		HPS::PointArray const vertex(1, inner.matrix.Multiply(outerInverse).Transform(vertices.front()));
+
+		HPS::ShellRelationResultsKit results;
+		outer.item.shell.ComputeRelation(vertex, options, results);
+
+		HPS::ShellRelationArray relations;
+		results.ShowRelations(relations);
+		return !relations.empty() && relations.front() == HPS::Shell::Relation::In;
+	}
+}
+
+struct ClashDetector::Job
+{
+	HPS::Canvas							canvas;
+	SurfaceHandle						surface;
+	float								tolerance;
+	HPS::ShellRelationOptionsKit		options;
+	int									style;
+	std::vector<SpatialIndex::Pair>		pairs;
+
+	std::atomic<bool>					cancelled;
+	std::atomic<int>					tested;
+
+	std::mutex							mutex;
+	std::vector<Clash>					clashes;
+
+	// Items highlighted so far: an item in several clashes is highlighted once
+	std::unordered_set<SpatialIndex::Item, SpatialIndex::ItemHasher>	highlighted;
+
+	Job() : surface(0), tolerance(0), style(0), cancelled(false), tested(0) {}
+};
+
+ClashDetector::ClashDetector(SpatialIndex const & index, HighlightStyles const & styles)
+	: _index(index), _styles(styles)
+{
+}
+
+ClashDetector::~ClashDetector()
+{
+	cancel();
+}
+
+int ClashDetector::start(HPS::Canvas const & canvas, SurfaceHandle surface, std::string const & firstGroup, std::string const & secondGroup, float tolerance, int style)
+{
+	cancel();
+
+	if (!_index.isReady() || !HighlightStyles::isValid(style))
+		return -1;
+
+	TRACE_SCOPE("clash", "ClashDetector::start");
+
+	std::shared_ptr<Job> job(new Job());
+	job->canvas = canvas;
+	job->surface = surface;
+	job->style = style;
+	job->tolerance = tolerance;
+	job->options.SetTest(HPS::Shell::RelationTest::Enclosure);
+
+	_index.overlappingPairs(
+		[&firstGroup](SpatialIndex::Item const & item) { return inGroup(item, firstGroup); },
+		[&secondGroup](SpatialIndex::Item const & item) { return inGroup(item, secondGroup); },
+		tolerance, job->pairs);
+
+	// The previous clashes go away with the next update
+	HighlightBatch batch;
+	batch.clear(style);
+	batch.apply(_styles, canvas);
+
+	dprintf("Clash detection: %u candidate pairs\n", (unsigned)job->pairs.size());
+	ShowClashProgress(surface, 0, (int)job->pairs.size(), 0);
+
+	TaskScheduler & scheduler = MobileApp::inst().scheduler();
+	std::lock_guard<std::mutex> lock(_mutex);
+	_job = job;
+	for (size_t begin = 0; begin < job->pairs.size(); begin += PAIRS_PER_TASK)
+	{
+		size_t const end = std::min(begin + PAIRS_PER_TASK, job->pairs.size());
+		_tasks.push_back(scheduler.submit(TaskScheduler::Background, [this, job, begin, end] {
+			test(job, begin, end);
+		}));
+	}
+	return (int)job->pairs.size();
+}
+
+void ClashDetector::test(std::shared_ptr<Job> const & job, size_t begin, size_t end)
+{
+	TRACE_SCOPE("clash", "ClashDetector::test");
+
+	std::vector<Clash> found;
+	for (size_t p = begin; p < end && !job->cancelled.load(); ++p)
+	{
+		SpatialIndex::Pair const & pair = job->pairs[p];
+
+		if (touches(pair.first, pair.second, job->tolerance, job->cancelled) ||
+			encloses(pair.first, pair.second, job->options) || encloses(pair.second, pair.first, job->options))
+		{
+			Clash clash;
+			clash.first = pair.first.item;
+			clash.second = pair.second.item;
+			found.push_back(clash);
+		}
+	}
+
+	if (job->cancelled.load())
+		return;
+
+	int const tested = (job->tested += (int)(end - begin));
+	int clashes;
+	{
+		std::lock_guard<std::mutex> lock(job->mutex);
+		job->clashes.insert(job->clashes.end(), found.begin(), found.end());
+		clashes = (int)job->clashes.size();
+
+		HighlightBatch batch;
+		for (auto const & clash : found)
+		{
+			if (job->highlighted.insert(clash.first).second)
+				batch.add(job->style, SpatialIndex::keyPath(clash.first, job->canvas));
+			if (job->highlighted.insert(clash.second).second)
+				batch.add(job->style, SpatialIndex::keyPath(clash.second, job->canvas));
+		}
+		if (!batch.isEmpty())
+		{
+			batch.apply(_styles, job->canvas);
+			job->canvas.Update();
+		}
+	}
+
+	ShowClashProgress(job->surface, tested, (int)job->pairs.size(), clashes);
+}
+
+void ClashDetector::cancel()
+{
+	std::shared_ptr<Job> job;
+	std::vector<TaskScheduler::TaskRef> tasks;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		tasks.swap(_tasks);
+		job = _job;
+	}
+	if (!job)
+		return;
+
+	job->cancelled = true;
+
+	TaskScheduler & scheduler = MobileApp::inst().scheduler();
+	for (auto const & task : tasks)
+		scheduler.cancel(task);
+	for (auto const & task : tasks)
+		scheduler.wait(task);
+}
+
+bool ClashDetector::isRunning() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (auto const & task : _tasks)
+	{
+		if (!task->isDone())
+			return true;
+	}
+	return false;
+}
+
+std::vector<ClashDetector::Clash> ClashDetector::clashes() const
+{
+	std::shared_ptr<Job> job;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		job = _job;
+	}
+	if (!job)
+		return std::vector<Clash>();
+
+	std::lock_guard<std::mutex> lock(job->mutex);
+	return job->clashes;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "hps.h"
+#include "sprk.h"
+#include "SpatialIndex.h"
+#include "SurfaceRegistry.h"
+#include "TaskScheduler.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class HighlightStyles;
+
+// ClashDetector finds interferences between two groups of shells of the loaded model, e.g.
+//  structure and MEP.
+//
+// The broad phase takes the pairs of shell instances whose boxes, grown by the tolerance,
+//  overlap in the spatial index.  The narrow phase runs on the MobileApp task scheduler
+//  (Background lane), PAIRS_PER_TASK pairs per task: the triangles of both shells are taken to
+//  world space, and two of them within the tolerance of each other (triangleDistance(), through
+//  a BVH over the second shell's triangles) make a clash, crossing members included.  When the
+//  surfaces do not meet, one vertex of each shell tested against the other with
+//  ShellKey::ComputeRelation (Enclosure test) finds a shell lying inside the other.
+//
+// Clashes are highlighted as each task completes, and progress is reported to the gui through
+//  ShowClashProgress().
+
+class ClashDetector
+{
+public:
+	static const size_t		PAIRS_PER_TASK = 32;
+
+	struct Clash
+	{
+		SpatialIndex::Item	first;
+		SpatialIndex::Item	second;
+	};
+
+	ClashDetector(SpatialIndex const & index, HighlightStyles const & styles);
+	~ClashDetector();
+
+	// Starts a detection between the shells under segments whose name contains 'firstGroup'
+	//  and those under segments whose name contains 'secondGroup' (an empty name takes every
+	//  shell), cancelling the previous one.  Clashes are highlighted with 'style', and progress
+	//  is reported to the view of 'surface'.
+	//  Returns the number of pairs to test, -1 if the spatial index is not ready.  The caller
+	//  updates the canvas to show the previous clashes unhighlighted.
+	int				start(HPS::Canvas const & canvas, SurfaceHandle surface, std::string const & firstGroup, std::string const & secondGroup, float tolerance, int style);
+
+	// Stops the detection in progress, waiting for running tasks
+	void			cancel();
+
+	bool			isRunning() const;
+
+	// Clashes found so far
+	std::vector<Clash>	clashes() const;
+
+private:
+	ClashDetector(ClashDetector const &);
+	void operator=(ClashDetector const &);
+
+	struct Job;
+
+	void			test(std::shared_ptr<Job> const & job, size_t begin, size_t end);
+
+	SpatialIndex const &		_index;
+	HighlightStyles const &		_styles;
+
+	mutable std::mutex			_mutex;
+	std::shared_ptr<Job>		_job;
+	std::vector<TaskScheduler::TaskRef>	_tasks;
+};
@@ -0,0 +1,101 @@
+#include "CpuTopology.h"
+
+#include <algorithm>
+#include <map>
+#include <stdio.h>
+#include <thread>
+
+#include "dprintf.h"
+
+namespace
+{
+	bool readUnsigned(const char *path, unsigned int & value)
+	{
+		FILE *file = fopen(path, "r");
+		if (file == nullptr)
+			return false;
+		bool const ok = fscanf(file, "%u", &value) == 1;
+		fclose(file);
+		return ok;
+	}
+
+	// Parses a cpu list such as "0-3,6,7" (see /sys/devices/system/cpu/possible)
+	std::vector<int> readCpuList(const char *path)
+	{
+		std::vector<int> cpus;
+		FILE *file = fopen(path, "r");
+		if (file == nullptr)
+			return cpus;
+
+		int first, last;
+		while (fscanf(file, "%d", &first) == 1)
+		{
+			last = first;
+			int separator = fgetc(file);
+			if (separator == '-')
+			{
+				if (fscanf(file, "%d", &last) != 1)
+					break;
+				separator = fgetc(file);
+			}
+			for (int cpu = first; cpu <= last; ++cpu)
+				cpus.push_back(cpu);
+			if (separator != ',')
+				break;
+		}
+
+		fclose(file);
+		return cpus;
+	}
+
+	CpuTopology detect()
+	{
+		CpuTopology topology;
+
+		std::vector<int> cpus = readCpuList("/sys/devices/system/cpu/possible");
+		if (cpus.empty())
+		{
+			unsigned int const count = std::max(1u, std::thread::hardware_concurrency());
+			for (unsigned int cpu = 0; cpu < count; ++cpu)
+				cpus.push_back((int)cpu);
+		}
+
+		std::map<unsigned int, std::vector<int>> byFrequency;
+		for (int cpu : cpus)
+		{
+			char path[128];
+			snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+			unsigned int frequency = 0;
+			readUnsigned(path, frequency);
+			byFrequency[frequency].push_back(cpu);
+		}
+
+		for (auto it = byFrequency.rbegin(); it != byFrequency.rend(); ++it)
+		{
+			CpuTopology::Cluster cluster;
+			cluster.cpus = it->second;
+			cluster.maxFrequency = it->first;
+			topology.clusters.push_back(cluster);
+		}
+
+		for (size_t i = 0; i < topology.clusters.size(); ++i)
+			dprintf("CPU cluster %u: %u cores at %u MHz\n", (unsigned)i, (unsigned)topology.clusters[i].cpus.size(),
+				topology.clusters[i].maxFrequency / 1000);
+
+		return topology;
+	}
+}
+
+unsigned int CpuTopology::cpuCount() const
+{
+	size_t count = 0;
+	for (auto const & cluster : clusters)
+		count += cluster.cpus.size();
+	return (unsigned int)count;
+}
+
+CpuTopology const & CpuTopology::get()
+{
+	static CpuTopology const topology = detect();
+	return topology;
+}
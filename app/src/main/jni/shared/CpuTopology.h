@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+
+// CpuTopology describes the clusters of cores of the device, as found in sysfs.  Phones
+//  mix fast "big" cores with slower "LITTLE" ones; cores sharing a maximum frequency are
+//  grouped in a cluster.  When sysfs cannot be read (or on other platforms) every core is
+//  reported in a single cluster.
+
+struct CpuTopology
+{
+	struct Cluster
+	{
+		std::vector<int>	cpus;
+		unsigned int		maxFrequency;		// kHz, 0 if unknown
+	};
+
+	// Fastest cluster first
+	std::vector<Cluster>	clusters;
+
+	unsigned int			cpuCount() const;
+
+	// Detected once, on first use
+	static CpuTopology const &	get();
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stddef.h>
+
+// Memory handed over by the gui without copying, for bulk data such as selections, vertex
+//  colors or camera paths.  On Android it is a direct java.nio.ByteBuffer (see sip.py).
+//
+// The memory belongs to the gui and is only valid for the duration of the call.  data is
+//  null if the gui passed a buffer which cannot be shared (e.g. a non-direct ByteBuffer).
+
+struct DirectBuffer
+{
+	void *		data;
+	size_t		size;
+};
@@ -0,0 +1,207 @@
+#include "HighlightStyles.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+namespace
+{
+	const HPS::RGBAColor	PALETTE[HighlightStyles::STYLE_COUNT] = {
+		HPS::RGBAColor(1.0f, 0.55f, 0.0f),
+		HPS::RGBAColor(0.2f, 0.6f, 1.0f),
+		HPS::RGBAColor(0.3f, 0.85f, 0.3f),
+		HPS::RGBAColor(0.9f, 0.2f, 0.2f),
+		HPS::RGBAColor(0.7f, 0.35f, 0.9f),
+		HPS::RGBAColor(1.0f, 0.9f, 0.2f),
+		HPS::RGBAColor(0.2f, 0.85f, 0.8f),
+		HPS::RGBAColor(0.95f, 0.45f, 0.7f),
+	};
+
+	void styleName(int style, char name[16])
+	{
+		snprintf(name, 16, "highlight%d", style);
+	}
+}
+
+HighlightStyles::HighlightStyles()
+{
+	char name[16];
+	for (int style = 0; style < STYLE_COUNT; ++style)
+	{
+		styleName(style, name);
+		_options[style].SetStyleName(name).SetOverlay(HPS::Drawing::Overlay::None);
+	}
+}
+
+HighlightStyles::~HighlightStyles()
+{
+	detach();
+}
+
+void HighlightStyles::attach(HPS::Canvas const & canvas)
+{
+	if (_canvas.Type() != HPS::Type::None)
+		return;
+
+	_canvas = canvas;
+	_portfolio = HPS::Database::CreatePortfolio();
+
+	char name[16];
+	for (int style = 0; style < STYLE_COUNT; ++style)
+	{
+		_styles[style] = HPS::Database::CreateRootSegment();
+		setColor(style, PALETTE[style]);
+
+		styleName(style, name);
+		_portfolio.DefineNamedStyle(name, _styles[style]);
+	}
+
+	_canvas.GetWindowKey().GetPortfolioControl().Push(_portfolio);
+}
+
+void HighlightStyles::detach()
+{
+	if (_canvas.Type() == HPS::Type::None)
+		return;
+
+	HPS::HighlightControl highlight = _canvas.GetWindowKey().GetHighlightControl();
+	for (int style = 0; style < STYLE_COUNT; ++style)
+		highlight.Unhighlight(_options[style]);
+
+	// Not necessarily on top of the stack
+	HPS::PortfolioControl portfolios = _canvas.GetWindowKey().GetPortfolioControl();
+	HPS::PortfolioKeyArray inUse;
+	portfolios.Show(inUse);
+	inUse.erase(std::remove(inUse.begin(), inUse.end(), _portfolio), inUse.end());
+	if (inUse.empty())
+		portfolios.UnsetEverything();
+	else
+		portfolios.Set(inUse);
+	_portfolio.Delete();
+	for (int style = 0; style < STYLE_COUNT; ++style)
+		_styles[style].Delete();
+	_canvas = HPS::Canvas();
+}
+
+void HighlightStyles::setColor(int style, HPS::RGBAColor const & color)
+{
+	if (!isValid(style) || _styles[style].Type() == HPS::Type::None)
+		return;
+
+	_styles[style].GetMaterialMappingControl()
+		.SetFaceColor(color)
+		.SetLineColor(color)
+		.SetMarkerColor(color);
+}
+
+HighlightBatch::Group::Group()
+	: clear(false), hasSelection(false)
+{
+}
+
+HighlightBatch::HighlightBatch()
+{
+}
+
+void HighlightBatch::clear(int style)
+{
+	if (!HighlightStyles::isValid(style))
+		return;
+
+	// Whatever was added before is cleared along with the rest
+	_groups[style] = Group();
+	_groups[style].clear = true;
+}
+
+void HighlightBatch::clearAll()
+{
+	for (int style = 0; style < HighlightStyles::STYLE_COUNT; ++style)
+		clear(style);
+}
+
+void HighlightBatch::add(int style, HPS::Key const & key)
+{
+	if (HighlightStyles::isValid(style))
+		_groups[style].keys.insert(key);
+}
+
+void HighlightBatch::add(int style, HPS::KeyPath const & path)
+{
+	if (HighlightStyles::isValid(style))
+		_groups[style].paths.push_back(path);
+}
+
+void HighlightBatch::add(int style, HPS::SelectionResults const & results)
+{
+	if (!HighlightStyles::isValid(style) || results.GetCount() == 0)
+		return;
+
+	Group & group = _groups[style];
+	if (group.hasSelection)
+		group.selection.Union(results);
+	else
+	{
+		// A copy: the Union above must not change the caller's results
+		group.selection.Copy(results);
+		group.hasSelection = true;
+	}
+}
+
+void HighlightBatch::add(int style, HPS::SearchResults const & results)
+{
+	if (HighlightStyles::isValid(style) && results.GetCount() > 0)
+		_groups[style].searches.push_back(results);
+}
+
+bool HighlightBatch::isEmpty() const
+{
+	for (auto const & group : _groups)
+	{
+		if (group.clear || group.hasSelection || !group.searches.empty() || !group.keys.empty() || !group.paths.empty())
+			return false;
+	}
+	return true;
+}
+
+size_t HighlightBatch::apply(HighlightStyles const & styles, HPS::Canvas canvas) const
+{
+	if (!styles.isAttached() || isEmpty())
+		return 0;
+
+	TRACE_SCOPE("selection", "HighlightBatch::apply");
+
+	HPS::HighlightControl highlight = canvas.GetWindowKey().GetHighlightControl();
+	size_t calls = 0;
+
+	for (int style = 0; style < HighlightStyles::STYLE_COUNT; ++style)
+	{
+		Group const & group = _groups[style];
+		HPS::HighlightOptionsKit const & options = styles.options(style);
+
+		if (group.clear)
+			highlight.Unhighlight(options);
+
+		if (group.hasSelection)
+		{
+			highlight.Highlight(group.selection, options);
+			++calls;
+		}
+		for (auto const & search : group.searches)
+		{
+			highlight.Highlight(search, options);
+			++calls;
+		}
+		for (auto const & key : group.keys)
+		{
+			highlight.Highlight(key, options);
+			++calls;
+		}
+		for (auto const & path : group.paths)
+		{
+			highlight.Highlight(path, options);
+			++calls;
+		}
+	}
+
+	return calls;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "hps.h"
+#include "sprk.h"
+
+#include <unordered_set>
+#include <vector>
+
+// HighlightStyles is a small pool of named highlight styles ("highlight0" to "highlight7"),
+//  defined once in a portfolio on the window.  Highlighting by pool index needs no style
+//  segment or options kit per call, and removing a whole category of highlights is a single
+//  Unhighlight(HighlightOptionsKit).
+//
+// HighlightBatch collects what to highlight, grouped by style, and applies it in bulk:
+//  selection results are merged into one SelectionResults per style, keys are deduplicated,
+//  and styles are cleared before their new items are highlighted.  The caller then issues
+//  a single update for the whole batch (see UserMobileSurface::applyHighlights).
+
+class HighlightStyles
+{
+public:
+	static const int	STYLE_COUNT = 8;
+
+	HighlightStyles();
+	~HighlightStyles();
+
+	// Defines the styles in the canvas' window.  Does nothing when already attached.
+	void			attach(HPS::Canvas const & canvas);
+	void			detach();
+
+	bool			isAttached() const { return _canvas.Type() != HPS::Type::None; }
+
+	static bool		isValid(int style) { return style >= 0 && style < STYLE_COUNT; }
+
+	// Options highlighting with 'style'.  Persistent highlights are drawn with the scene rather
+	//  than as an overlay: large sets would otherwise be redrawn on every frame.
+	HPS::HighlightOptionsKit const &	options(int style) const { return _options[style]; }
+
+	void			setColor(int style, HPS::RGBAColor const & color);
+
+private:
+	HighlightStyles(HighlightStyles const &);
+	void operator=(HighlightStyles const &);
+
+	HPS::Canvas					_canvas;
+	HPS::PortfolioKey			_portfolio;
+	HPS::SegmentKey				_styles[STYLE_COUNT];
+	HPS::HighlightOptionsKit	_options[STYLE_COUNT];
+};
+
+class HighlightBatch
+{
+public:
+	HighlightBatch();
+
+	// Removes every highlight of 'style' first
+	void			clear(int style);
+	void			clearAll();
+
+	void			add(int style, HPS::Key const & key);
+	void			add(int style, HPS::KeyPath const & path);
+	void			add(int style, HPS::SelectionResults const & results);
+	void			add(int style, HPS::SearchResults const & results);
+
+	bool			isEmpty() const;
+
+	// Returns the number of highlight calls made, each covering one or more items
+	size_t			apply(HighlightStyles const & styles, HPS::Canvas canvas) const;
+
+private:
+	struct Group
+	{
+		Group();
+
+		bool						clear;
+		bool						hasSelection;
+		HPS::SelectionResults		selection;
+		std::vector<HPS::SearchResults>	searches;
+		std::unordered_set<HPS::Key, HPS::KeyHasher>	keys;
+		std::vector<HPS::KeyPath>	paths;
+	};
+
+	Group			_groups[HighlightStyles::STYLE_COUNT];
+};
@@ -0,0 +1,261 @@
+#include "KDTree.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+namespace
+{
+	// The tree is balanced, so its depth stays under log2 of the point count: 32 is plenty
+	const int			STACK_SIZE = 64;
+
+	inline float dot(float const a[3], float const b[3])
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	inline float squaredDistance(float const nodeMin[3], float const nodeMax[3], float const point[3])
+	{
+		float d2 = 0.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float const d = std::max(std::max(nodeMin[axis] - point[axis], point[axis] - nodeMax[axis]), 0.0f);
+			d2 += d * d;
+		}
+		return d2;
+	}
+
+	// Lower bound of the score of any point in the node, or FLT_MAX if none can be within the cone
+	inline float lowerScore(float const nodeMin[3], float const nodeMax[3], KDTree::Cone const & cone, float squaredLength, float maxT)
+	{
+		float center[3], offset[3];
+		float halfDiagonal2 = 0.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			center[axis] = 0.5f * (nodeMin[axis] + nodeMax[axis]);
+			float const half = 0.5f * (nodeMax[axis] - nodeMin[axis]);
+			halfDiagonal2 += half * half;
+			offset[axis] = center[axis] - cone.origin[axis];
+		}
+
+		// The node's bounding sphere, along and across the ray
+		float const halfDiagonal = sqrtf(halfDiagonal2);
+		float const t = dot(offset, cone.direction) / squaredLength;
+		float const tSpan = halfDiagonal / sqrtf(squaredLength);
+		if (t + tSpan < 0.0f || t - tSpan > maxT)
+			return FLT_MAX;
+
+		float const across2 = std::max(dot(offset, offset) - t * t * squaredLength, 0.0f);
+		float const gap = std::max(sqrtf(across2) - halfDiagonal, 0.0f);
+		float const tolerance = cone.radius + cone.spread * std::min(t + tSpan, maxT);
+		if (tolerance <= 0.0f)
+			return FLT_MAX;
+		return gap / tolerance;
+	}
+}
+
+void KDTree::build(std::vector<float> const & points)
+{
+	clear();
+
+	uint32_t const count = (uint32_t)(points.size() / 3);
+	if (count == 0)
+		return;
+
+	std::vector<uint32_t> order(count);
+	for (uint32_t i = 0; i < count; ++i)
+		order[i] = i;
+
+	_nodes.reserve(2 * (count / MAX_LEAF_POINTS + 1));
+	_nodes.push_back(Node());
+
+	struct Range
+	{
+		uint32_t	node;
+		uint32_t	begin;
+		uint32_t	end;
+	};
+	std::vector<Range> pending(1, Range{0, 0, count});
+
+	while (!pending.empty())
+	{
+		Range const range = pending.back();
+		pending.pop_back();
+
+		float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+		float max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+		for (uint32_t i = range.begin; i < range.end; ++i)
+		{
+			float const * p = &points[3 * order[i]];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				min[axis] = std::min(min[axis], p[axis]);
+				max[axis] = std::max(max[axis], p[axis]);
+			}
+		}
+
+		Node & node = _nodes[range.node];
+		std::copy(min, min + 3, node.min);
+		std::copy(max, max + 3, node.max);
+
+		uint32_t const size = range.end - range.begin;
+		if (size <= MAX_LEAF_POINTS)
+		{
+			node.first = range.begin;
+			node.count = size;
+			continue;
+		}
+
+		int axis = 0;
+		for (int a = 1; a < 3; ++a)
+		{
+			if (max[a] - min[a] > max[axis] - min[axis])
+				axis = a;
+		}
+
+		uint32_t const middle = range.begin + size / 2;
+		std::nth_element(order.begin() + range.begin, order.begin() + middle, order.begin() + range.end,
+			[&points, axis](uint32_t a, uint32_t b) { return points[3 * a + axis] < points[3 * b + axis]; });
+
+		uint32_t const left = (uint32_t)_nodes.size();
+		node.first = left;
+		node.count = 0;
+		_nodes.push_back(Node());
+		_nodes.push_back(Node());
+
+		pending.push_back(Range{left, range.begin, middle});
+		pending.push_back(Range{left + 1, middle, range.end});
+	}
+
+	_points.resize(3 * (size_t)count);
+	for (uint32_t i = 0; i < count; ++i)
+		std::copy(&points[3 * order[i]], &points[3 * order[i]] + 3, &_points[3 * i]);
+	_ids.swap(order);
+}
+
+void KDTree::clear()
+{
+	_nodes.clear();
+	_points.clear();
+	_ids.clear();
+}
+
+bool KDTree::nearest(Cone const & cone, float maxT, uint32_t & point, float & t, float & score) const
+{
+	float const squaredLength = dot(cone.direction, cone.direction);
+	if (_nodes.empty() || squaredLength <= 0.0f)
+		return false;
+
+	float bestScore = 1.0f;
+	bool found = false;
+
+	uint32_t stack[STACK_SIZE];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		Node const & node = _nodes[stack[--top]];
+		if (lowerScore(node.min, node.max, cone, squaredLength, maxT) > bestScore)
+			continue;
+
+		if (node.count == 0)
+		{
+			// Visit the more promising child first
+			float const left = lowerScore(_nodes[node.first].min, _nodes[node.first].max, cone, squaredLength, maxT);
+			float const right = lowerScore(_nodes[node.first + 1].min, _nodes[node.first + 1].max, cone, squaredLength, maxT);
+			if (left < right)
+			{
+				stack[top++] = node.first + 1;
+				stack[top++] = node.first;
+			}
+			else
+			{
+				stack[top++] = node.first;
+				stack[top++] = node.first + 1;
+			}
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; ++i)
+		{
+			float const * p = &_points[3 * i];
+			float const offset[3] = {p[0] - cone.origin[0], p[1] - cone.origin[1], p[2] - cone.origin[2]};
+			float const along = dot(offset, cone.direction) / squaredLength;
+			if (along < 0.0f || along > maxT)
+				continue;
+
+			float const tolerance = cone.radius + cone.spread * along;
+			if (tolerance <= 0.0f)
+				continue;
+
+			float const across2 = std::max(dot(offset, offset) - along * along * squaredLength, 0.0f);
+			float const s = sqrtf(across2) / tolerance;
+			if (s <= bestScore)
+			{
+				bestScore = s;
+				point = _ids[i];
+				t = along;
+				found = true;
+			}
+		}
+	}
+
+	if (found)
+		score = bestScore;
+	return found;
+}
+
+bool KDTree::nearest(float const position[3], float maxDistance, uint32_t & point, float & distance) const
+{
+	if (_nodes.empty())
+		return false;
+
+	float best2 = maxDistance * maxDistance;
+	bool found = false;
+
+	uint32_t stack[STACK_SIZE];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		Node const & node = _nodes[stack[--top]];
+		if (squaredDistance(node.min, node.max, position) > best2)
+			continue;
+
+		if (node.count == 0)
+		{
+			float const left = squaredDistance(_nodes[node.first].min, _nodes[node.first].max, position);
+			float const right = squaredDistance(_nodes[node.first + 1].min, _nodes[node.first + 1].max, position);
+			if (left < right)
+			{
+				stack[top++] = node.first + 1;
+				stack[top++] = node.first;
+			}
+			else
+			{
+				stack[top++] = node.first;
+				stack[top++] = node.first + 1;
+			}
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; ++i)
+		{
+			float const * p = &_points[3 * i];
+			float const d[3] = {p[0] - position[0], p[1] - position[1], p[2] - position[2]};
+			float const d2 = dot(d, d);
+			if (d2 <= best2)
+			{
+				best2 = d2;
+				point = _ids[i];
+				found = true;
+			}
+		}
+	}
+
+	if (found)
+		distance = sqrtf(best2);
+	return found;
+}
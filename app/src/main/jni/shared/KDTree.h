@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// KDTree is a k-d tree over 3D points, used by Snapper to find snap candidates near a pick ray.
+//
+// Points are split at the median along the widest axis of each node, down to MAX_LEAF_POINTS
+//  per leaf, so the tree is balanced whatever their distribution.  Nodes are stored flattened
+//  like BVH nodes, 32 bytes each with the two children of a node next to each other, and keep
+//  the box of their points for pruning.  Leaf points are copied in leaf order so a leaf is
+//  tested from contiguous memory.
+//
+// Points are identified by their index in the array given to build().  Queries are const and
+//  may run concurrently.
+
+class KDTree
+{
+public:
+	static const uint32_t	MAX_LEAF_POINTS = 8;
+
+	// Ray with a tolerance growing along it, as a pick ray through a window area: a point is
+	//  within it if its distance to the ray is at most radius + spread * t, t being its position
+	//  along the ray in units of direction.
+	struct Cone
+	{
+		float		origin[3];
+		float		direction[3];
+		float		radius;
+		float		spread;
+	};
+
+	// 'points' holds x, y, z for each point
+	void			build(std::vector<float> const & points);
+	void			clear();
+
+	size_t			pointCount() const { return _points.size() / 3; }
+	size_t			nodeCount() const { return _nodes.size(); }
+
+	// Point within the cone, between t = 0 and maxT, nearest to the ray relative to the
+	//  tolerance there.  'score' is that distance over the tolerance, from 0 to 1.
+	bool			nearest(Cone const & cone, float maxT, uint32_t & point, float & t, float & score) const;
+
+	// Point nearest to 'position', if one lies within maxDistance
+	bool			nearest(float const position[3], float maxDistance, uint32_t & point, float & distance) const;
+
+private:
+	struct alignas(16) Node
+	{
+		float		min[3];
+		uint32_t	first;		// Leaf: first point in leaf order.  Inner node: left child, the right one follows.
+		float		max[3];
+		uint32_t	count;		// Points in a leaf, 0 for inner nodes
+	};
+
+	static_assert(sizeof(Node) == 32, "KDTree::Node should stay 32 bytes");
+
+	std::vector<Node>		_nodes;
+	std::vector<float>		_points;		// x, y, z in leaf order
+	std::vector<uint32_t>	_ids;			// Index given to build(), in leaf order
+};
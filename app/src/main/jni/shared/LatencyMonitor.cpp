@@ -0,0 +1,151 @@
+#include "LatencyMonitor.h"
+#include "Trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+	// A move which is still pending after this long did not cause a redraw
+	//  (e.g. the operator ignored it), so the frame closing it says nothing.
+	const int64_t		STALE_LATENCY = 1000000;
+
+	float percentile(uint32_t const buckets[], int bucketCount, uint32_t count, float fraction)
+	{
+		uint32_t const target = (uint32_t)(fraction * count);
+		uint32_t seen = 0;
+		for (int i = 0; i < bucketCount; ++i)
+		{
+			seen += buckets[i];
+			if (seen > target)
+				return (i + 0.5f) * LatencyMonitor::BUCKET_WIDTH;
+		}
+		return (float)bucketCount * LatencyMonitor::BUCKET_WIDTH;
+	}
+}
+
+LatencyMonitor::Histogram::Histogram(const char *name)
+	: operatorName(name), count(0), sum(0), max(0)
+{
+	memset(buckets, 0, sizeof(buckets));
+}
+
+LatencyMonitor::LatencyMonitor()
+	: _current(-1), _pending(0)
+{
+}
+
+void LatencyMonitor::beginGesture(const char *operatorName)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_pending.store(0, std::memory_order_relaxed);
+
+	_current = -1;
+	for (size_t i = 0; i < _histograms.size(); ++i)
+	{
+		if (_histograms[i].operatorName == operatorName)
+		{
+			_current = (int)i;
+			return;
+		}
+	}
+
+	_histograms.push_back(Histogram(operatorName));
+	_current = (int)_histograms.size() - 1;
+}
+
+void LatencyMonitor::inputInjected(int64_t eventTime)
+{
+	// Keep the oldest move: that is the one the user has been waiting for the longest
+	int64_t expected = 0;
+	_pending.compare_exchange_strong(expected, eventTime, std::memory_order_relaxed);
+}
+
+void LatencyMonitor::framePresented(int64_t presentTime)
+{
+	int64_t const eventTime = _pending.exchange(0, std::memory_order_relaxed);
+	if (eventTime == 0)
+		return;
+
+	int64_t const latency = presentTime - eventTime;
+	if (latency < 0 || latency > STALE_LATENCY)
+		return;
+
+	TRACE_COUNTER("touchLatencyUs", latency);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_current < 0)
+		return;
+
+	Histogram & histogram = _histograms[_current];
+	double const ms = latency / 1000.0;
+	int bucket = (int)(ms / BUCKET_WIDTH);
+	if (bucket >= BUCKET_COUNT)
+		bucket = BUCKET_COUNT - 1;
+
+	++histogram.buckets[bucket];
+	++histogram.count;
+	histogram.sum += ms;
+	if (ms > histogram.max)
+		histogram.max = ms;
+}
+
+void LatencyMonitor::fill(Histogram const & histogram, float stats[])
+{
+	stats[SampleCount] = (float)histogram.count;
+	stats[Mean] = histogram.count ? (float)(histogram.sum / histogram.count) : 0.0f;
+	stats[Median] = percentile(histogram.buckets, BUCKET_COUNT, histogram.count, 0.5f);
+	stats[Percentile90] = percentile(histogram.buckets, BUCKET_COUNT, histogram.count, 0.9f);
+	stats[Percentile99] = percentile(histogram.buckets, BUCKET_COUNT, histogram.count, 0.99f);
+	stats[Max] = (float)histogram.max;
+}
+
+int LatencyMonitor::show(const char *operatorName, float stats[])
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	for (size_t i = 0; i < _histograms.size(); ++i)
+	{
+		if (_histograms[i].operatorName == operatorName)
+		{
+			fill(_histograms[i], stats);
+			return (int)_histograms[i].count;
+		}
+	}
+
+	memset(stats, 0, StatCount * sizeof(float));
+	return 0;
+}
+
+std::string LatencyMonitor::summary()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	std::string		result;
+	char			line[160];
+	float			stats[StatCount];
+
+	for (size_t i = 0; i < _histograms.size(); ++i)
+	{
+		if (_histograms[i].count == 0)
+			continue;
+
+		fill(_histograms[i], stats);
+		snprintf(line, sizeof(line), "%stouch latency %s: p50 %.0f  p90 %.0f  p99 %.0f  max %.0f ms (%u)",
+			result.empty() ? "" : "\n", _histograms[i].operatorName.c_str(),
+			stats[Median], stats[Percentile90], stats[Percentile99], stats[Max], (unsigned)_histograms[i].count);
+		result += line;
+	}
+
+	return result;
+}
+
+void LatencyMonitor::reset()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_pending.store(0, std::memory_order_relaxed);
+	_histograms.clear();
+	_current = -1;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// LatencyMonitor measures touch-to-photon latency: the time between a finger
+//  movement (the MotionEvent timestamp taken by Android) and the moment the
+//  frame showing its result is put on screen.
+//
+// The oldest touch move not yet on screen is remembered, and the next presented
+//  frame closes it.  Samples are collected into one histogram per operator
+//  (PanOrbitZoomOperator, FlyOperator, ZoomBoxOperator, ...), the operator being
+//  the one on top of the stack when the gesture started.
+//
+// All times are CLOCK_MONOTONIC microseconds, the clock behind both
+//  MotionEvent.getEventTime() and Trace::Now().
+
+class LatencyMonitor
+{
+public:
+	// Histogram buckets are BUCKET_WIDTH ms wide; the last one collects everything slower
+	static const int		BUCKET_WIDTH = 2;
+	static const int		BUCKET_COUNT = 128;
+
+	// Index of each value in the array filled by show()
+	enum Stat
+	{
+		SampleCount,
+		Mean,
+		Median,
+		Percentile90,
+		Percentile99,
+		Max,
+		StatCount
+	};
+
+	LatencyMonitor();
+
+	// Called on touch down with the name of the operator receiving the gesture
+	void			beginGesture(const char *operatorName);
+
+	// Called when a touch move with the given MotionEvent time has been injected
+	void			inputInjected(int64_t eventTime);
+
+	// Called from the driver when a frame has been put on screen
+	void			framePresented(int64_t presentTime);
+
+	// Fills 'stats' (StatCount values, milliseconds) for one operator.  Returns the sample count.
+	int				show(const char *operatorName, float stats[]);
+
+	// One line per operator, for the log and the performance HUD
+	std::string		summary();
+
+	void			reset();
+
+private:
+	struct Histogram
+	{
+		Histogram(const char *name);
+
+		std::string		operatorName;
+		uint32_t		buckets[BUCKET_COUNT];
+		uint32_t		count;
+		double			sum;
+		double			max;
+	};
+
+	static void		fill(Histogram const & histogram, float stats[]);
+
+	std::mutex				_mutex;
+	std::vector<Histogram>	_histograms;
+	int						_current;
+
+	// Event time of the oldest injected move not yet presented, 0 if none
+	std::atomic<int64_t>	_pending;
+};
@@ -0,0 +1,303 @@
+#include "Measurement.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+// Implemented by the gui
+void ShowMeasurement(SurfaceHandle surface, int mode, float value);
+
+namespace
+{
+	const float			PI = 3.14159265358979f;
+
+	// Faces closer to parallel than this, in degrees, are reported without their angle
+	const float			PARALLEL_ANGLE = 0.5f;
+
+	float degrees(HPS::Vector const & a, HPS::Vector const & b)
+	{
+		float const c = (float)(a.Dot(b) / (a.Length() * b.Length()));
+		return acosf(std::max(-1.0f, std::min(1.0f, c))) * 180.0f / PI;
+	}
+
+	void insertLabel(HPS::SegmentKey & segment, HPS::Point const & position, char const * text)
+	{
+		segment.InsertText(HPS::TextKit()
+			.SetPosition(position)
+			.SetText(text)
+			.SetAlignment(HPS::Text::Alignment::BottomCenter));
+	}
+}
+
+Measurement::Measurement(Snapper & snapper)
+	: _snapper(snapper), _surface(0), _mode(PointToPoint)
+{
+}
+
+Measurement::~Measurement()
+{
+	detach();
+}
+
+void Measurement::attach(HPS::Canvas const & canvas, SurfaceHandle surface)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_canvas = canvas;
+	_surface = surface;
+}
+
+void Measurement::detach()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_canvas.Type() == HPS::Type::None)
+		return;
+
+	reset();
+	_canvas = HPS::Canvas();
+}
+
+void Measurement::setMode(Mode mode)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_mode = mode;
+	_picks.clear();
+	if (_pending.Type() != HPS::Type::None)
+		_pending.Flush();
+}
+
+size_t Measurement::pickCount(Mode mode)
+{
+	switch (mode)
+	{
+		case EdgeLength:	return 1;
+		case Angle:			return 3;
+		default:			return 2;
+	}
+}
+
+bool Measurement::accepts(Mode mode, Snapper::Snap::Kind kind)
+{
+	switch (mode)
+	{
+		case EdgeLength:	return kind == Snapper::Snap::EdgeMidpoint;
+		case FaceToFace:	return kind == Snapper::Snap::Face;
+		default:			return kind != Snapper::Snap::None;
+	}
+}
+
+bool Measurement::hover(HPS::WindowPoint const & location)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	HPS::SegmentKey const segment = overlay();
+	if (segment.Type() == HPS::Type::None)
+		return false;
+
+	TRACE_SCOPE("measure", "Measurement::hover");
+
+	Snapper::Snap snap;
+	bool const found = _snapper.snap(_canvas, location, snap) && accepts(_mode, snap.kind);
+
+	_preview.Flush();
+	if (found)
+		drawSnap(_preview, snap);
+	_canvas.Update();
+	return found;
+}
+
+void Measurement::endHover()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_preview.Type() == HPS::Type::None)
+		return;
+
+	_preview.Flush();
+	_canvas.Update();
+}
+
+bool Measurement::pick(HPS::WindowPoint const & location, float & value)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	HPS::SegmentKey segment = overlay();
+	if (segment.Type() == HPS::Type::None)
+		return false;
+
+	TRACE_SCOPE("measure", "Measurement::pick");
+
+	Snapper::Snap snap;
+	if (!_snapper.snap(_canvas, location, snap) || !accepts(_mode, snap.kind))
+		return false;
+
+	_picks.push_back(snap);
+	_preview.Flush();
+
+	bool const complete = _picks.size() == pickCount(_mode);
+	if (complete)
+	{
+		_pending.Flush();
+		value = measure(segment.Subsegment());
+		_picks.clear();
+		ShowMeasurement(_surface, _mode, value);
+	}
+	else
+		drawSnap(_pending, snap);
+
+	_canvas.Update();
+	return complete;
+}
+
+void Measurement::showDistance(HPS::Point const & first, HPS::Point const & second, float distance)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	HPS::SegmentKey segment = overlay();
+	if (segment.Type() == HPS::Type::None)
+		return;
+
+	HPS::SegmentKey result = segment.Subsegment();
+	result.InsertLine(first, second);
+	result.InsertMarker(first);
+	result.InsertMarker(second);
+
+	char label[64];
+	snprintf(label, sizeof(label), "%.4g", distance);
+	insertLabel(result, HPS::Midpoint(first, second), label);
+}
+
+void Measurement::clear()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	reset();
+}
+
+void Measurement::reset()
+{
+	_picks.clear();
+	if (_overlay.Type() != HPS::Type::None)
+		_overlay.Delete();
+	_overlay = HPS::SegmentKey();
+	_pending = HPS::SegmentKey();
+	_preview = HPS::SegmentKey();
+	_view = HPS::SegmentKey();
+}
+
+HPS::SegmentKey Measurement::overlay()
+{
+	if (_canvas.Type() == HPS::Type::None)
+		return HPS::SegmentKey();
+
+	// A new model comes with a new view
+	HPS::SegmentKey const view = _canvas.GetFrontView().GetSegmentKey();
+	if (_overlay.Type() != HPS::Type::None && view == _view)
+		return _overlay;
+
+	_picks.clear();
+	_view = view;
+	_overlay = view.Subsegment();
+	_overlay.GetDrawingAttributeControl().SetOverlay(HPS::Drawing::Overlay::Default);
+	_overlay.GetSelectabilityControl().SetEverything(false);
+	_overlay.GetVisibilityControl().SetLines(true).SetMarkers(true).SetText(true);
+	_overlay.GetMaterialMappingControl()
+		.SetLineColor(HPS::RGBAColor(1.0f, 0.5f, 0.0f))
+		.SetMarkerColor(HPS::RGBAColor(1.0f, 0.5f, 0.0f))
+		.SetTextColor(HPS::RGBAColor(1.0f, 1.0f, 1.0f));
+	_overlay.GetLineAttributeControl().SetWeight(2.0f);
+	_overlay.GetMarkerAttributeControl().SetSymbol("circle").SetSize(12.0f, HPS::Marker::SizeUnits::Pixels);
+	_overlay.GetTextAttributeControl().SetSize(16.0f, HPS::Text::SizeUnits::Pixels);
+
+	_pending = _overlay.Subsegment();
+
+	_preview = _overlay.Subsegment();
+	_preview.GetMaterialMappingControl()
+		.SetLineColor(HPS::RGBAColor(1.0f, 1.0f, 0.0f))
+		.SetMarkerColor(HPS::RGBAColor(1.0f, 1.0f, 0.0f));
+	return _overlay;
+}
+
+float Measurement::measure(HPS::SegmentKey const & segment) const
+{
+	HPS::SegmentKey result = segment;
+	float value = 0;
+	char label[64];
+
+	switch (_mode)
+	{
+		case PointToPoint:
+		{
+			HPS::Point const & a = _picks[0].position;
+			HPS::Point const & b = _picks[1].position;
+			value = (float)(b - a).Length();
+			result.InsertLine(a, b);
+			result.InsertMarker(a);
+			result.InsertMarker(b);
+			snprintf(label, sizeof(label), "%.4g", value);
+			insertLabel(result, HPS::Midpoint(a, b), label);
+			break;
+		}
+
+		case EdgeLength:
+		{
+			HPS::Point const & a = _picks[0].edge[0];
+			HPS::Point const & b = _picks[0].edge[1];
+			value = (float)(b - a).Length();
+			result.InsertLine(a, b);
+			result.InsertMarker(a);
+			result.InsertMarker(b);
+			snprintf(label, sizeof(label), "%.4g", value);
+			insertLabel(result, HPS::Midpoint(a, b), label);
+			break;
+		}
+
+		case FaceToFace:
+		{
+			// From the second point, straight to the first face's plane
+			Snapper::Snap const & first = _picks[0];
+			Snapper::Snap const & second = _picks[1];
+			float const along = (float)(second.position - first.position).Dot(first.normal);
+			HPS::Point const foot = second.position - first.normal * along;
+			value = fabsf(along);
+
+			result.InsertLine(second.position, foot);
+			result.InsertMarker(first.position);
+			result.InsertMarker(second.position);
+
+			// Faces facing each other or the same way are both parallel
+			float angle = degrees(first.normal, second.normal);
+			angle = std::min(angle, 180.0f - angle);
+			if (angle > PARALLEL_ANGLE)
+				snprintf(label, sizeof(label), "%.4g (%.1f\xC2\xB0)", value, angle);
+			else
+				snprintf(label, sizeof(label), "%.4g", value);
+			insertLabel(result, HPS::Midpoint(second.position, foot), label);
+			break;
+		}
+
+		case Angle:
+		{
+			HPS::Point const & a = _picks[0].position;
+			HPS::Point const & vertex = _picks[1].position;
+			HPS::Point const & b = _picks[2].position;
+			value = degrees(a - vertex, b - vertex);
+			result.InsertLine(a, vertex);
+			result.InsertLine(vertex, b);
+			result.InsertMarker(a);
+			result.InsertMarker(vertex);
+			result.InsertMarker(b);
+			snprintf(label, sizeof(label), "%.1f\xC2\xB0", value);
+			insertLabel(result, vertex, label);
+			break;
+		}
+
+		default:
+			break;
+	}
+
+	return value;
+}
+
+void Measurement::drawSnap(HPS::SegmentKey const & segment, Snapper::Snap const & snap)
+{
+	HPS::SegmentKey target = segment;
+	target.InsertMarker(snap.position);
+	if (snap.kind == Snapper::Snap::EdgeMidpoint)
+		target.InsertLine(snap.edge[0], snap.edge[1]);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "hps.h"
+#include "sprk.h"
+#include "Snapper.h"
+#include "SurfaceRegistry.h"
+
+#include <mutex>
+#include <vector>
+
+// Measurement takes snapped picks and measures between them, drawing the picks and results in
+//  an overlay segment of the front view, in front of the model whatever its depth.
+//
+//  PointToPoint	two snaps of any kind, their distance
+//  EdgeLength		an edge midpoint snap, its edge's length
+//  FaceToFace		two face snaps, the distance from the second point to the first face's plane,
+//					and the angle between the faces when they are not parallel
+//  Angle			three snaps of any kind, the angle at the second one, in degrees
+//
+// Distances are in world units.  Completed measurements stay shown until clear(), and are
+//  reported to the gui through ShowMeasurement().  Picks come from the HPS event thread (see
+//  MeasureOperator); showDistance() may be called from any thread.
+
+class Measurement
+{
+public:
+	enum Mode
+	{
+		PointToPoint,
+		EdgeLength,
+		FaceToFace,
+		Angle,
+		ModeCount
+	};
+
+	Measurement(Snapper & snapper);
+	~Measurement();
+
+	// 'surface' is the surface whose view receives the measurements
+	void			attach(HPS::Canvas const & canvas, SurfaceHandle surface);
+	void			detach();
+
+	// Changes the measurement taken by the next picks, dropping picks made so far
+	void			setMode(Mode mode);
+	Mode			mode() const { return _mode; }
+
+	// Shows the snap under 'location'.  Returns true if there is one the mode accepts.
+	bool			hover(HPS::WindowPoint const & location);
+	void			endHover();
+
+	// Adds the snap under 'location' to the measurement.  Returns true if that completed it,
+	//  with its value in 'value'.
+	bool			pick(HPS::WindowPoint const & location, float & value);
+
+	// Draws a distance computed elsewhere (e.g. by MinimumDistance) like a completed measurement,
+	//  for the next update
+	void			showDistance(HPS::Point const & first, HPS::Point const & second, float distance);
+
+	// Removes every measurement, for the next update
+	void			clear();
+
+	static size_t	pickCount(Mode mode);
+	static bool		accepts(Mode mode, Snapper::Snap::Kind kind);
+
+private:
+	Measurement(Measurement const &);
+	void operator=(Measurement const &);
+
+	// Overlay segment of the current front view, created as needed
+	HPS::SegmentKey	overlay();
+	void			reset();
+
+	float			measure(HPS::SegmentKey const & segment) const;
+	static void		drawSnap(HPS::SegmentKey const & segment, Snapper::Snap const & snap);
+
+	Snapper &					_snapper;
+
+	// Guards everything below
+	std::mutex					_mutex;
+	HPS::Canvas					_canvas;
+	SurfaceHandle				_surface;
+	HPS::SegmentKey				_view;
+	HPS::SegmentKey				_overlay;
+	HPS::SegmentKey				_preview;
+	HPS::SegmentKey				_pending;
+	Mode						_mode;
+	std::vector<Snapper::Snap>	_picks;
+};
@@ -0,0 +1,135 @@
+#include "MinimumDistance.h"
+#include "BVH.h"
+#include "MobileApp.h"
+#include "Trace.h"
+#include "TriangleDistance.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+#include "dprintf.h"
+
+namespace
+{
+	// Triangles of a component in world space, with the instance each comes from
+	struct Mesh
+	{
+		std::vector<Triangle>	triangles;
+		std::vector<uint32_t>	instances;
+		BVH						bvh;
+
+		bool build(std::vector<SpatialIndex::Instance> const & component, std::atomic<bool> const * cancelled)
+		{
+			for (uint32_t n = 0; n < (uint32_t)component.size(); ++n)
+			{
+				if (cancelled != nullptr && cancelled->load(std::memory_order_relaxed))
+					return false;
+
+				SpatialIndex::Instance const & instance = component[n];
+				size_t const added = appendTriangles(instance.item.shell, instance.matrix, triangles);
+				instances.insert(instances.end(), added, n);
+			}
+
+			std::vector<BVH::Box> boxes;
+			boxes.reserve(triangles.size());
+			for (auto const & triangle : triangles)
+				boxes.push_back(triangle.bounds());
+			bvh.build(boxes);
+			return true;
+		}
+	};
+}
+
+MinimumDistance::MinimumDistance()
+{
+}
+
+MinimumDistance::~MinimumDistance()
+{
+	cancel();
+}
+
+void MinimumDistance::start(std::vector<SpatialIndex::Instance> const & first, std::vector<SpatialIndex::Instance> const & second,
+	float maxDistance, Callback const & done)
+{
+	cancel();
+
+	std::shared_ptr<std::atomic<bool>> cancelled(new std::atomic<bool>(false));
+	TaskScheduler & scheduler = MobileApp::inst().scheduler();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_cancelled = cancelled;
+	_task = scheduler.submit(TaskScheduler::Interactive, [first, second, maxDistance, done, cancelled] {
+		Result result;
+		bool const found = compute(first, second, maxDistance, result, cancelled.get());
+		if (!cancelled->load())
+			done(found, result);
+	});
+}
+
+void MinimumDistance::cancel()
+{
+	TaskScheduler::TaskRef task;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_cancelled)
+			*_cancelled = true;
+		task.swap(_task);
+		_cancelled.reset();
+	}
+	if (!task)
+		return;
+
+	TaskScheduler & scheduler = MobileApp::inst().scheduler();
+	scheduler.cancel(task);
+	scheduler.wait(task);
+}
+
+bool MinimumDistance::isRunning() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _task && !_task->isDone();
+}
+
+bool MinimumDistance::compute(std::vector<SpatialIndex::Instance> const & first, std::vector<SpatialIndex::Instance> const & second,
+	float maxDistance, Result & result, std::atomic<bool> const * cancelled)
+{
+	TRACE_SCOPE("measure", "MinimumDistance::compute");
+	HPS::Time const start = HPS::Database::GetTime();
+
+	Mesh meshes[2];
+	{
+		TRACE_SCOPE("measure", "MinimumDistance::build");
+		if (!meshes[0].build(first, cancelled) || !meshes[1].build(second, cancelled))
+			return false;
+	}
+
+	size_t tested = 0;
+	uint32_t triangles[2];
+	float distance;
+	bool const found = meshes[0].bvh.nearestPair(meshes[1].bvh, maxDistance,
+		[&meshes, &tested](uint32_t a, uint32_t b) {
+			++tested;
+			float onFirst[3], onSecond[3];
+			return sqrtf(triangleDistance(meshes[0].triangles[a], meshes[1].triangles[b], onFirst, onSecond));
+		},
+		triangles[0], triangles[1], distance, cancelled);
+
+	dprintf("Minimum distance: %u x %u triangles, %u pairs tested, %.1f ms\n", (unsigned)meshes[0].triangles.size(),
+		(unsigned)meshes[1].triangles.size(), (unsigned)tested, HPS::Database::GetTime() - start);
+
+	if (!found)
+		return false;
+
+	// The winning pair again, for its points
+	float onFirst[3], onSecond[3];
+	triangleDistance(meshes[0].triangles[triangles[0]], meshes[1].triangles[triangles[1]], onFirst, onSecond);
+
+	result.distance = distance;
+	result.points[0] = HPS::Point(onFirst[0], onFirst[1], onFirst[2]);
+	result.points[1] = HPS::Point(onSecond[0], onSecond[1], onSecond[2]);
+	result.items[0] = first[meshes[0].instances[triangles[0]]].item;
+	result.items[1] = second[meshes[1].instances[triangles[1]]].item;
+	return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "hps.h"
+#include "sprk.h"
+#include "SpatialIndex.h"
+#include "TaskScheduler.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// MinimumDistance finds the clearance between two components, each a set of shell instances
+//  (a single shell, a part, a pipe run...), and the pair of points where it is reached.
+//
+// The triangles of each component are gathered in world space under a BVH, and the two trees
+//  are traversed together nearest boxes first (BVH::nearestPair): once a pair of triangles
+//  gives a distance, every pair of nodes farther apart than that is skipped.  Triangle pairs
+//  are measured with triangleDistance() (TriangleDistance.h).
+//
+// start() runs on the MobileApp task scheduler (Interactive lane); a new start() or cancel()
+//  stops the computation in progress, which then reports nothing.
+
+class MinimumDistance
+{
+public:
+	struct Result
+	{
+		float				distance;
+		HPS::Point			points[2];		// World space, on the first and second component
+		SpatialIndex::Item	items[2];		// Shells the points lie on
+	};
+
+	// Called on the worker when the computation ends; 'found' is false if nothing lies within
+	//  the maximum distance
+	typedef std::function<void(bool found, Result const & result)>	Callback;
+
+	MinimumDistance();
+	~MinimumDistance();
+
+	void			start(std::vector<SpatialIndex::Instance> const & first, std::vector<SpatialIndex::Instance> const & second,
+						float maxDistance, Callback const & done);
+
+	// Stops the computation in progress, waiting for it
+	void			cancel();
+
+	bool			isRunning() const;
+
+	// The computation itself, for callers already on a worker.  Returns false if nothing lies
+	//  within maxDistance, or once 'cancelled' is set.
+	static bool		compute(std::vector<SpatialIndex::Instance> const & first, std::vector<SpatialIndex::Instance> const & second,
+						float maxDistance, Result & result, std::atomic<bool> const * cancelled = nullptr);
+
+private:
+	MinimumDistance(MinimumDistance const &);
+	void operator=(MinimumDistance const &);
+
+	mutable std::mutex						_mutex;
+	TaskScheduler::TaskRef					_task;
+	std::shared_ptr<std::atomic<bool>>		_cancelled;
+};
@@ -1,33 +1,101 @@
 
 #include "MobileApp.h"
 #include "dprintf.h"
+#include "Startup.h"
+#include "ThreadPlacement.h"
+#include "Trace.h"
 
 #include "visualize_license.h"
 
+#include <thread>
+
 MobileApp::MobileApp()
 	: _world(0)
+	, _actionExecutor("SurfaceActions")
 {
-	_world = new HPS::World(VISUALIZE_LICENSE);
+	std::thread(&MobileApp::createWorld, this).detach();
+}
+
+void MobileApp::createWorld()
+{
+	TRACE_THREAD_NAME("WorldInit");
+	ThreadPlacement::apply(ThreadPlacement::Throughput);
+
+	HPS::World *world;
+	{
+		TRACE_SCOPE("startup", "createWorld");
+		world = new HPS::World(VISUALIZE_LICENSE);
 
-	// Subscribe _errorHandler to handle errors
-	HPS::Database::GetEventDispatcher().Subscribe(_errorHandler, HPS::Object::ClassID<HPS::ErrorEvent>());
+		// Subscribe _errorHandler to handle errors
+		HPS::Database::GetEventDispatcher().Subscribe(_errorHandler, HPS::Object::ClassID<HPS::ErrorEvent>());
+
+		// Subscribe _warningHandler to handle warnings
+		HPS::Database::GetEventDispatcher().Subscribe(_warningHandler, HPS::Object::ClassID<HPS::WarningEvent>());
+
+#ifdef USING_EXCHANGE
+		// Needed on android
+		world->SetExchangeLibraryDirectory(".");
+#endif
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_worldMutex);
+		if (!_fontDirectory.empty())
+			world->SetFontDirectory(_fontDirectory.c_str());
+		if (!_materialsDirectory.empty())
+			world->SetMaterialLibraryDirectory(_materialsDirectory.c_str());
+		_world = world;
+	}
+	_worldCreated.notify_all();
+
+	Startup::reached(Startup::WorldCreated);
+}
 
- 	// Subscribe _warningHandler to handle warnings
- 	HPS::Database::GetEventDispatcher().Subscribe(_warningHandler, HPS::Object::ClassID<HPS::WarningEvent>());
+void MobileApp::waitForWorld()
+{
+	std::unique_lock<std::mutex> lock(_worldMutex);
+	if (_world != 0)
+		return;
 
- #ifdef USING_EXCHANGE
-     // Needed on android
-     _world->SetExchangeLibraryDirectory(".");
- #endif
- }
+	TRACE_SCOPE("startup", "waitForWorld");
+	_worldCreated.wait(lock, [this] { return _world != 0; });
+}
 
 void MobileApp::setFontDirectory(const char* fontDir)
 {
-	_world->SetFontDirectory(fontDir);
+	std::lock_guard<std::mutex> lock(_worldMutex);
+	if (_world != 0)
+		_world->SetFontDirectory(fontDir);
+	else
+		_fontDirectory = fontDir;
 }
 
 void MobileApp::setMaterialsDirectory(const char* materialsDir)
 {
-	_world->SetMaterialLibraryDirectory(materialsDir);
+	std::lock_guard<std::mutex> lock(_worldMutex);
+	if (_world != 0)
+		_world->SetMaterialLibraryDirectory(materialsDir);
+	else
+		_materialsDirectory = materialsDir;
+}
+
+void MobileApp::startTracing()
+{
+#ifndef USING_TRACING
+	wprintf("Tracing is compiled out, build with USING_TRACING=1 to record spans\n");
+#endif
+	Trace::Start();
 }
 
+bool MobileApp::stopTracing(const char* traceFile)
+{
+	Trace::Stop();
+	return Trace::Write(traceFile);
+}
+
+void MobileApp::setThreadPlacement(int latencyCores, int throughputCores, int backgroundCores)
+{
+	ThreadPlacement::setPolicy(ThreadPlacement::Latency, (ThreadPlacement::CoreSet)latencyCores);
+	ThreadPlacement::setPolicy(ThreadPlacement::Throughput, (ThreadPlacement::CoreSet)throughputCores);
+	ThreadPlacement::setPolicy(ThreadPlacement::Background, (ThreadPlacement::CoreSet)backgroundCores);
+}
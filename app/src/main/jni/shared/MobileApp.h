@@ -2,9 +2,16 @@
 
 #include "hps.h"
 #include "dprintf.h"
+#include "DirectBuffer.h"
+#include "SerialExecutor.h"
+#include "TaskScheduler.h"
 #include <cassert>
+#include <condition_variable>
+#include <mutex>
+#include <string>
 
 #define APP_ACTION
+#define APP_ACTION_CRITICAL
 
 // MobileApp is a plaform-independent class which users can modify to
 //  store application data or actions. This class (along with UserMobileSurface)
@@ -64,17 +71,46 @@ public:
 		return instance;
 	}
 
+	// The HPS::World is created on a background thread started with the app (from JNI_OnLoad
+	//  on Android).  Call waitForWorld() before using HPS.
+	void				waitForWorld();
+
 	APP_ACTION void		setFontDirectory(const char *fontDir);
 	APP_ACTION void		setMaterialsDirectory(const char *materialsDir);
 
+	// Tracing (see Trace.h).  stopTracing writes a Chrome/Perfetto trace file.
+	APP_ACTION void		startTracing();
+	APP_ACTION bool		stopTracing(const char *traceFile);
+
+	// Cores for the latency (render, input, interactive tasks), throughput (import, load tasks)
+	//  and background threads: 0 any core, 1 big cores, 2 LITTLE cores.  See ThreadPlacement.h.
+	APP_ACTION void		setThreadPlacement(int latencyCores, int throughputCores, int backgroundCores);
+
+	// Runs the asynchronous variants of the SURFACE_ACTIONs, one at a time
+	SerialExecutor &	actionExecutor() { return _actionExecutor; }
+
+	// Pool for native background work, see TaskScheduler.h
+	TaskScheduler &		scheduler() { return _scheduler; }
+
 private:
 	MobileApp();
 	MobileApp(MobileApp const &);		// Singleton - do not implement
 	void operator=(MobileApp const &);	// Singleton - do not implement
 
-    // Single HPS::World instance
+	void				createWorld();
+
+    // Single HPS::World instance, set by createWorld()
 	HPS::World *			_world;
+	std::mutex				_worldMutex;
+	std::condition_variable	_worldCreated;
+
+	// Set before the World exists, applied by createWorld()
+	std::string				_fontDirectory;
+	std::string				_materialsDirectory;
+
 	MyErrorHandler			_errorHandler;
 	MyWarningHandler		_warningHandler;
+	SerialExecutor			_actionExecutor;
+	TaskScheduler			_scheduler;
 };
 
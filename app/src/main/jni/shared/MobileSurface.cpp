@@ -1,22 +1,34 @@
 
 #include "MobileApp.h"
 #include "MobileSurface.h"
+#include "Startup.h"
+#include "ThreadPlacement.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <string.h>
+#include <unistd.h>
+
+// After the system headers: unistd.h declares a dprintf function
 #include "dprintf.h"
 
 // g_android_platform_data is initialized in Android platforms
 HPS::PlatformData g_android_platform_data;
 
-void ShowPerformanceTestResult(float fps);
+void ShowPerformanceTestResult(SurfaceHandle surface, float fps);
+
+// Longest sleep of a real time replay between two checks of the cancel request, in microseconds
+static const int64_t REPLAY_CANCEL_POLL = 10000;
 
 MobileSurface::MobileSurface()
-	: _valid(false)
+	: _valid(false), _actionsCancelled(false), _handle(0), _batchDepth(0), _batchNeedsUpdate(false), _touchRing(nullptr), _touchRingSize(0), _updateCompletedHandler(this), _finishPictureHandler(this), _replaying(false), _replayStats(), _synchronousInput(false)
 {
 }
 
 bool MobileSurface::bind(void *window)
 {
-	// Ensure app is created
-	MobileApp::inst();
+	// The World is normally created by the time the first surface is bound
+	MobileApp::inst().waitForWorld();
 
     // Initialize if this is the first time called
 	if (_canvas.Type() == HPS::Type::None)
@@ -36,6 +48,10 @@ bool MobileSurface::bind(void *window)
         // Create view
 		HPS::View								view = HPS::Factory::CreateView("");
 		_canvas.AttachViewAsLayout(view);
+
+		_updateCompletedHandler.Subscribe(_canvas.GetWindowKey().GetEventDispatcher(), HPS::Object::ClassID<HPS::UpdateCompletedEvent>());
+		_canvas.GetWindowKey().SetDriverEventHandler(_finishPictureHandler, HPS::Object::ClassID<HPS::FinishPictureEvent>());
+		_selectionService.attach(_canvas.GetWindowKey(), _handle);
 	}
 	else if (_valid == false)
 	{
@@ -47,8 +63,10 @@ bool MobileSurface::bind(void *window)
 	touchesCancel();
 
 	_valid = true;
+	_actionsCancelled = false;
     _canvas.Update();
 
+	Startup::reached(Startup::SurfaceBound);
 	return true;
 }
 
@@ -56,12 +74,18 @@ bool MobileSurface::bind(void *window)
 void MobileSurface::release(int flags)
 {
 	// Perform blocking update to flush any current or pending updates, then signal that the surface is invalid.
-	HPS::UpdateNotifier notifier = _canvas.UpdateWithNotifier(HPS::Window::UpdateType::Complete);
-	notifier.Wait();
+	{
+		TRACE_SCOPE("update", "release::Wait");
+		HPS::UpdateNotifier notifier = _canvas.UpdateWithNotifier(HPS::Window::UpdateType::Complete);
+		notifier.Wait();
+	}
 
 	// Don't destroy canvas if we're only rotating the screen.
 	if ((flags & SCREEN_ROTATING) == 0)
 	{
+	    _selectionService.detach();
+	    _updateCompletedHandler.UnSubscribeEverything();
+	    _canvas.GetWindowKey().UnsetDriverEventHandler(HPS::Object::ClassID<HPS::FinishPictureEvent>());
 	    _canvas.Delete();
 	    HPS::Database::Synchronize();
 	}
@@ -78,19 +102,48 @@ void MobileSurface::refresh()
         _canvas.Update(HPS::Window::UpdateType::Refresh);
 }
 
-void MobileSurface::touchDown(int numTouches, int xposArray[], int yposArray[], HPS::TouchID idArray[], size_t tapCount)
+void MobileSurface::requestUpdate()
+{
+	if (_batchDepth > 0)
+		_batchNeedsUpdate = true;
+	else if (isValid())
+		_canvas.Update();
+}
+
+void MobileSurface::beginBatch()
+{
+	++_batchDepth;
+}
+
+void MobileSurface::endBatch()
+{
+	if (_batchDepth == 0 || --_batchDepth > 0)
+		return;
+
+	if (_batchNeedsUpdate)
+	{
+		_batchNeedsUpdate = false;
+		if (isValid())
+			_canvas.Update();
+	}
+}
+
+void MobileSurface::touchDown(int numTouches, int xposArray[], int yposArray[], HPS::TouchID idArray[], size_t tapCount, int64_t eventTime)
 {
-	InjectTouchEvent(HPS::TouchEvent::Action::TouchDown, numTouches, xposArray, yposArray, idArray, tapCount);
+	recordTouches(TouchRecording::Type::TouchDown, eventTime, numTouches, xposArray, yposArray, idArray, tapCount);
+	InjectTouchEvent(HPS::TouchEvent::Action::TouchDown, numTouches, xposArray, yposArray, idArray, tapCount, eventTime);
 }
 
-void MobileSurface::touchMove(int numTouches, int xposArray[], int yposArray[], HPS::TouchID idArray[])
+void MobileSurface::touchMove(int numTouches, int xposArray[], int yposArray[], HPS::TouchID idArray[], int64_t eventTime)
 {
-	InjectTouchEvent(HPS::TouchEvent::Action::Move, numTouches, xposArray, yposArray, idArray);
+	recordTouches(TouchRecording::Type::TouchMove, eventTime, numTouches, xposArray, yposArray, idArray);
+	InjectTouchEvent(HPS::TouchEvent::Action::Move, numTouches, xposArray, yposArray, idArray, 1, eventTime);
 }
 
-void MobileSurface::touchUp(int numTouches, int xposArray[], int yposArray[], HPS::TouchID idArray[])
+void MobileSurface::touchUp(int numTouches, int xposArray[], int yposArray[], HPS::TouchID idArray[], int64_t eventTime)
 {
-	InjectTouchEvent(HPS::TouchEvent::Action::TouchUp, numTouches, xposArray, yposArray, idArray);
+	recordTouches(TouchRecording::Type::TouchUp, eventTime, numTouches, xposArray, yposArray, idArray);
+	InjectTouchEvent(HPS::TouchEvent::Action::TouchUp, numTouches, xposArray, yposArray, idArray, 1, eventTime);
 }
 
 void MobileSurface::touchesCancel()
@@ -99,17 +152,66 @@ void MobileSurface::touchesCancel()
 	InjectTouchEvent(HPS::TouchEvent::Action::TouchUp, 0, 0, 0, 0);
 }
 
+bool MobileSurface::setTouchRing(void *memory, size_t bytes)
+{
+	if (memory == nullptr || reinterpret_cast<uintptr_t>(memory) % alignof(TouchSample) != 0 || bytes < sizeof(TouchSample))
+	{
+		eprintf("Invalid touch ring (%p, %u bytes)\n", memory, (unsigned)bytes);
+		_touchRing = nullptr;
+		_touchRingSize = 0;
+		return false;
+	}
+
+	_touchRing = static_cast<TouchSample *>(memory);
+	_touchRingSize = (int)(bytes / sizeof(TouchSample));
+	return true;
+}
+
+void MobileSurface::processTouchSamples(int first, int count)
+{
+	if (_touchRing == nullptr || first < 0 || count <= 0)
+		return;
+
+	// A move usually comes with the historical samples Android batched since the previous frame.
+	// Each one is injected with its own position and time so operators follow the exact finger path.
+	TRACE_COUNTER("touchSamplesPerCall", count);
+
+	for (int i = 0; i < count; ++i)
+	{
+		TouchSample & sample = _touchRing[(first + i) % _touchRingSize];
+		int const touches = sample.count < TouchSample::MAX_TOUCHES ? sample.count : TouchSample::MAX_TOUCHES;
+
+		switch (sample.action)
+		{
+			case TouchSample::Down:
+				touchDown(touches, sample.x, sample.y, sample.id, 1, sample.eventTime);
+				break;
+			case TouchSample::Move:
+				touchMove(touches, sample.x, sample.y, sample.id, sample.eventTime);
+				break;
+			case TouchSample::Up:
+				touchUp(touches, sample.x, sample.y, sample.id, sample.eventTime);
+				break;
+			case TouchSample::Cancel:
+				touchesCancel();
+				break;
+		}
+	}
+}
+
 void MobileSurface::singleTap(int x, int y)
 {
+	recordTouches(TouchRecording::Type::SingleTap, 0, 1, &x, &y, nullptr);
 	touchesCancel();
 }
 
 void MobileSurface::doubleTap(int x, int y, HPS::TouchID id)
 {
+    recordTouches(TouchRecording::Type::DoubleTap, 0, 1, &x, &y, &id);
     touchesCancel();
 }
 
-void MobileSurface::InjectTouchEvent(HPS::TouchEvent::Action action, int numTouches, int xposArray[], int yposArray[], HPS::TouchID idArray[], size_t tapCount)
+void MobileSurface::InjectTouchEvent(HPS::TouchEvent::Action action, int numTouches, int xposArray[], int yposArray[], HPS::TouchID idArray[], size_t tapCount, int64_t eventTime)
 {
     if (!isValid())
         return;
@@ -126,8 +228,28 @@ void MobileSurface::InjectTouchEvent(HPS::TouchEvent::Action action, int numTouc
 		touches.push_back(HPS::Touch(idArray[i], p, tapCount));
 	}
 
+	// Latency samples are attributed to the operator which receives the gesture
+	if (action == HPS::TouchEvent::Action::TouchDown && numTouches > 0)
+	{
+		HPS::OperatorPtr	op;
+		if (_canvas.GetFrontView().GetOperatorControl().ShowTop(op))
+		{
+			HPS::UTF8 name = op->GetName();
+			const char * bytes = name.GetBytes();
+			if (strncmp(bytes, "HPS_", 4) == 0)
+				bytes += 4;
+			_latencyMonitor.beginGesture(bytes);
+		}
+	}
+
 	HPS::TouchEvent			event(action, touches);
-	windowKey.GetEventDispatcher().InjectEvent(event);
+	if (_synchronousInput)
+		windowKey.GetEventDispatcher().InjectEventWithNotifier(event).Wait();
+	else
+		windowKey.GetEventDispatcher().InjectEvent(event);
+
+	if (action == HPS::TouchEvent::Action::Move && eventTime != 0)
+		_latencyMonitor.inputInjected(eventTime);
 }
 
 void MobileSurface::testPerformance()
@@ -141,6 +263,7 @@ void MobileSurface::testPerformance()
 	HPS::Time now;
 	do
 	{
+		TRACE_SCOPE("update", "testPerformance::Wait");
 		camera_control.Orbit(9, 0);
 		window_key.UpdateWithNotifier().Wait();
 		now = HPS::Database::GetTime();
@@ -149,6 +272,233 @@ void MobileSurface::testPerformance()
 
 	double const fps = 1000.0 * num_updates / (now - start);
 
-	ShowPerformanceTestResult(fps);
+	ShowPerformanceTestResult(_handle, fps);
+}
+
+void MobileSurface::beginTouchRecording()
+{
+	if (!isValid())
+		return;
+
+	HPS::CameraKit		camera;
+	_canvas.GetFrontView().GetSegmentKey().ShowCamera(camera);
+
+	unsigned int		width = 0, height = 0;
+	_canvas.GetWindowKey().GetWindowInfoControl().ShowWindowPixels(width, height);
+
+	std::lock_guard<std::mutex> lock(_recordingMutex);
+	_recording.reset(new TouchRecording());
+	_recording->begin(camera, width, height);
+}
+
+bool MobileSurface::endTouchRecording(const char *fileName)
+{
+	std::unique_ptr<TouchRecording>	recording;
+	{
+		std::lock_guard<std::mutex> lock(_recordingMutex);
+		recording.swap(_recording);
+	}
+
+	if (!recording)
+		return false;
+
+	dprintf("Saving %u touch events to %s\n", (unsigned)recording->entries().size(), fileName);
+	return recording->save(fileName);
+}
+
+bool MobileSurface::isRecordingTouches()
+{
+	std::lock_guard<std::mutex> lock(_recordingMutex);
+	return _recording != nullptr;
+}
+
+void MobileSurface::recordTouches(TouchRecording::Type type, int64_t eventTime, int numTouches, int xPosArray[], int yPosArray[], HPS::TouchID idArray[], size_t tapCount)
+{
+	std::lock_guard<std::mutex> lock(_recordingMutex);
+
+	// The events sent by a replay are not part of the user's interaction
+	if (!_recording || _replaying)
+		return;
+
+	_recording->add(type, eventTime != 0 ? eventTime : Trace::Now(), numTouches, xPosArray, yPosArray, idArray, tapCount);
+}
+
+bool MobileSurface::replayTouchRecording(const char *fileName, bool realTime)
+{
+	float stats[TouchRecording::ReplayStatCount] = {};
+	{
+		std::lock_guard<std::mutex> lock(_recordingMutex);
+		memset(_replayStats, 0, sizeof(_replayStats));
+	}
+
+	if (!isValid())
+		return false;
+
+	TouchRecording		recording;
+	if (!recording.load(fileName))
+		return false;
+
+	TRACE_SCOPE("replay", "replayTouchRecording");
+
+	// Touches are in pixels: rescale them if the surface size changed since the recording
+	unsigned int		width = 0, height = 0;
+	_canvas.GetWindowKey().GetWindowInfoControl().ShowWindowPixels(width, height);
+	float const			scaleX = recording.width() != 0 ? (float)width / recording.width() : 1.0f;
+	float const			scaleY = recording.height() != 0 ? (float)height / recording.height() : 1.0f;
+
+	// Start from the same view, with no touch tracked and nothing left to draw
+	touchesCancel();
+	_canvas.GetFrontView().GetSegmentKey().SetCamera(recording.camera());
+	_canvas.UpdateWithNotifier(HPS::Window::UpdateType::Complete).Wait();
+
+	{
+		std::lock_guard<std::mutex> lock(_recordingMutex);
+		_replaying = true;
+		_replayFrameTimes.clear();
+	}
+	_synchronousInput = !realTime;
+
+	int64_t const		start = Trace::Now();
+	size_t				replayed = 0;
+	for (auto const & entry : recording.entries())
+	{
+		// The activity was paused or rotated: release() is waiting for the replay
+		if (_actionsCancelled)
+			break;
+
+		if (realTime)
+		{
+			int64_t wait;
+			while ((wait = start + entry.time - Trace::Now()) > 0 && !_actionsCancelled)
+				usleep((useconds_t)std::min<int64_t>(wait, REPLAY_CANCEL_POLL));
+			if (_actionsCancelled)
+				break;
+		}
+
+		replayEntry(recording, entry, scaleX, scaleY);
+		++replayed;
+
+		if (!realTime)
+			_canvas.UpdateWithNotifier().Wait();
+	}
+
+	if (!_actionsCancelled)
+		_canvas.UpdateWithNotifier().Wait();
+
+	int64_t const		duration = Trace::Now() - start;
+	_synchronousInput = false;
+
+	std::vector<HPS::Time>	frames;
+	{
+		std::lock_guard<std::mutex> lock(_recordingMutex);
+		_replaying = false;
+		frames.swap(_replayFrameTimes);
+	}
+
+	stats[TouchRecording::EventCount] = (float)replayed;
+	stats[TouchRecording::FrameCount] = (float)frames.size();
+	stats[TouchRecording::Duration] = duration / 1000.0f;
+
+	if (!frames.empty())
+	{
+		std::sort(frames.begin(), frames.end());
+
+		HPS::Time sum = 0;
+		for (HPS::Time t : frames)
+			sum += t;
+
+		stats[TouchRecording::MeanFrameTime] = (float)(sum / frames.size());
+		stats[TouchRecording::MedianFrameTime] = (float)frames[frames.size() / 2];
+		stats[TouchRecording::Percentile95FrameTime] = (float)frames[std::min(frames.size() - 1, frames.size() * 95 / 100)];
+		stats[TouchRecording::MaxFrameTime] = (float)frames.back();
+		if (duration > 0)
+			stats[TouchRecording::FramesPerSecond] = frames.size() * 1000000.0f / duration;
+	}
+
+	dprintf("Replayed %u touch events from %s: %u frames in %.0f ms, p50 %.1f ms, p95 %.1f ms, max %.1f ms, %.1f fps\n",
+		(unsigned)replayed, fileName, (unsigned)frames.size(), stats[TouchRecording::Duration],
+		stats[TouchRecording::MedianFrameTime], stats[TouchRecording::Percentile95FrameTime],
+		stats[TouchRecording::MaxFrameTime], stats[TouchRecording::FramesPerSecond]);
+
+	{
+		std::lock_guard<std::mutex> lock(_recordingMutex);
+		memcpy(_replayStats, stats, sizeof(_replayStats));
+	}
+	return replayed == recording.entries().size();
 }
 
+void MobileSurface::showReplayStats(float stats[])
+{
+	std::lock_guard<std::mutex> lock(_recordingMutex);
+	memcpy(stats, _replayStats, sizeof(_replayStats));
+}
+
+void MobileSurface::replayEntry(TouchRecording const & recording, TouchRecording::Entry const & entry, float scaleX, float scaleY)
+{
+	TouchRecording::Touch const *	touches = recording.touches(entry);
+	int const						count = (int)entry.touchCount;
+
+	std::vector<int>				x(count), y(count);
+	std::vector<HPS::TouchID>		ids(count);
+	for (int i = 0; i < count; ++i)
+	{
+		x[i] = (int)(touches[i].x * scaleX + 0.5f);
+		y[i] = (int)(touches[i].y * scaleY + 0.5f);
+		ids[i] = touches[i].id;
+	}
+
+	// Fresh event times so touch latency is measured for the replay as well
+	int64_t const					eventTime = Trace::Now();
+
+	switch (entry.type)
+	{
+		case TouchRecording::Type::TouchDown:
+			touchDown(count, x.data(), y.data(), ids.data(), entry.tapCount, eventTime);
+			break;
+		case TouchRecording::Type::TouchMove:
+			touchMove(count, x.data(), y.data(), ids.data(), eventTime);
+			break;
+		case TouchRecording::Type::TouchUp:
+			touchUp(count, x.data(), y.data(), ids.data(), eventTime);
+			break;
+		case TouchRecording::Type::SingleTap:
+			if (count > 0)
+				singleTap(x[0], y[0]);
+			break;
+		case TouchRecording::Type::DoubleTap:
+			if (count > 0)
+				doubleTap(x[0], y[0], ids[0]);
+			break;
+	}
+}
+
+void MobileSurface::FinishPictureHandler::Handle(HPS::DriverEvent const * in_event)
+{
+	ThreadPlacement::apply(ThreadPlacement::Latency);
+	_surface->_latencyMonitor.framePresented(Trace::Now());
+}
+
+HPS::EventHandler::HandleResult MobileSurface::UpdateCompletedHandler::Handle(HPS::Event const * in_event)
+{
+	ThreadPlacement::apply(ThreadPlacement::Latency);
+	Startup::reached(Startup::FirstFrame);
+
+	HPS::UpdateCompletedEvent const * event = static_cast<HPS::UpdateCompletedEvent const *>(in_event);
+
+#ifdef USING_TRACING
+	// update_time is in milliseconds and the event arrives right after the update finished
+	int64_t const duration = (int64_t)(event->update_time * 1000.0);
+	TRACE_COMPLETE("update", "Canvas::Update", Trace::Now() - duration, duration);
+#endif
+
+	{
+		std::lock_guard<std::mutex> lock(_surface->_recordingMutex);
+		if (_surface->_replaying)
+			_surface->_replayFrameTimes.push_back(event->update_time);
+	}
+
+	_surface->onUpdateCompleted(event->update_time, event->update_status);
+
+	// Leave the event for any other subscriber
+	return HandleResult::NotHandled;
+}
@@ -7,6 +7,17 @@
 #include "sprk_exchange.h"
 #endif
 
+#include "LatencyMonitor.h"
+#include "SurfaceRegistry.h"
+#include "SelectionService.h"
+#include "TouchRecording.h"
+#include "TouchRing.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 // MobileSurface is a plaform-independent base class which gui code will communicate with
 //  to handle surface creation/updates/destruction, as well as input events.
 // Users *should not* modify this class; instead, users should modify UserMobileSurface.
@@ -36,30 +47,135 @@ public:
     // Called to explicitly update the HPS surface
     virtual void    refresh();
 
+    // Actions call requestUpdate() instead of Canvas::Update().  Between beginBatch() and endBatch()
+    //  the requests are merged into the single update issued by endBatch() (see the generated
+    //  command buffer in AndroidUserMobileSurfaceViewJNI.cpp).  Batches nest; action executor only.
+	void			requestUpdate();
+	void			beginBatch();
+	void			endBatch();
+
+    // bind(), release(), refresh() and the actions run on MobileApp's action executor, one at a time.
+    // Long actions (file loads, scene generation, replays) poll actionsCancelled() and stop early:
+    //  the gui calls cancelActions() before queuing release(), so it never waits for one to finish.
+    //  bind() clears the request.
+    // Touch input and taps come straight from the UI thread: they only read the canvas and queue
+    //  events to the window's event dispatcher, whose thread runs the operators, so they never
+    //  change the scene themselves and may run while an action does.
+
     // Touch Down/Move/Up Input Events
-	virtual void	touchDown(int numTouches, int xPosArray[], int yPosArray[], HPS::TouchID idArray[], size_t tapCount);
-	virtual void	touchMove(int numTouches, int xPosArray[], int yPosArray[], HPS::TouchID idArray[]);
-	virtual void	touchUp(int numTouches, int xPosArray[], int yPosArray[], HPS::TouchID idArray[]);
+    // eventTime is the MotionEvent time in CLOCK_MONOTONIC microseconds (0 if unknown), used to measure touch latency
+	virtual void	touchDown(int numTouches, int xPosArray[], int yPosArray[], HPS::TouchID idArray[], size_t tapCount, int64_t eventTime = 0);
+	virtual void	touchMove(int numTouches, int xPosArray[], int yPosArray[], HPS::TouchID idArray[], int64_t eventTime = 0);
+	virtual void	touchUp(int numTouches, int xPosArray[], int yPosArray[], HPS::TouchID idArray[], int64_t eventTime = 0);
     
     // Called when tracked touches should be cancelled
     virtual void    touchesCancel();
+
+    // Touch samples shared with the gui (see TouchRing.h).  The ring memory is owned by the gui.
+    // processTouchSamples() sends 'count' samples starting at slot 'first' through touchDown/touchMove/touchUp,
+    //  in order; a move arrives with all its historical samples in a single call.
+	bool			setTouchRing(void *memory, size_t bytes);
+	void			processTouchSamples(int first, int count);
     
     // Single/double-tap gestures
 	virtual void	singleTap(int x, int y);
 	virtual void	doubleTap(int x, int y, HPS::TouchID id);
 
+	void			cancelActions() { _actionsCancelled = true; }
+	std::atomic<bool> const &	actionsCancelled() const { return _actionsCancelled; }
+
     // Return HPS::Canvas instance associated with this surface
 	HPS::Canvas		GetCanvas() const { return _canvas; }
 
+    // Handle given to the gui by SurfaceRegistry, which routes callbacks to this surface's view
+	SurfaceHandle	GetHandle() const { return _handle; }
+
+    // Touch-to-photon latency histograms, per operator
+	LatencyMonitor &	GetLatencyMonitor() { return _latencyMonitor; }
+
+    // Asynchronous selection and highlighting in this surface's window
+	SelectionService &	GetSelectionService() { return _selectionService; }
+
+    // Touch stream recording and replay (see TouchRecording.h).
+    // replayTouchRecording restores the camera the recording started with, then sends the events again through
+    //  touchDown/touchMove/touchUp/singleTap/doubleTap.  With realTime the recorded timing is kept; otherwise each
+    //  event is handled and drawn before the next one, which makes runs comparable between builds.
+    // A replay blocks until its last frame is drawn, so it must not run on the UI thread.  showReplayStats fills
+    //  'stats' with TouchRecording::ReplayStatCount values describing the frames drawn during the latest replay.
+	void			beginTouchRecording();
+	bool			endTouchRecording(const char *fileName);
+	bool			isRecordingTouches();
+	bool			replayTouchRecording(const char *fileName, bool realTime);
+	void			showReplayStats(float stats[]);
+
 protected:
-	void InjectTouchEvent(HPS::TouchEvent::Action action, int numTouches, int xposArray[], int yposArray[], HPS::TouchID idArray[], size_t tapCount = 1);
+	// Records the duration of every completed canvas update
+	class UpdateCompletedHandler : public HPS::EventHandler
+	{
+	public:
+		UpdateCompletedHandler(MobileSurface *surface) : HPS::EventHandler(), _surface(surface) {}
+		virtual ~UpdateCompletedHandler() { Shutdown(); }
+
+		virtual HandleResult Handle(HPS::Event const * in_event);
+
+	private:
+		MobileSurface *	_surface;
+	};
+
+	// Closes pending touch latency samples when a frame is put on screen (driver thread)
+	class FinishPictureHandler : public HPS::DriverEventHandler
+	{
+	public:
+		FinishPictureHandler(MobileSurface *surface) : HPS::DriverEventHandler(), _surface(surface) {}
+
+		virtual void Handle(HPS::DriverEvent const * in_event);
+
+	private:
+		MobileSurface *	_surface;
+	};
+
+	// Called on the HPS event thread after every completed canvas update.  updateTime is in milliseconds.
+	virtual void	onUpdateCompleted(HPS::Time updateTime, HPS::Window::UpdateStatus status) {}
+
+	void InjectTouchEvent(HPS::TouchEvent::Action action, int numTouches, int xposArray[], int yposArray[], HPS::TouchID idArray[], size_t tapCount = 1, int64_t eventTime = 0);
 	void testPerformance();
 	
 private:
+	friend class SurfaceRegistry;
+
+	void			recordTouches(TouchRecording::Type type, int64_t eventTime, int numTouches, int xPosArray[], int yPosArray[], HPS::TouchID idArray[], size_t tapCount = 1);
+	void			replayEntry(TouchRecording const & recording, TouchRecording::Entry const & entry, float scaleX, float scaleY);
+
+
 	bool			_valid;
+	std::atomic<bool>	_actionsCancelled;
 	HPS::Canvas		_canvas;
+	SurfaceHandle	_handle;
+
+	int				_batchDepth;
+	bool			_batchNeedsUpdate;
+
+	TouchSample *	_touchRing;
+	int				_touchRingSize;
+
+	UpdateCompletedHandler	_updateCompletedHandler;
+	FinishPictureHandler	_finishPictureHandler;
+	LatencyMonitor			_latencyMonitor;
+	SelectionService		_selectionService;
+
+	// Touch recording/replay state, shared between the UI thread and the HPS event thread
+	std::mutex				_recordingMutex;
+	std::unique_ptr<TouchRecording>	_recording;
+	bool					_replaying;
+	std::vector<HPS::Time>	_replayFrameTimes;
+	float					_replayStats[TouchRecording::ReplayStatCount];
+
+	// While set, InjectTouchEvent waits for each event to be handled.  Set by a replay on the
+	//  action executor, read by touches from the UI thread.
+	std::atomic<bool>		_synchronousInput;
 };
 
-// Users must implement createMobileSurface() to return a pointer to their derived MobileSurface
+// Users must implement createMobileSurface() to return a new instance of their derived MobileSurface.
+//  The gui hands it to SurfaceRegistry, which owns it from then on.
 MobileSurface *createMobileSurface(int guiSurfaceId);
 
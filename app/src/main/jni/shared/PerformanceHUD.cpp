@@ -0,0 +1,264 @@
+#include "PerformanceHUD.h"
+
+#include <stdio.h>
+
+#include "dprintf.h"
+
+namespace
+{
+	// Minimum time between two HUD rebuilds, in milliseconds
+	const HPS::Time		REBUILD_INTERVAL = 250.0;
+
+	// Frame time mapped to the top of the graph, in milliseconds
+	const HPS::Time		GRAPH_RANGE = 50.0;
+
+	// Graph and text placement in window space (-1..1)
+	const float			GRAPH_LEFT = -0.95f;
+	const float			GRAPH_RIGHT = -0.35f;
+	const float			GRAPH_BOTTOM = -0.95f;
+	const float			GRAPH_TOP = -0.65f;
+	const float			TEXT_LEFT = -0.97f;
+	const float			TEXT_TOP = 0.95f;
+	const float			TEXT_SIZE = 0.028f;
+	const float			LINE_SPACING = 0.065f;
+
+	const char * statusName(HPS::Window::UpdateStatus status)
+	{
+		switch (status)
+		{
+			case HPS::Window::UpdateStatus::InProgress:		return "in progress";
+			case HPS::Window::UpdateStatus::Completed:		return "completed";
+			case HPS::Window::UpdateStatus::TimedOut:		return "timed out";
+			case HPS::Window::UpdateStatus::Interrupted:	return "interrupted";
+			case HPS::Window::UpdateStatus::Failed:			return "failed";
+		}
+		return "unknown";
+	}
+
+	const char * staticModelName(HPS::Performance::StaticModel model)
+	{
+		switch (model)
+		{
+			case HPS::Performance::StaticModel::None:				return "none";
+			case HPS::Performance::StaticModel::Attribute:			return "attribute";
+			case HPS::Performance::StaticModel::AttributeSpatial:	return "attribute+spatial";
+		}
+		return "unknown";
+	}
+
+	float graphY(HPS::Time frameTime)
+	{
+		float t = (float)(frameTime / GRAPH_RANGE);
+		if (t > 1.0f)
+			t = 1.0f;
+		return GRAPH_BOTTOM + t * (GRAPH_TOP - GRAPH_BOTTOM);
+	}
+}
+
+PerformanceHUD::PerformanceHUD()
+	: _latency(nullptr), _frameCount(0), _lastStatus(HPS::Window::UpdateStatus::Completed), _lastRebuild(0)
+{
+}
+
+PerformanceHUD::~PerformanceHUD()
+{
+}
+
+void PerformanceHUD::show(HPS::Canvas const & canvas, LatencyMonitor *latency)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (_segment.Type() != HPS::Type::None)
+		return;
+
+	_canvas = canvas;
+	_latency = latency;
+	_segment = _canvas.GetWindowKey().Subsegment("performance_hud");
+
+	// Draw in window space, on top of the scene, without touching the rest of the tree
+	_segment.SetCamera(HPS::CameraKit()
+		.SetPosition(HPS::Point(0, 0, -5))
+		.SetTarget(HPS::Point(0, 0, 0))
+		.SetUpVector(HPS::Vector(0, 1, 0))
+		.SetField(2, 2)
+		.SetProjection(HPS::Camera::Projection::Stretched));
+	_segment.GetDrawingAttributeControl().SetOverlay(HPS::Drawing::Overlay::Default);
+	_segment.GetVisibilityControl().SetLines(true).SetText(true).SetFaces(false).SetEdges(false).SetMarkers(false);
+	_segment.GetMaterialMappingControl()
+		.SetTextColor(HPS::RGBAColor(0.2f, 1.0f, 0.2f))
+		.SetLineColor(HPS::RGBAColor(0.2f, 1.0f, 0.2f));
+	_segment.GetTextAttributeControl()
+		.SetAlignment(HPS::Text::Alignment::TopLeft)
+		.SetSize(TEXT_SIZE, HPS::Text::SizeUnits::WindowRelative);
+	_segment.Subsegment("reference").GetMaterialMappingControl().SetLineColor(HPS::RGBAColor(0.6f, 0.6f, 0.6f));
+
+	rebuild();
+	_lastRebuild = HPS::Database::GetTime();
+	_ownUpdate = _canvas.UpdateWithNotifier();
+}
+
+void PerformanceHUD::hide()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (_segment.Type() == HPS::Type::None)
+		return;
+
+	_segment.Delete();
+	_ownUpdate = HPS::UpdateNotifier();
+	_canvas.Update();
+	_canvas = HPS::Canvas();
+}
+
+bool PerformanceHUD::isVisible()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _segment.Type() != HPS::Type::None;
+}
+
+void PerformanceHUD::recordFrame(HPS::Time updateTime, HPS::Window::UpdateStatus status)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// The update which only redrew the HUD itself says nothing about the model.  Updates
+	//  completing while it is still queued or drawing were requested before it: they count.
+	if (!_ownUpdate.Empty() && _ownUpdate.Status() != HPS::Window::UpdateStatus::InProgress)
+	{
+		_ownUpdate = HPS::UpdateNotifier();
+		return;
+	}
+
+	_frameTimes[_frameCount % FRAME_HISTORY] = updateTime;
+	++_frameCount;
+	_lastStatus = status;
+
+	if (_segment.Type() == HPS::Type::None)
+		return;
+
+	HPS::Time const now = HPS::Database::GetTime();
+	if (now - _lastRebuild < REBUILD_INTERVAL)
+		return;
+
+	rebuild();
+	_lastRebuild = now;
+	_ownUpdate = _canvas.UpdateWithNotifier();
+}
+
+void PerformanceHUD::clearImportTimings()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_importTimings.clear();
+}
+
+void PerformanceHUD::addImportTiming(const char *phase, HPS::Time milliseconds)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_importTimings.push_back(std::make_pair(std::string(phase), milliseconds));
+}
+
+// Must be called with _mutex held
+void PerformanceHUD::rebuild()
+{
+	_segment.Flush(HPS::Search::Type::Geometry, HPS::Search::Space::Subsegments);
+
+	char			line[256];
+	float			y = TEXT_TOP;
+	auto			addLine = [&]() { _segment.InsertText(HPS::Point(TEXT_LEFT, y, 0), line); y -= LINE_SPACING; };
+
+	// Frame times
+	size_t const	frames = _frameCount < FRAME_HISTORY ? _frameCount : FRAME_HISTORY;
+	HPS::Time		sum = 0, worst = 0, last = 0;
+	for (size_t i = 0; i < frames; ++i)
+	{
+		HPS::Time t = _frameTimes[(_frameCount - 1 - i) % FRAME_HISTORY];
+		if (i == 0)
+			last = t;
+		sum += t;
+		if (t > worst)
+			worst = t;
+	}
+	snprintf(line, sizeof(line), "frame %.1f ms  avg %.1f  max %.1f  (%s)", last, frames ? sum / frames : 0.0, worst, statusName(_lastStatus));
+	addLine();
+
+	// Triangles drawn by the last update
+	HPS::UpdateInfo		info;
+	if (_canvas.GetWindowKey().GetWindowInfoControl().ShowLastUpdateInfo(info))
+	{
+		snprintf(line, sizeof(line), "triangles %u  segments %u  culled %u",
+			(unsigned)(info.triangle_3d_count + info.triangle_dc_count + info.display_list_triangle_3d_count),
+			(unsigned)info.segment_count,
+			(unsigned)(info.frustum_culled_segment_count + info.extent_culled_segment_count + info.vector_culled_segment_count));
+		addLine();
+	}
+
+	// HPS database memory
+	size_t			allocated = 0, used = 0;
+	HPS::Database::ShowMemoryUsage(allocated, used);
+	snprintf(line, sizeof(line), "memory %.1f MB used / %.1f MB allocated", used / (1024.0 * 1024.0), allocated / (1024.0 * 1024.0));
+	addLine();
+
+	// Active performance settings
+	HPS::Layout		layout = _canvas.GetAttachedLayout();
+	if (layout.Type() != HPS::Type::None && layout.GetLayerCount() > 0)
+	{
+		HPS::View		view = layout.GetFrontView();
+		HPS::Model		model = view.GetAttachedModel();
+
+		HPS::Performance::StaticModel	staticModel = HPS::Performance::StaticModel::None;
+		if (model.Type() != HPS::Type::None)
+			model.GetSegmentKey().GetPerformanceControl().ShowStaticModel(staticModel);
+
+		bool			frustum = true, extent = true, vector = false;
+		unsigned int	extentPixels = 0;
+		HPS::Vector		vectorDirection;
+		HPS::CullingControl	culling = view.GetSegmentKey().GetCullingControl();
+		culling.ShowFrustum(frustum);
+		culling.ShowExtent(extent, extentPixels);
+		culling.ShowVector(vector, vectorDirection);
+
+		snprintf(line, sizeof(line), "static model %s  culling: frustum %s  extent %s (%upx)  vector %s",
+			staticModelName(staticModel), frustum ? "on" : "off", extent ? "on" : "off", extentPixels, vector ? "on" : "off");
+		addLine();
+	}
+
+	// Import phases of the last loaded file
+	for (auto const & timing : _importTimings)
+	{
+		snprintf(line, sizeof(line), "%s %.0f ms", timing.first.c_str(), timing.second);
+		addLine();
+	}
+
+	// Touch-to-photon latency, one line per operator
+	if (_latency != nullptr)
+	{
+		std::string const summary = _latency->summary();
+		size_t begin = 0;
+		while (begin < summary.size())
+		{
+			size_t end = summary.find('\n', begin);
+			if (end == std::string::npos)
+				end = summary.size();
+			snprintf(line, sizeof(line), "%s", summary.substr(begin, end - begin).c_str());
+			addLine();
+			begin = end + 1;
+		}
+	}
+
+	// Frame time graph, oldest frame on the left, with 60 and 30 fps reference lines
+	HPS::SegmentKey	reference = _segment.Subsegment("reference");
+	reference.InsertLine(HPS::Point(GRAPH_LEFT, graphY(1000.0 / 60.0), 0), HPS::Point(GRAPH_RIGHT, graphY(1000.0 / 60.0), 0));
+	reference.InsertLine(HPS::Point(GRAPH_LEFT, graphY(1000.0 / 30.0), 0), HPS::Point(GRAPH_RIGHT, graphY(1000.0 / 30.0), 0));
+
+	if (frames > 1)
+	{
+		HPS::PointArray	graph;
+		graph.reserve(frames);
+		for (size_t i = 0; i < frames; ++i)
+		{
+			HPS::Time t = _frameTimes[(_frameCount - frames + i) % FRAME_HISTORY];
+			float x = GRAPH_LEFT + (GRAPH_RIGHT - GRAPH_LEFT) * i / (FRAME_HISTORY - 1);
+			graph.push_back(HPS::Point(x, graphY(t), 0));
+		}
+		_segment.InsertLine(graph);
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "hps.h"
+#include "sprk.h"
+#include "LatencyMonitor.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+// PerformanceHUD draws frame statistics on top of the scene so slow models can be
+//  diagnosed on the device itself: a frame time graph, the last update status,
+//  triangle count, HPS memory usage, the import phase timings, the active
+//  culling/static model settings and the touch latency percentiles.
+//
+// The HUD lives in an overlay segment under the window key, so rewriting it never
+//  invalidates the static model or forces a full redraw.  It is rebuilt at most
+//  a few times per second, and only in response to updates that already happened.
+
+class PerformanceHUD
+{
+public:
+	PerformanceHUD();
+	~PerformanceHUD();
+
+	void			show(HPS::Canvas const & canvas, LatencyMonitor *latency = nullptr);
+	void			hide();
+	bool			isVisible();
+
+	// Called for every completed update (on the HPS event thread)
+	void			recordFrame(HPS::Time updateTime, HPS::Window::UpdateStatus status);
+
+	// Import phase timings shown by the HUD, in milliseconds
+	void			clearImportTimings();
+	void			addImportTiming(const char *phase, HPS::Time milliseconds);
+
+private:
+	PerformanceHUD(PerformanceHUD const &);
+	void operator=(PerformanceHUD const &);
+
+	void			rebuild();
+
+	static const size_t		FRAME_HISTORY = 64;
+
+	std::mutex				_mutex;
+	HPS::Canvas				_canvas;
+	HPS::SegmentKey			_segment;
+	LatencyMonitor *		_latency;
+
+	HPS::Time				_frameTimes[FRAME_HISTORY];
+	size_t					_frameCount;
+	HPS::Window::UpdateStatus	_lastStatus;
+
+	HPS::Time				_lastRebuild;
+	HPS::UpdateNotifier		_ownUpdate;		// Last update which only redrew the HUD
+
+	std::vector<std::pair<std::string, HPS::Time>>	_importTimings;
+};
@@ -0,0 +1,226 @@
+#include "Preselection.h"
+#include "SpatialIndex.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <math.h>
+
+const char * const Preselection::STYLE_NAME = "preselection";
+const float Preselection::RAY_BUDGET = 4.0f;
+const float Preselection::FRAME_TIME = 16.7f;
+const float Preselection::CELL_SIZE = 0.01f;
+
+namespace
+{
+	// Boxes beyond this many along the ray are not worth telling apart
+	const size_t		MAX_CANDIDATES = 8;
+}
+
+Preselection::Preselection(SpatialIndex const & index)
+	: _index(index), _highlighting(false), _useCount(0), _frameStart(0), _raySpent(0), _rayCost(2.0)
+{
+}
+
+Preselection::~Preselection()
+{
+	detach();
+}
+
+void Preselection::attach(HPS::Canvas const & canvas)
+{
+	// bind() calls this again after each rotation
+	if (_canvas.Type() != HPS::Type::None)
+		return;
+
+	_canvas = canvas;
+
+	_style = HPS::Database::CreateRootSegment();
+	_style.GetMaterialMappingControl()
+		.SetFaceColor(HPS::RGBAColor(0.25f, 0.75f, 1.0f))
+		.SetLineColor(HPS::RGBAColor(0.25f, 0.75f, 1.0f));
+
+	_portfolio = HPS::Database::CreatePortfolio();
+	_portfolio.DefineNamedStyle(STYLE_NAME, _style);
+	_canvas.GetWindowKey().GetPortfolioControl().Push(_portfolio);
+}
+
+void Preselection::detach()
+{
+	if (_canvas.Type() == HPS::Type::None)
+		return;
+
+	end();
+
+	// Portfolios pushed after ours stay in use: remove ours by key
+	HPS::PortfolioControl portfolios = _canvas.GetWindowKey().GetPortfolioControl();
+	HPS::PortfolioKeyArray inUse;
+	portfolios.Show(inUse);
+	inUse.erase(std::remove(inUse.begin(), inUse.end(), _portfolio), inUse.end());
+	if (inUse.empty())
+		portfolios.UnsetEverything();
+	else
+		portfolios.Set(inUse);
+	_portfolio.Delete();
+	_style.Delete();
+	_canvas = HPS::Canvas();
+}
+
+HPS::HighlightOptionsKit Preselection::highlightOptions() const
+{
+	HPS::HighlightOptionsKit options(STYLE_NAME);
+	options.SetOverlay(HPS::Drawing::Overlay::WithZValues);
+	return options;
+}
+
+bool Preselection::hover(HPS::WindowPoint const & location)
+{
+	if (_canvas.Type() == HPS::Type::None)
+		return false;
+
+	TRACE_SCOPE("selection", "Preselection::hover");
+
+	int const cellX = (int)floorf(location.x / CELL_SIZE);
+	int const cellY = (int)floorf(location.y / CELL_SIZE);
+
+	CacheEntry * entry = nullptr;
+	for (auto & cached : _cache)
+	{
+		if (cached.cellX == cellX && cached.cellY == cellY)
+		{
+			entry = &cached;
+			break;
+		}
+	}
+
+	if (entry == nullptr)
+	{
+		bool found;
+		HPS::KeyPath path;
+		if (!pick(location, found, path))
+			return false;		// Keep the current highlight
+
+		if (_cache.size() < CACHE_SIZE)
+			_cache.push_back(CacheEntry());
+		else
+		{
+			auto oldest = _cache.begin();
+			for (auto it = _cache.begin(); it != _cache.end(); ++it)
+			{
+				if (it->lastUse < oldest->lastUse)
+					oldest = it;
+			}
+			_cache.erase(oldest);
+			_cache.push_back(CacheEntry());
+		}
+
+		entry = &_cache.back();
+		entry->cellX = cellX;
+		entry->cellY = cellY;
+		entry->found = found;
+		entry->path = path;
+	}
+	entry->lastUse = ++_useCount;
+
+	if (entry->found == _highlighting && (!entry->found || entry->path == _highlighted))
+		return false;
+
+	setHighlight(entry->found ? &entry->path : nullptr);
+	return true;
+}
+
+void Preselection::end()
+{
+	_cache.clear();
+	if (_highlighting)
+		setHighlight(nullptr);
+}
+
+bool Preselection::pick(HPS::WindowPoint const & location, bool & found, HPS::KeyPath & path)
+{
+	found = false;
+
+	HPS::Point origin;
+	HPS::Vector direction;
+	if (!SpatialIndex::pickRay(_canvas, location, origin, direction))
+		return false;
+
+	std::vector<SpatialIndex::Hit> candidates;
+	bool const indexed = _index.isReady();
+	if (indexed)
+	{
+		_index.raycast(origin, direction, MAX_CANDIDATES, candidates);
+		if (candidates.empty())
+			return true;
+		if (candidates.size() == 1)
+		{
+			found = true;
+			path = SpatialIndex::keyPath(candidates[0].item, _canvas);
+			return true;
+		}
+	}
+
+	if (!rayAllowed())
+	{
+		TRACE_INSTANT("selection", "overBudget");
+		if (!indexed)
+			return false;
+
+		found = true;
+		path = SpatialIndex::keyPath(candidates[0].item, _canvas);
+		return true;
+	}
+
+	HPS::Model model = _canvas.GetFrontView().GetAttachedModel();
+	HPS::SelectionOptionsKit options;
+	options.SetScope(model.GetSegmentKey())
+		.SetLevel(HPS::Selection::Level::Entity)
+		.SetAlgorithm(HPS::Selection::Algorithm::Analytic)
+		.SetRelatedLimit(0)
+		.SetSorting(true)
+		.SetInternalLimit(0);
+
+	HPS::SelectionResults results;
+	HPS::Time const start = HPS::Database::GetTime();
+	{
+		TRACE_SCOPE("selection", "SelectByRay");
+		HPS::Database::SelectByRay(origin, direction, options, results);
+	}
+	HPS::Time const cost = HPS::Database::GetTime() - start;
+	_raySpent += cost;
+	_rayCost += 0.25 * (cost - _rayCost);
+
+	HPS::SelectionResultsIterator it = results.GetIterator();
+	if (it.IsValid() && it.GetItem().ShowPath(path))
+	{
+		found = true;
+		path.Append(SpatialIndex::viewPath(_canvas));
+	}
+	return true;
+}
+
+bool Preselection::rayAllowed()
+{
+	HPS::Time const now = HPS::Database::GetTime();
+	if (now - _frameStart >= FRAME_TIME)
+	{
+		_frameStart = now;
+		_raySpent = 0;
+	}
+	return _raySpent + _rayCost <= RAY_BUDGET;
+}
+
+void Preselection::setHighlight(HPS::KeyPath const * path)
+{
+	HPS::HighlightOptionsKit const options = highlightOptions();
+	HPS::HighlightControl highlight = _canvas.GetWindowKey().GetHighlightControl();
+
+	highlight.Unhighlight(options);
+	if (path)
+	{
+		highlight.Highlight(*path, options);
+		_highlighted = *path;
+	}
+	_highlighting = (path != nullptr);
+
+	_canvas.Update();
+}
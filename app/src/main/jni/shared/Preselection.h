@@ -0,0 +1,83 @@
+#pragma once
+
+#include "hps.h"
+#include "sprk.h"
+
+#include <stdint.h>
+#include <vector>
+
+class SpatialIndex;
+
+// Preselection highlights the item under a moving finger, continuously and without holding
+//  up frames.
+//
+// The spatial index answers most picks on its own: no box on the ray means nothing is under
+//  the finger, a single box means that item.  Only when boxes overlap is SelectByRay needed
+//  to tell them apart, and its calls are limited to RAY_BUDGET ms per frame; past the budget
+//  the nearest box wins.  Answers are cached per small window cell for the gesture, so going
+//  back over an item costs nothing.
+//
+// The highlight uses its own named style drawn as an overlay, so changing it never touches
+//  the static model.  Called from the HPS event thread (see PreselectOperator).
+
+class Preselection
+{
+public:
+	static const char * const	STYLE_NAME;
+
+	// SelectByRay time allowed per FRAME_TIME, in ms
+	static const float			RAY_BUDGET;
+	static const float			FRAME_TIME;
+
+	// Cache cell size, in window units
+	static const float			CELL_SIZE;
+	static const size_t			CACHE_SIZE = 16;
+
+	Preselection(SpatialIndex const & index);
+	~Preselection();
+
+	// Defines the preselection style in the window's portfolios.  Does nothing when already attached.
+	void			attach(HPS::Canvas const & canvas);
+	void			detach();
+
+	// Highlights the item under 'location'.  Returns true if the highlight changed.
+	bool			hover(HPS::WindowPoint const & location);
+
+	// Removes the highlight and forgets the cached picks: the camera may move before the next hover
+	void			end();
+
+	HPS::HighlightOptionsKit	highlightOptions() const;
+
+private:
+	Preselection(Preselection const &);
+	void operator=(Preselection const &);
+
+	struct CacheEntry
+	{
+		int				cellX;
+		int				cellY;
+		uint64_t		lastUse;
+		bool			found;			// False if nothing is there
+		HPS::KeyPath	path;
+	};
+
+	// Returns false if there is no answer within the budget; 'found' tells if an item is there
+	bool			pick(HPS::WindowPoint const & location, bool & found, HPS::KeyPath & path);
+	bool			rayAllowed();
+	void			setHighlight(HPS::KeyPath const * path);
+
+	SpatialIndex const &		_index;
+	HPS::Canvas					_canvas;
+	HPS::PortfolioKey			_portfolio;
+	HPS::SegmentKey				_style;
+	bool						_highlighting;
+	HPS::KeyPath				_highlighted;
+
+	std::vector<CacheEntry>		_cache;
+	uint64_t					_useCount;
+
+	// SelectByRay time spent in the current frame, and a running average of one call, in ms
+	HPS::Time					_frameStart;
+	HPS::Time					_raySpent;
+	HPS::Time					_rayCost;
+};
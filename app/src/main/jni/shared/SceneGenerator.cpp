@@ -0,0 +1,184 @@
+#include "SceneGenerator.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <math.h>
+#include <random>
+#include <vector>
+
+#include "dprintf.h"
+
+namespace
+{
+	const float			SHELL_RADIUS = 1.0f;
+	const float			PI = 3.14159265358979f;
+
+	// Tessellation giving about 'triangles' triangles: 2 * rings * sectors, with sectors ~ 2 * rings
+	void shellResolution(size_t triangles, int & rings, int & sectors)
+	{
+		rings = std::max(2, (int)sqrt(triangles / 4.0));
+		sectors = std::max(3, (int)(triangles / (2 * (size_t)rings)));
+	}
+
+	// A closed sphere around 'center', its radius modulated by 'lumpiness' so shells do not all look alike
+	void buildShell(int rings, int sectors, HPS::Point const & center, float lumpiness, float phase,
+		HPS::PointArray & points, HPS::IntArray & faceList)
+	{
+		points.clear();
+		faceList.clear();
+		points.reserve((rings + 1) * (sectors + 1));
+		faceList.reserve(rings * sectors * 8);
+
+		for (int i = 0; i <= rings; ++i)
+		{
+			float const theta = PI * i / rings;
+			for (int j = 0; j <= sectors; ++j)
+			{
+				float const phi = 2.0f * PI * j / sectors;
+				float const r = SHELL_RADIUS * (1.0f + lumpiness * sinf(3.0f * theta + phase) * cosf(2.0f * phi));
+				points.push_back(HPS::Point(
+					center.x + r * sinf(theta) * cosf(phi),
+					center.y + r * sinf(theta) * sinf(phi),
+					center.z + r * cosf(theta)));
+			}
+		}
+
+		for (int i = 0; i < rings; ++i)
+		{
+			for (int j = 0; j < sectors; ++j)
+			{
+				int const a = i * (sectors + 1) + j;
+				int const b = a + sectors + 1;
+
+				faceList.push_back(3);
+				faceList.push_back(a);
+				faceList.push_back(b);
+				faceList.push_back(a + 1);
+
+				faceList.push_back(3);
+				faceList.push_back(a + 1);
+				faceList.push_back(b);
+				faceList.push_back(b + 1);
+			}
+		}
+	}
+}
+
+SceneGenerator::Options::Options()
+	: segmentCount(100), shellCount(1000), triangleCount(1000000), instanceRatio(0.0f),
+	  materialCount(8), dispersion(1.5f), seed(1)
+{
+}
+
+SceneGenerator::Statistics SceneGenerator::generate(HPS::Model model, Options const & options, std::atomic<bool> const * cancelled)
+{
+	TRACE_SCOPE("import", "SceneGenerator::generate");
+
+	Statistics			stats = {};
+	HPS::Time const		start = HPS::Database::GetTime();
+
+	std::mt19937		random(options.seed);
+	std::uniform_real_distribution<float>	unit(0.0f, 1.0f);
+
+	unsigned int const	segmentCount = std::max(1u, options.segmentCount);
+	unsigned int const	shellCount = std::max(1u, options.shellCount);
+	float const			instanceRatio = std::min(1.0f, std::max(0.0f, options.instanceRatio));
+	size_t const		instanceCount = (size_t)(shellCount * instanceRatio + 0.5f);
+
+	int					rings, sectors;
+	shellResolution(std::max<size_t>(2, options.triangleCount / shellCount), rings, sectors);
+	size_t const		trianglesPerShell = 2 * (size_t)rings * sectors;
+
+	HPS::PointArray		points;
+	HPS::IntArray		faceList;
+
+	// Prototypes, in the library so they are only drawn through includes
+	std::vector<HPS::SegmentKey>	prototypes;
+	if (instanceCount > 0)
+	{
+		HPS::SegmentKey library = model.GetLibraryKey();
+		size_t const prototypeCount = std::min<size_t>(instanceCount, MAX_PROTOTYPES);
+		for (size_t p = 0; p < prototypeCount; ++p)
+		{
+			HPS::SegmentKey prototype = library.Subsegment();
+			buildShell(rings, sectors, HPS::Point(0, 0, 0), 0.2f * unit(random), 2.0f * PI * unit(random), points, faceList);
+			prototype.InsertShell(points, faceList);
+			prototypes.push_back(prototype);
+		}
+		stats.uniqueShells += prototypeCount;
+		stats.storedTriangles += prototypeCount * trianglesPerShell;
+		stats.segments += prototypeCount;
+	}
+
+	// Assemblies and leaf segments
+	HPS::SegmentKey		root = model.GetSegmentKey();
+	unsigned int const	assemblyCount = (unsigned int)ceil(sqrt((double)segmentCount));
+	std::vector<HPS::SegmentKey>	assemblies;
+	std::vector<HPS::SegmentKey>	leaves;
+	assemblies.reserve(assemblyCount);
+	leaves.reserve(segmentCount);
+	for (unsigned int a = 0; a < assemblyCount; ++a)
+		assemblies.push_back(root.Subsegment());
+	for (unsigned int s = 0; s < segmentCount; ++s)
+		leaves.push_back(assemblies[s * assemblyCount / segmentCount].Subsegment());
+	stats.segments += assemblyCount + segmentCount;
+
+	// Attribute diversity: one face color per leaf, taken from a palette of materialCount colors
+	if (options.materialCount > 0)
+	{
+		std::vector<HPS::RGBAColor>	palette;
+		for (unsigned int m = 0; m < options.materialCount; ++m)
+			palette.push_back(HPS::RGBAColor(0.2f + 0.8f * unit(random), 0.2f + 0.8f * unit(random), 0.2f + 0.8f * unit(random)));
+		for (unsigned int s = 0; s < segmentCount; ++s)
+			leaves[s].GetMaterialMappingControl().SetFaceColor(palette[s % options.materialCount]);
+	}
+	else
+		root.GetMaterialMappingControl().SetFaceColor(HPS::RGBAColor(0.7f, 0.7f, 0.7f));
+
+	// Shells on a jittered grid, visited in order so consecutive shells are neighbours
+	unsigned int const	gridSize = std::max(1u, (unsigned int)ceil(cbrt((double)shellCount)));
+	float const			spacing = 2.0f * SHELL_RADIUS * std::max(0.0f, options.dispersion);
+	float const			gridOffset = 0.5f * (gridSize - 1);
+
+	for (unsigned int s = 0; s < shellCount; ++s)
+	{
+		if (cancelled != nullptr && cancelled->load(std::memory_order_relaxed))
+			break;
+
+		HPS::SegmentKey	leaf = leaves[(size_t)s * segmentCount / shellCount];
+
+		HPS::Point		center(
+			(s % gridSize - gridOffset + 0.5f * (unit(random) - 0.5f)) * spacing,
+			((s / gridSize) % gridSize - gridOffset + 0.5f * (unit(random) - 0.5f)) * spacing,
+			(s / (gridSize * gridSize) - gridOffset + 0.5f * (unit(random) - 0.5f)) * spacing);
+
+		// Spread the instances evenly over the shells
+		bool const		instanced = ((size_t)(s + 1) * instanceCount / shellCount) != ((size_t)s * instanceCount / shellCount);
+		if (instanced)
+		{
+			HPS::SegmentKey	instance = leaf.Subsegment();
+			instance.SetModellingMatrix(HPS::MatrixKit().Translate(center.x, center.y, center.z));
+			instance.IncludeSegment(prototypes[random() % prototypes.size()]);
+			++stats.instances;
+			++stats.segments;
+		}
+		else
+		{
+			buildShell(rings, sectors, center, 0.2f * unit(random), 2.0f * PI * unit(random), points, faceList);
+			leaf.InsertShell(points, faceList);
+			++stats.uniqueShells;
+			stats.storedTriangles += trianglesPerShell;
+		}
+
+		++stats.shells;
+		stats.triangles += trianglesPerShell;
+	}
+
+	stats.buildTime = HPS::Database::GetTime() - start;
+
+	dprintf("Generated %u triangles (%u stored) in %u shells (%u instances), %u segments, %.0f ms\n",
+		(unsigned)stats.triangles, (unsigned)stats.storedTriangles, (unsigned)stats.shells, (unsigned)stats.instances,
+		(unsigned)stats.segments, stats.buildTime);
+
+	return stats;
+}
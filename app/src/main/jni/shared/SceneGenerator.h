@@ -0,0 +1,54 @@
+#pragma once
+
+#include "hps.h"
+#include "sprk.h"
+
+#include <atomic>
+#include <stdint.h>
+
+// SceneGenerator builds synthetic models directly into an HPS::Model, so frame time,
+//  memory and selection latency can be charted while one dimension of the scene grows
+//  well past the bundled datasets (10M+ triangles).
+//
+// The scene is a two level assembly tree (sqrt(N) assemblies of leaf segments) holding
+//  closed, slightly lumpy spheres laid out on a jittered 3D grid.  Consecutive shells
+//  share a leaf segment and a grid neighbourhood, so segment bounds stay tight and
+//  culling behaves as on a real assembly.
+//
+// Instanced shells are subsegments with a translation which include one of a few
+//  prototype segments kept in the model library, the usual HPS instancing pattern.
+//  Generation is deterministic for a given seed.
+
+class SceneGenerator
+{
+public:
+	struct Options
+	{
+		Options();
+
+		unsigned int	segmentCount;	// Leaf segments
+		unsigned int	shellCount;		// Shells drawn, instances included
+		size_t			triangleCount;	// Triangles drawn, spread evenly over the shells
+		float			instanceRatio;	// 0..1, share of the shells which are instances of a prototype
+		unsigned int	materialCount;	// Distinct face colors over the leaf segments, 0 for a single inherited color
+		float			dispersion;		// Grid spacing in shell diameters: 0 piles everything up, 1 just touches, >1 spreads out
+		uint32_t		seed;
+	};
+
+	struct Statistics
+	{
+		size_t			triangles;		// Triangles drawn
+		size_t			storedTriangles;// Triangles held in the database (prototypes counted once)
+		size_t			shells;
+		size_t			uniqueShells;
+		size_t			instances;
+		size_t			segments;
+		HPS::Time		buildTime;		// ms
+	};
+
+	// Stops between two shells once 'cancelled' is set, leaving the model partly built
+	static Statistics	generate(HPS::Model model, Options const & options, std::atomic<bool> const * cancelled = nullptr);
+
+	// Number of prototypes shared by all the instanced shells
+	static const unsigned int	MAX_PROTOTYPES = 8;
+};
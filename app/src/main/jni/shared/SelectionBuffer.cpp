@@ -0,0 +1,83 @@
+#include "SelectionBuffer.h"
+#include "Trace.h"
+
+#include <string.h>
+#include <vector>
+
+int SelectionBuffer::write(HPS::SelectionResults const & results, void *memory, size_t size, ComponentResolver const & component)
+{
+	if (memory == nullptr || size < sizeof(SelectionBufferHeader))
+		return -1;
+
+	TRACE_SCOPE("selection", "SelectionBuffer::write");
+
+	SelectionBufferHeader * const header = static_cast<SelectionBufferHeader *>(memory);
+	SelectionRecord * const records = reinterpret_cast<SelectionRecord *>(header + 1);
+
+	// Indices are gathered apart, since where their area starts depends on the record count
+	std::vector<int32_t> indices;
+	size_t used = sizeof(SelectionBufferHeader);
+	int count = 0;
+
+	HPS::SizeTArray faces, vertices, edges1, edges2;
+	for (HPS::SelectionResultsIterator it = results.GetIterator(); it.IsValid(); it.Next())
+	{
+		HPS::SelectionItem const item = it.GetItem();
+
+		faces.clear();
+		vertices.clear();
+		edges1.clear();
+		edges2.clear();
+		item.ShowFaces(faces);
+		item.ShowVertices(vertices);
+		item.ShowEdges(edges1, edges2);
+
+		size_t const itemIndices = faces.size() + vertices.size() + 2 * edges1.size();
+		size_t const needed = sizeof(SelectionRecord) + itemIndices * sizeof(int32_t);
+		if (used + needed > size)
+			break;
+		used += needed;
+
+		SelectionRecord & record = records[count++];
+
+		HPS::Key key;
+		item.ShowSelectedItem(key);
+		record.key = (int64_t)key.GetInstanceID();
+		record.component = component ? component(item) : 0;
+
+		HPS::WorldPoint position;
+		if (!item.ShowSelectionPosition(position))
+			position = HPS::WorldPoint(0, 0, 0);
+		record.position[0] = position.x;
+		record.position[1] = position.y;
+		record.position[2] = position.z;
+
+		HPS::Selection::Level level = HPS::Selection::Level::Entity;
+		item.ShowSelectionLevel(level);
+		record.level = (int32_t)level;
+
+		record.indexOffset = (int32_t)indices.size();
+		record.faceCount = (int32_t)faces.size();
+		record.vertexCount = (int32_t)vertices.size();
+		record.edgeCount = (int32_t)edges1.size();
+
+		for (size_t face : faces)
+			indices.push_back((int32_t)face);
+		for (size_t vertex : vertices)
+			indices.push_back((int32_t)vertex);
+		for (size_t e = 0; e < edges1.size(); ++e)
+		{
+			indices.push_back((int32_t)edges1[e]);
+			indices.push_back((int32_t)(e < edges2.size() ? edges2[e] : edges1[e]));
+		}
+	}
+
+	if (!indices.empty())
+		memcpy(records + count, indices.data(), indices.size() * sizeof(int32_t));
+
+	header->count = count;
+	header->total = (int32_t)results.GetCount();
+	header->indexCount = (int32_t)indices.size();
+	header->reserved = 0;
+	return count;
+}
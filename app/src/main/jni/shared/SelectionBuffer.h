@@ -0,0 +1,58 @@
+#pragma once
+
+#include "hps.h"
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+
+// Selection results travel to the gui as a compact binary block, written into memory it
+//  provides (a direct ByteBuffer on Android), so thousands of hits cost no object per item.
+//
+// Layout, in native byte order:
+//   SelectionBufferHeader
+//   SelectionRecord[header.count]
+//   int32_t indices[header.indexCount]		sub-entity indices of all records
+//
+// Each record's indices start at indexOffset in the index area: faceCount face indices, then
+//  vertexCount vertex indices, then edgeCount pairs of vertex indices.  Only subentity level
+//  selections have any.
+//
+// Records are written while they fit; header.total tells how many results there were, so the
+//  gui can retry with a larger buffer.  The layout is mirrored by the SELECTION_* constants in
+//  AndroidMobileSurfaceView.java.
+
+struct SelectionBufferHeader
+{
+	int32_t			count;			// Records written
+	int32_t			total;			// Items in the selection results
+	int32_t			indexCount;
+	int32_t			reserved;
+};
+
+struct SelectionRecord
+{
+	int64_t			key;			// HPS::Key::GetInstanceID() of the selected item
+	int64_t			component;		// Identifies the owning component, 0 if unknown
+	float			position[3];	// Selection point, world space
+	int32_t			level;			// HPS::Selection::Level
+	int32_t			indexOffset;
+	int32_t			faceCount;
+	int32_t			vertexCount;
+	int32_t			edgeCount;
+};
+
+static_assert(sizeof(SelectionBufferHeader) == 16, "SelectionBufferHeader layout must match AndroidMobileSurfaceView.SELECTION_HEADER_BYTES");
+static_assert(sizeof(SelectionRecord) == 48, "SelectionRecord layout must match AndroidMobileSurfaceView.SELECTION_RECORD_BYTES");
+static_assert(offsetof(SelectionRecord, position) == 16 && offsetof(SelectionRecord, level) == 28 && offsetof(SelectionRecord, indexOffset) == 32,
+	"SelectionRecord layout must match AndroidMobileSurfaceView.SELECTION_* offsets");
+
+namespace SelectionBuffer
+{
+	// Returns the component id of a selected item
+	typedef std::function<int64_t(HPS::SelectionItem const &)>	ComponentResolver;
+
+	// Writes 'results' into 'memory'.  Returns the number of records written, or -1 if the
+	//  memory cannot hold the header.
+	int			write(HPS::SelectionResults const & results, void *memory, size_t size, ComponentResolver const & component = nullptr);
+}
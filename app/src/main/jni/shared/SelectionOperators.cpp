@@ -0,0 +1,457 @@
+#include "SelectionOperators.h"
+#include "Measurement.h"
+#include "Preselection.h"
+#include "SelectionService.h"
+
+#include <algorithm>
+#include <math.h>
+#include <vector>
+
+namespace
+{
+	// Lasso selections return at most this many items
+	const size_t		MAX_LASSO_ITEMS = 100000;
+}
+
+AsyncHighlightOperator::AsyncHighlightOperator(SelectionService & service)
+	: HPS::Operator(), _service(service)
+{
+}
+
+bool AsyncHighlightOperator::OnMouseDown(HPS::MouseState const & in_state)
+{
+	if (!IsMouseTriggered(in_state))
+		return false;
+
+	return _service.selectByPoint(in_state.GetLocation()) != 0;
+}
+
+bool AsyncHighlightOperator::OnTouchDown(HPS::TouchState const & in_state)
+{
+	// Only single finger taps select, so pinches and pans still reach the operators below
+	HPS::TouchArray const touches = in_state.GetTouches();
+	if (touches.size() != 1)
+		return false;
+
+	return _service.selectByPoint(touches[0].Location) != 0;
+}
+
+AsyncHighlightAreaOperator::AsyncHighlightAreaOperator(SelectionService & service)
+	: HPS::ConstructRectangleOperator(), _service(service)
+{
+}
+
+bool AsyncHighlightAreaOperator::OnMouseUp(HPS::MouseState const & in_state)
+{
+	// The base class removes the rubber band and sets the final rectangle
+	HPS::ConstructRectangleOperator::OnMouseUp(in_state);
+	return selectRectangle();
+}
+
+bool AsyncHighlightAreaOperator::OnTouchUp(HPS::TouchState const & in_state)
+{
+	HPS::ConstructRectangleOperator::OnTouchUp(in_state);
+	return selectRectangle();
+}
+
+bool AsyncHighlightAreaOperator::selectRectangle()
+{
+	if (!IsRectangleValid())
+		return false;
+
+	return _service.selectByArea(GetRectangle()) != 0;
+}
+
+const float LassoOperator::MIN_SPACING = 0.005f;
+const float LassoOperator::TOLERANCE = 0.01f;
+
+LassoOperator::LassoOperator(SelectionService & service)
+	: HPS::Operator(), _service(service), _active(false), _touchID(0)
+{
+}
+
+void LassoOperator::OnViewAttached()
+{
+	// Window space overlay: the default camera, stretched, maps [-1, 1] onto the window
+	_overlay = GetAttachedView().GetSegmentKey().Subsegment();
+	_overlay.SetCamera(HPS::CameraKit::GetDefault().SetProjection(HPS::Camera::Projection::Stretched));
+	_overlay.GetDrawingAttributeControl().SetOverlay(HPS::Drawing::Overlay::Default);
+	_overlay.GetVisibilityControl().SetLines(true);
+	_overlay.GetMaterialMappingControl().SetLineColor(HPS::RGBAColor(1.0f, 0.5f, 0.0f));
+	_overlay.GetSelectabilityControl().SetEverything(false);
+}
+
+void LassoOperator::OnViewDetached()
+{
+	if (_overlay.Type() != HPS::Type::None)
+		_overlay.Delete();
+	_active = false;
+}
+
+bool LassoOperator::OnMouseDown(HPS::MouseState const & in_state)
+{
+	if (!IsMouseTriggered(in_state))
+		return false;
+
+	begin(in_state.GetLocation());
+	return true;
+}
+
+bool LassoOperator::OnMouseMove(HPS::MouseState const & in_state)
+{
+	if (!_active)
+		return false;
+
+	extend(in_state.GetLocation());
+	return true;
+}
+
+bool LassoOperator::OnMouseUp(HPS::MouseState const & in_state)
+{
+	if (!_active)
+		return false;
+
+	extend(in_state.GetLocation());
+	return finish();
+}
+
+bool LassoOperator::OnTouchDown(HPS::TouchState const & in_state)
+{
+	HPS::TouchArray const touches = in_state.GetTouches();
+	if (touches.size() != 1)
+	{
+		// A second finger turns the gesture into a pinch: let it through
+		if (_active)
+		{
+			_active = false;
+			_outline.clear();
+			redraw();
+		}
+		return false;
+	}
+
+	_touchID = touches[0].ID;
+	begin(touches[0].Location);
+	return true;
+}
+
+bool LassoOperator::OnTouchMove(HPS::TouchState const & in_state)
+{
+	if (!_active)
+		return false;
+
+	for (auto const & touch : in_state.GetActiveEvent().Touches)
+	{
+		if (touch.ID == _touchID)
+			extend(touch.Location);
+	}
+	return true;
+}
+
+bool LassoOperator::OnTouchUp(HPS::TouchState const & in_state)
+{
+	if (!_active)
+		return false;
+
+	for (auto const & touch : in_state.GetActiveEvent().Touches)
+	{
+		if (touch.ID == _touchID)
+			extend(touch.Location);
+	}
+	return finish();
+}
+
+void LassoOperator::begin(HPS::WindowPoint const & location)
+{
+	_active = true;
+	_outline.clear();
+	_outline.push_back(HPS::Point(location.x, location.y, 0));
+}
+
+void LassoOperator::extend(HPS::WindowPoint const & location)
+{
+	HPS::Point const point(location.x, location.y, 0);
+	HPS::Point const & last = _outline.back();
+	if (fabs(point.x - last.x) < MIN_SPACING && fabs(point.y - last.y) < MIN_SPACING)
+		return;
+
+	_outline.push_back(point);
+	redraw();
+}
+
+bool LassoOperator::finish()
+{
+	_active = false;
+
+	HPS::PointArray const polygon = simplify(_outline, TOLERANCE, MAX_POINTS);
+	_outline.clear();
+	redraw();
+
+	if (polygon.size() < 3)
+		return false;
+
+	return _service.selectByPolygon(polygon, lassoOptions()) != 0;
+}
+
+void LassoOperator::redraw()
+{
+	if (_overlay.Type() == HPS::Type::None)
+		return;
+
+	if (_line.Type() != HPS::Type::None)
+		_line.Delete();
+
+	if (_outline.size() > 1)
+	{
+		// Closed, so the user sees the region which will be selected
+		HPS::PointArray closed(_outline);
+		closed.push_back(_outline.front());
+		_line = _overlay.InsertLine(closed);
+	}
+
+	GetAttachedView().Update();
+}
+
+HPS::SelectionOptionsKit LassoOperator::lassoOptions()
+{
+	HPS::SelectionOptionsKit options;
+	options.SetLevel(HPS::Selection::Level::Entity)
+		.SetAlgorithm(HPS::Selection::Algorithm::Analytic)
+		.SetGranularity(HPS::Selection::Granularity::General)
+		.SetInternalLimit(0)
+		.SetRelatedLimit(MAX_LASSO_ITEMS)
+		.SetSorting(false)
+		.SetFrustumCullingRespected(true)
+		.SetExtentCullingRespected(true)
+		.SetVectorCullingRespected(true);
+	return options;
+}
+
+HPS::PointArray LassoOperator::simplify(HPS::PointArray const & outline, float tolerance, size_t maxPoints)
+{
+	size_t const count = outline.size();
+	if (count <= 3)
+		return outline;
+
+	// The outline is closed: split it at the point farthest from the first one and simplify
+	//  both halves, so the result does not depend on where the finger went down
+	size_t split = 0;
+	float splitDistance = 0;
+	for (size_t i = 1; i < count; ++i)
+	{
+		HPS::Vector const d = outline[i] - outline[0];
+		float const distance = d.x * d.x + d.y * d.y;
+		if (distance > splitDistance)
+		{
+			split = i;
+			splitDistance = distance;
+		}
+	}
+	if (split == 0)
+		return HPS::PointArray(1, outline[0]);
+
+	std::vector<bool> keep(count, false);
+	keep[0] = keep[split] = true;
+
+	for (;;)
+	{
+		std::vector<std::pair<size_t, size_t>> spans;
+		spans.push_back(std::make_pair((size_t)0, split));
+		spans.push_back(std::make_pair(split, count));		// 'count' stands for point 0, closing the outline
+
+		while (!spans.empty())
+		{
+			size_t const first = spans.back().first;
+			size_t const last = spans.back().second;
+			spans.pop_back();
+
+			HPS::Point const & a = outline[first];
+			HPS::Point const & b = outline[last % count];
+			float const dx = b.x - a.x, dy = b.y - a.y;
+			float const length = sqrtf(dx * dx + dy * dy);
+
+			size_t worst = 0;
+			float worstDistance = tolerance;
+			for (size_t i = first + 1; i < last; ++i)
+			{
+				float const px = outline[i].x - a.x, py = outline[i].y - a.y;
+				float const distance = length > 0 ? fabsf(px * dy - py * dx) / length : sqrtf(px * px + py * py);
+				if (distance > worstDistance)
+				{
+					worst = i;
+					worstDistance = distance;
+				}
+			}
+
+			if (worst != 0)
+			{
+				keep[worst] = true;
+				spans.push_back(std::make_pair(first, worst));
+				spans.push_back(std::make_pair(worst, last));
+			}
+		}
+
+		HPS::PointArray result;
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (keep[i])
+				result.push_back(outline[i]);
+		}
+
+		if (result.size() <= maxPoints)
+			return result;
+
+		// Too detailed: retry coarser
+		tolerance *= 2.0f;
+		std::fill(keep.begin(), keep.end(), false);
+		keep[0] = keep[split] = true;
+	}
+}
+
+PreselectOperator::PreselectOperator(Preselection & preselection)
+	: HPS::Operator(), _preselection(preselection), _active(false), _touchID(0)
+{
+}
+
+void PreselectOperator::OnViewDetached()
+{
+	_preselection.end();
+	_active = false;
+}
+
+bool PreselectOperator::OnMouseMove(HPS::MouseState const & in_state)
+{
+	_preselection.hover(in_state.GetLocation());
+	return false;
+}
+
+bool PreselectOperator::OnMouseLeave(HPS::MouseState const &)
+{
+	_preselection.end();
+	return false;
+}
+
+bool PreselectOperator::OnTouchDown(HPS::TouchState const & in_state)
+{
+	HPS::TouchArray const touches = in_state.GetTouches();
+	if (touches.size() != 1)
+	{
+		// Pinch or pan: stop inspecting and let the camera operators have the gesture
+		if (_active)
+		{
+			_active = false;
+			_preselection.end();
+		}
+		return false;
+	}
+
+	_active = true;
+	_touchID = touches[0].ID;
+	_preselection.hover(touches[0].Location);
+	return true;
+}
+
+bool PreselectOperator::OnTouchMove(HPS::TouchState const & in_state)
+{
+	if (!_active)
+		return false;
+
+	for (auto const & touch : in_state.GetActiveEvent().Touches)
+	{
+		if (touch.ID == _touchID)
+			_preselection.hover(touch.Location);
+	}
+	return true;
+}
+
+bool PreselectOperator::OnTouchUp(HPS::TouchState const &)
+{
+	if (!_active)
+		return false;
+
+	_active = false;
+	_preselection.end();
+	return true;
+}
+
+MeasureOperator::MeasureOperator(Measurement & measurement)
+	: HPS::Operator(), _measurement(measurement), _active(false), _touchID(0)
+{
+}
+
+void MeasureOperator::OnViewDetached()
+{
+	_measurement.endHover();
+	_active = false;
+}
+
+bool MeasureOperator::OnMouseDown(HPS::MouseState const & in_state)
+{
+	if (!IsMouseTriggered(in_state))
+		return false;
+
+	float value;
+	_measurement.pick(in_state.GetLocation(), value);
+	return true;
+}
+
+bool MeasureOperator::OnMouseMove(HPS::MouseState const & in_state)
+{
+	_measurement.hover(in_state.GetLocation());
+	return false;
+}
+
+bool MeasureOperator::OnMouseLeave(HPS::MouseState const &)
+{
+	_measurement.endHover();
+	return false;
+}
+
+bool MeasureOperator::OnTouchDown(HPS::TouchState const & in_state)
+{
+	HPS::TouchArray const touches = in_state.GetTouches();
+	if (touches.size() != 1)
+	{
+		// Pinch or pan: drop the pick in progress and let the camera operators have the gesture
+		if (_active)
+		{
+			_active = false;
+			_measurement.endHover();
+		}
+		return false;
+	}
+
+	_active = true;
+	_touchID = touches[0].ID;
+	_location = touches[0].Location;
+	_measurement.hover(_location);
+	return true;
+}
+
+bool MeasureOperator::OnTouchMove(HPS::TouchState const & in_state)
+{
+	if (!_active)
+		return false;
+
+	for (auto const & touch : in_state.GetActiveEvent().Touches)
+	{
+		if (touch.ID == _touchID)
+		{
+			_location = touch.Location;
+			_measurement.hover(_location);
+		}
+	}
+	return true;
+}
+
+bool MeasureOperator::OnTouchUp(HPS::TouchState const &)
+{
+	if (!_active)
+		return false;
+
+	_active = false;
+	float value;
+	if (!_measurement.pick(_location, value))
+		_measurement.endHover();
+	return true;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "sprk.h"
+#include "sprk_ops.h"
+
+class Measurement;
+class Preselection;
+class SelectionService;
+
+// Counterparts of HPS::HighlightOperator and HPS::HighlightAreaOperator which hand the
+//  selection to a SelectionService instead of selecting and highlighting inside the event
+//  handler, and a lasso operator selecting inside a freehand outline.  The service must
+//  outlive the operator.
+
+class AsyncHighlightOperator : public HPS::Operator
+{
+public:
+	AsyncHighlightOperator(SelectionService & service);
+
+	virtual HPS::UTF8		GetName() const	{ return "AsyncHighlightOperator"; }
+
+	virtual bool			OnMouseDown(HPS::MouseState const & in_state);
+	virtual bool			OnTouchDown(HPS::TouchState const & in_state);
+
+private:
+	SelectionService &		_service;
+};
+
+class AsyncHighlightAreaOperator : public HPS::ConstructRectangleOperator
+{
+public:
+	AsyncHighlightAreaOperator(SelectionService & service);
+
+	virtual HPS::UTF8		GetName() const	{ return "AsyncHighlightAreaOperator"; }
+
+	virtual bool			OnMouseUp(HPS::MouseState const & in_state);
+	virtual bool			OnTouchUp(HPS::TouchState const & in_state);
+
+private:
+	bool					selectRectangle();
+
+	SelectionService &		_service;
+};
+
+// Selects what lies inside the outline drawn with one finger.  The touch path is drawn as it
+//  grows, then simplified to at most MAX_POINTS vertices and sent to SelectByPolygon with
+//  options meant for large selections (see lassoOptions()).
+class LassoOperator : public HPS::Operator
+{
+public:
+	// Path points closer than this to the previous one are dropped, in window units
+	static const float		MIN_SPACING;
+
+	// Largest distance between the drawn outline and the simplified polygon, in window units
+	static const float		TOLERANCE;
+
+	static const size_t		MAX_POINTS = 64;
+
+	LassoOperator(SelectionService & service);
+
+	virtual HPS::UTF8		GetName() const	{ return "LassoOperator"; }
+
+	virtual void			OnViewAttached();
+	virtual void			OnViewDetached();
+
+	virtual bool			OnMouseDown(HPS::MouseState const & in_state);
+	virtual bool			OnMouseMove(HPS::MouseState const & in_state);
+	virtual bool			OnMouseUp(HPS::MouseState const & in_state);
+
+	virtual bool			OnTouchDown(HPS::TouchState const & in_state);
+	virtual bool			OnTouchMove(HPS::TouchState const & in_state);
+	virtual bool			OnTouchUp(HPS::TouchState const & in_state);
+
+	// Entity level, analytic, unsorted and without subentities: the polygon is meant to catch
+	//  whole parts, possibly thousands of them, rather than the closest one
+	static HPS::SelectionOptionsKit	lassoOptions();
+
+	// Douglas-Peucker simplification of a closed outline, to at most maxPoints points
+	static HPS::PointArray	simplify(HPS::PointArray const & outline, float tolerance, size_t maxPoints);
+
+private:
+	void					begin(HPS::WindowPoint const & location);
+	void					extend(HPS::WindowPoint const & location);
+	bool					finish();
+	void					redraw();
+
+	SelectionService &		_service;
+	HPS::SegmentKey			_overlay;
+	HPS::LineKey			_line;
+	HPS::PointArray			_outline;
+	bool					_active;
+	HPS::TouchID			_touchID;
+};
+
+// Highlights the item under a dragging finger (or the mouse) through Preselection, leaving
+//  other gestures to the operators below.
+class PreselectOperator : public HPS::Operator
+{
+public:
+	PreselectOperator(Preselection & preselection);
+
+	virtual HPS::UTF8		GetName() const	{ return "PreselectOperator"; }
+
+	virtual void			OnViewDetached();
+
+	virtual bool			OnMouseMove(HPS::MouseState const & in_state);
+	virtual bool			OnMouseLeave(HPS::MouseState const & in_state);
+
+	virtual bool			OnTouchDown(HPS::TouchState const & in_state);
+	virtual bool			OnTouchMove(HPS::TouchState const & in_state);
+	virtual bool			OnTouchUp(HPS::TouchState const & in_state);
+
+private:
+	Preselection &			_preselection;
+	bool					_active;
+	HPS::TouchID			_touchID;
+};
+
+// Measures with Measurement: a dragging finger shows the snap under it and lifting it picks
+//  there, so the snap can be adjusted before it is taken.  With the mouse, moving shows the
+//  snap and a click picks.  Other gestures go to the operators below.
+class MeasureOperator : public HPS::Operator
+{
+public:
+	MeasureOperator(Measurement & measurement);
+
+	virtual HPS::UTF8		GetName() const	{ return "MeasureOperator"; }
+
+	virtual void			OnViewDetached();
+
+	virtual bool			OnMouseDown(HPS::MouseState const & in_state);
+	virtual bool			OnMouseMove(HPS::MouseState const & in_state);
+	virtual bool			OnMouseLeave(HPS::MouseState const & in_state);
+
+	virtual bool			OnTouchDown(HPS::TouchState const & in_state);
+	virtual bool			OnTouchMove(HPS::TouchState const & in_state);
+	virtual bool			OnTouchUp(HPS::TouchState const & in_state);
+
+private:
+	Measurement &			_measurement;
+	bool					_active;
+	HPS::TouchID			_touchID;
+	HPS::WindowPoint		_location;
+};
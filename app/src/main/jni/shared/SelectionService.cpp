@@ -0,0 +1,318 @@
+#include "SelectionService.h"
+#include "LatencyMonitor.h"
+#include "MobileApp.h"
+#include "SpatialIndex.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <float.h>
+#include <string.h>
+
+// Implemented by the gui
+void ShowSelectionResult(SurfaceHandle surface, int requestId, int count, float latency);
+
+namespace
+{
+	const char * const	KIND_NAMES[] = {"selectByPoint", "selectByArea", "selectByPolygon"};
+
+	// Boxes along a tap's ray tested one by one before falling back to the whole window
+	const size_t		MAX_POINT_CANDIDATES = 8;
+}
+
+SelectionService::SelectionService()
+	: _surface(0), _index(nullptr), _selectionOptions(HPS::SelectionOptionsKit::GetDefault()), _highlightOptions(HPS::HighlightOptionsKit::GetDefault()),
+	  _latest(0), _latencyCount(0)
+{
+}
+
+SelectionService::~SelectionService()
+{
+	detach();
+}
+
+void SelectionService::attach(HPS::WindowKey const & window, SurfaceHandle surface)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_window = window;
+	_surface = surface;
+}
+
+void SelectionService::detach()
+{
+	std::vector<TaskScheduler::TaskRef> tasks;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		++_latest;
+		_window = HPS::WindowKey();
+		_index = nullptr;
+		_canvas = HPS::Canvas();
+		_activeSelection = HPS::SelectionResults();
+		tasks.swap(_tasks);
+	}
+
+	// Running tasks lock _mutex when they end, so wait without holding it
+	if (!tasks.empty())
+	{
+		TaskScheduler & scheduler = MobileApp::inst().scheduler();
+		for (auto const & task : tasks)
+		{
+			scheduler.cancel(task);
+			scheduler.wait(task);
+		}
+	}
+}
+
+void SelectionService::setIndex(SpatialIndex const * index, HPS::Canvas const & canvas)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_index = index;
+	_canvas = canvas;
+}
+
+void SelectionService::setSelectionOptions(HPS::SelectionOptionsKit const & options)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_selectionOptions = options;
+}
+
+void SelectionService::setHighlightOptions(HPS::HighlightOptionsKit const & options)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_highlightOptions = options;
+}
+
+unsigned int SelectionService::selectByPoint(HPS::WindowPoint const & location)
+{
+	return submit(Point, [this, location](HPS::SelectionControl const & control, HPS::SelectionOptionsKit const & options, HPS::SelectionResults & results) {
+		size_t count;
+		if (selectCandidates(control, location, options, results, count))
+			return count;
+		return control.SelectByPoint(location, options, results);
+	});
+}
+
+unsigned int SelectionService::selectByArea(HPS::Rectangle const & area)
+{
+	return submit(Area, [area](HPS::SelectionControl const & control, HPS::SelectionOptionsKit const & options, HPS::SelectionResults & results) {
+		return control.SelectByArea(area, options, results);
+	});
+}
+
+unsigned int SelectionService::selectByPolygon(HPS::PointArray const & points)
+{
+	return submit(Polygon, [points](HPS::SelectionControl const & control, HPS::SelectionOptionsKit const & options, HPS::SelectionResults & results) {
+		return control.SelectByPolygon(points, options, results);
+	});
+}
+
+unsigned int SelectionService::selectByPolygon(HPS::PointArray const & points, HPS::SelectionOptionsKit const & options)
+{
+	return submit(Polygon, [points](HPS::SelectionControl const & control, HPS::SelectionOptionsKit const & options, HPS::SelectionResults & results) {
+		return control.SelectByPolygon(points, options, results);
+	}, std::make_shared<HPS::SelectionOptionsKit>(options));
+}
+
+unsigned int SelectionService::submit(Kind kind, Query query, std::shared_ptr<HPS::SelectionOptionsKit> options)
+{
+	TaskScheduler & scheduler = MobileApp::inst().scheduler();
+	int64_t const requestTime = Trace::Now();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_window.Type() == HPS::Type::None)
+		return 0;
+
+	// Latest wins: whatever has not started yet is not worth starting
+	for (auto const & task : _tasks)
+		scheduler.cancel(task);
+	_tasks.erase(std::remove_if(_tasks.begin(), _tasks.end(), [](TaskScheduler::TaskRef const & task) { return task->isDone(); }), _tasks.end());
+
+	unsigned int id = ++_latest;
+	if (id == 0)
+		id = ++_latest;
+
+	_tasks.push_back(scheduler.submit(TaskScheduler::Interactive, [this, id, kind, query, options, requestTime] {
+		run(id, kind, query, options.get(), requestTime);
+	}));
+	return id;
+}
+
+void SelectionService::run(unsigned int id, Kind kind, Query const & query, HPS::SelectionOptionsKit const * options, int64_t requestTime)
+{
+	if (_latest.load() != id)
+		return;
+
+	HPS::WindowKey				window;
+	HPS::SelectionOptionsKit	defaultOptions;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		window = _window;
+		if (options == nullptr)
+			defaultOptions = _selectionOptions;
+	}
+	if (window.Type() == HPS::Type::None)
+		return;
+
+	HPS::SelectionResults results;
+	size_t count;
+	{
+		TRACE_SCOPE("selection", KIND_NAMES[kind]);
+		count = query(window.GetSelectionControl(), options ? *options : defaultOptions, results);
+	}
+
+	float latency;
+	SurfaceHandle surface;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		// A newer request came in while this one ran
+		if (_latest.load() != id || _window.Type() == HPS::Type::None)
+		{
+			TRACE_INSTANT("selection", "stale");
+			return;
+		}
+
+		TRACE_SCOPE("selection", "highlight");
+		HPS::HighlightControl highlight = _window.GetHighlightControl();
+		highlight.Unhighlight(_highlightOptions);
+		if (count > 0)
+			highlight.Highlight(results, _highlightOptions);
+		_window.Update();
+
+		_activeSelection = results;
+		surface = _surface;
+
+		latency = (Trace::Now() - requestTime) / 1000.0f;
+		recordLatency(latency);
+	}
+
+	TRACE_COUNTER("selectionLatencyUs", (int64_t)(latency * 1000));
+	ShowSelectionResult(surface, (int)id, (int)count, latency);
+}
+
+bool SelectionService::selectCandidates(HPS::SelectionControl const & control, HPS::WindowPoint const & location,
+	HPS::SelectionOptionsKit const & options, HPS::SelectionResults & results, size_t & count) const
+{
+	SpatialIndex const * index;
+	HPS::Canvas canvas;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		index = _index;
+		canvas = _canvas;
+	}
+	if (index == nullptr || canvas.Type() == HPS::Type::None || !index->isReady())
+		return false;
+
+	HPS::Point origin;
+	HPS::Vector direction;
+	if (!SpatialIndex::pickRay(canvas, location, origin, direction))
+		return false;
+
+	std::vector<SpatialIndex::Hit> candidates;
+	if (index->raycast(origin, direction, MAX_POINT_CANDIDATES, candidates) == 0)
+		return false;
+
+	TRACE_SCOPE("selection", "selectCandidates");
+	HPS::KeyPath const view = SpatialIndex::viewPath(canvas);
+	float const length = (float)direction.Length();
+	std::vector<HPS::KeyPath> tested;
+	float best = FLT_MAX;
+	for (auto const & candidate : candidates)
+	{
+		// Hits are in world units, box distances in ray lengths
+		if (candidate.distance * length > best)
+			break;
+
+		// Shells of a segment are tested together
+		HPS::KeyPath scope;
+		scope.Append(candidate.item.shell.Owner()).Append(candidate.item.includes).Append(view);
+		if (std::find(tested.begin(), tested.end(), scope) != tested.end())
+			continue;
+		tested.push_back(scope);
+
+		HPS::SelectionOptionsKit scoped(options);
+		scoped.SetScope(scope).SetSorting(true);
+
+		HPS::SelectionResults candidateResults;
+		size_t const candidateCount = control.SelectByPoint(location, scoped, candidateResults);
+		HPS::SelectionResultsIterator it = candidateResults.GetIterator();
+		HPS::WorldPoint position;
+		if (candidateCount == 0 || !it.IsValid() || !it.GetItem().ShowSelectionPosition(position))
+			continue;
+
+		float const distance = (float)(position - origin).Length();
+		if (distance < best)
+		{
+			best = distance;
+			results = candidateResults;
+			count = candidateCount;
+		}
+	}
+
+	// A box left untested may still hold a nearer hit
+	if (best == FLT_MAX)
+		return false;
+	return candidates.size() < MAX_POINT_CANDIDATES || candidates.back().distance * length > best;
+}
+
+void SelectionService::clear()
+{
+	TaskScheduler & scheduler = MobileApp::inst().scheduler();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	++_latest;
+	for (auto const & task : _tasks)
+		scheduler.cancel(task);
+
+	_activeSelection = HPS::SelectionResults();
+	if (_window.Type() != HPS::Type::None)
+	{
+		_window.GetHighlightControl().Unhighlight(_highlightOptions);
+		_window.Update();
+	}
+}
+
+HPS::SelectionResults SelectionService::activeSelection() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _activeSelection;
+}
+
+void SelectionService::recordLatency(float latency)
+{
+	_latencies[_latencyCount % LATENCY_SAMPLES] = latency;
+	++_latencyCount;
+}
+
+int SelectionService::showLatency(float stats[]) const
+{
+	std::vector<float> samples;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		samples.assign(_latencies, _latencies + std::min<unsigned int>(_latencyCount, LATENCY_SAMPLES));
+	}
+
+	memset(stats, 0, LatencyMonitor::StatCount * sizeof(float));
+	if (samples.empty())
+		return 0;
+
+	std::sort(samples.begin(), samples.end());
+
+	double sum = 0;
+	for (float sample : samples)
+		sum += sample;
+
+	size_t const last = samples.size() - 1;
+	stats[LatencyMonitor::SampleCount] = (float)samples.size();
+	stats[LatencyMonitor::Mean] = (float)(sum / samples.size());
+	stats[LatencyMonitor::Median] = samples[last / 2];
+	stats[LatencyMonitor::Percentile90] = samples[last * 9 / 10];
+	stats[LatencyMonitor::Percentile99] = samples[last * 99 / 100];
+	stats[LatencyMonitor::Max] = samples[last];
+	return (int)samples.size();
+}
+
+void SelectionService::resetLatency()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_latencyCount = 0;
+}
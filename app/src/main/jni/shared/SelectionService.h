@@ -0,0 +1,108 @@
+#pragma once
+
+#include "sprk.h"
+#include "SurfaceRegistry.h"
+#include "TaskScheduler.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+class SpatialIndex;
+
+// SelectionService runs point, area and polygon selections off the UI thread.
+//
+// A request returns at once with its id; the selection runs on the MobileApp task scheduler
+//  (Interactive lane) against the window's SelectionControl.  Requests are latest-wins:
+//  a request still queued when a newer one arrives is cancelled, and one already running
+//  completes but its results are dropped.  The results of the newest request replace the
+//  window's highlights and are reported to the gui through ShowSelectionResult().
+//
+// With a spatial index set, a point selection tests only the shells whose boxes the tap's ray
+//  crosses, nearest first, each through a selection scoped to it, and stops once the boxes
+//  left start beyond the nearest hit.  The whole window is searched when the index has no
+//  answer: it is not ready, the ray crosses no box, or no candidate is hit.
+//
+// Locations are in window space ([-1, 1] on both axes), as operators receive them.
+//  Latency is measured from the request to the highlight being applied.
+
+class SelectionService
+{
+public:
+	enum Kind
+	{
+		Point,
+		Area,
+		Polygon
+	};
+
+	// Number of latencies kept for showLatency()
+	static const int	LATENCY_SAMPLES = 256;
+
+	SelectionService();
+	~SelectionService();
+
+	// Window selected in and highlighted, and the surface whose view receives the results.
+	//  detach() waits for a running selection to end.
+	void			attach(HPS::WindowKey const & window, SurfaceHandle surface);
+	void			detach();
+
+	// Index whose candidates limit point selections, in the canvas' front view, nullptr for none.
+	//  A running selection may still use the previous one; detach() waits for it.
+	void			setIndex(SpatialIndex const * index, HPS::Canvas const & canvas);
+
+	void			setSelectionOptions(HPS::SelectionOptionsKit const & options);
+	void			setHighlightOptions(HPS::HighlightOptionsKit const & options);
+
+	// Each returns the request id, 0 if no window is attached
+	unsigned int	selectByPoint(HPS::WindowPoint const & location);
+	unsigned int	selectByArea(HPS::Rectangle const & area);
+	unsigned int	selectByPolygon(HPS::PointArray const & points);
+
+	// Same, with options for this request only in place of setSelectionOptions()
+	unsigned int	selectByPolygon(HPS::PointArray const & points, HPS::SelectionOptionsKit const & options);
+
+	// Cancels pending requests and removes the highlights
+	void			clear();
+
+	// Results of the newest completed request
+	HPS::SelectionResults	activeSelection() const;
+
+	// Fills 'stats' (LatencyMonitor::StatCount values, milliseconds) over the last LATENCY_SAMPLES
+	//  selections.  Returns the sample count.
+	int				showLatency(float stats[]) const;
+	void			resetLatency();
+
+private:
+	SelectionService(SelectionService const &);
+	void operator=(SelectionService const &);
+
+	typedef std::function<size_t(HPS::SelectionControl const &, HPS::SelectionOptionsKit const &, HPS::SelectionResults &)>	Query;
+
+	unsigned int	submit(Kind kind, Query query, std::shared_ptr<HPS::SelectionOptionsKit> options = nullptr);
+	void			run(unsigned int id, Kind kind, Query const & query, HPS::SelectionOptionsKit const * options, int64_t requestTime);
+	void			recordLatency(float latency);
+
+	// Point selection over the index' candidates.  Returns false when the whole window is to be searched.
+	bool			selectCandidates(HPS::SelectionControl const & control, HPS::WindowPoint const & location,
+						HPS::SelectionOptionsKit const & options, HPS::SelectionResults & results, size_t & count) const;
+
+	mutable std::mutex			_mutex;
+	HPS::WindowKey				_window;
+	SurfaceHandle				_surface;
+	SpatialIndex const *		_index;
+	HPS::Canvas					_canvas;
+	HPS::SelectionOptionsKit	_selectionOptions;
+	HPS::HighlightOptionsKit	_highlightOptions;
+	HPS::SelectionResults		_activeSelection;
+	std::vector<TaskScheduler::TaskRef>	_tasks;
+
+	// Id of the newest request: older ones are stale
+	std::atomic<unsigned int>	_latest;
+
+	float						_latencies[LATENCY_SAMPLES];
+	unsigned int				_latencyCount;
+};
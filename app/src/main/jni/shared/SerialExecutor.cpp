@@ -0,0 +1,98 @@
+#include "SerialExecutor.h"
+#include "Trace.h"
+
+#include <future>
+#include <stdexcept>
+
+#include "dprintf.h"
+
+SerialExecutor::SerialExecutor(const char *name)
+	: _name(name), _stopping(false)
+{
+}
+
+SerialExecutor::~SerialExecutor()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_wake.notify_one();
+
+	if (_thread.joinable())
+		_thread.join();
+}
+
+void SerialExecutor::post(Task task)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_tasks.push_back(std::move(task));
+		if (!_thread.joinable())
+			_thread = std::thread(&SerialExecutor::run, this);
+	}
+	_wake.notify_one();
+}
+
+void SerialExecutor::call(Task task)
+{
+	bool onWorker;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		onWorker = _thread.get_id() == std::this_thread::get_id();
+	}
+
+	// Waiting for itself would never return
+	if (onWorker)
+	{
+		task();
+		return;
+	}
+
+	// The caller gets the task's exception, as if it had run the task itself
+	std::promise<void> done;
+	post([&task, &done] {
+		try
+		{
+			task();
+			done.set_value();
+		}
+		catch (...)
+		{
+			done.set_exception(std::current_exception());
+		}
+	});
+	done.get_future().get();
+}
+
+void SerialExecutor::run()
+{
+	TRACE_THREAD_NAME(_name);
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (;;)
+	{
+		_wake.wait(lock, [this] { return _stopping || !_tasks.empty(); });
+		if (_tasks.empty())
+			return;
+
+		Task task = std::move(_tasks.front());
+		_tasks.pop_front();
+
+		// An exception ends the task, not the thread and the tasks queued after it
+		lock.unlock();
+		try
+		{
+			task();
+		}
+		catch (std::exception const & e)
+		{
+			eprintf("%s task failed: %s\n", _name, e.what());
+		}
+		catch (...)
+		{
+			eprintf("%s task failed\n", _name);
+		}
+		lock.lock();
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// SerialExecutor runs posted tasks one at a time, in order, on a worker thread of its own.
+//  It lets the gui hand long actions (file loads, scene generation, ...) to native code
+//  without blocking its thread, while actions still never run concurrently with each other.
+//
+// The thread is started by the first post() and joined by the destructor once every
+//  queued task has run.
+//
+// call() is the synchronous form the gui's sync actions go through, so that they never
+//  change HPS state on the gui thread while an asynchronous action runs.  It waits for the
+//  tasks queued before it.
+
+class SerialExecutor
+{
+public:
+	typedef std::function<void()>	Task;
+
+	// 'name' must be a string literal; it names the thread in traces
+	explicit SerialExecutor(const char *name);
+	~SerialExecutor();
+
+	void		post(Task task);
+
+	// Runs 'task' on the worker thread and returns once it has run, rethrowing what it threw.
+	//  Called from the worker thread itself, runs it at once.
+	void		call(Task task);
+
+private:
+	SerialExecutor(SerialExecutor const &);		// Non-copyable
+	void operator=(SerialExecutor const &);
+
+	void		run();
+
+	const char *				_name;
+	std::mutex					_mutex;
+	std::condition_variable		_wake;
+	std::deque<Task>			_tasks;
+	bool						_stopping;
+	std::thread					_thread;
+};
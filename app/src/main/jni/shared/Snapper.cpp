@@ -0,0 +1,336 @@
+#include "Snapper.h"
+#include "BVH.h"
+#include "KDTree.h"
+#include "Trace.h"
+
+#include <float.h>
+#include <math.h>
+#include <unordered_set>
+
+const float Snapper::SNAP_RADIUS = 0.04f;
+
+namespace
+{
+	// How far behind the nearest face a vertex may be and still show, in snap radii at that
+	//  face: vertices of a face seen at an angle lie a little in front of or behind the point hit
+	const float			DEPTH_TOLERANCE = 2.0f;
+
+	// Distance along the ray to triangle abc, in units of 'direction', or FLT_MAX if it misses
+	float intersect(HPS::Point const & origin, HPS::Vector const & direction, HPS::Point const & a, HPS::Point const & b, HPS::Point const & c)
+	{
+		HPS::Vector const ab = b - a;
+		HPS::Vector const ac = c - a;
+		HPS::Vector const p = direction.Cross(ac);
+		float const determinant = ab.Dot(p);
+		if (fabsf(determinant) < FLT_MIN)
+			return FLT_MAX;
+
+		float const inverse = 1.0f / determinant;
+		HPS::Vector const s = origin - a;
+		float const u = s.Dot(p) * inverse;
+		if (u < 0.0f || u > 1.0f)
+			return FLT_MAX;
+
+		HPS::Vector const q = s.Cross(ab);
+		float const v = direction.Dot(q) * inverse;
+		if (v < 0.0f || u + v > 1.0f)
+			return FLT_MAX;
+
+		float const t = ac.Dot(q) * inverse;
+		return t >= 0.0f ? t : FLT_MAX;
+	}
+
+	// World lengths to object lengths, for a matrix without shear
+	float objectScale(HPS::MatrixKit const & inverse)
+	{
+		return (float)(inverse.Transform(HPS::Vector(1, 0, 0)).Length() +
+			inverse.Transform(HPS::Vector(0, 1, 0)).Length() +
+			inverse.Transform(HPS::Vector(0, 0, 1)).Length()) / 3.0f;
+	}
+
+	const size_t		NO_HIT = (size_t)-1;
+
+	// Best candidate of one shell, in its object space
+	struct Candidate
+	{
+		size_t						hit;			// In the hits visited, NO_HIT for none
+		float						t;
+		float						score;
+		uint32_t					index;			// Snap point, or triangle for faces
+	};
+}
+
+struct Snapper::Geometry
+{
+	HPS::PointArray				points;
+	std::vector<uint32_t>		edges;			// Two points per edge
+	std::vector<uint32_t>		triangles;		// Three points per triangle
+	KDTree						snapPoints;		// Vertices, then edge midpoints
+	BVH							triangleBoxes;
+
+	Geometry(HPS::ShellKey const & shell)
+	{
+		TRACE_SCOPE("measure", "Snapper::Geometry");
+
+		HPS::IntArray faceList;
+		shell.ShowPoints(points);
+		shell.ShowFacelist(faceList);
+
+		// Edges once each, triangles fanned from the first point of each face.  Holes (negative
+		//  counts) add their edges but no triangles.
+		std::unordered_set<uint64_t> seen;
+		uint32_t const pointCount = (uint32_t)points.size();
+		for (size_t f = 0; f < faceList.size(); )
+		{
+			int const count = abs(faceList[f]);
+			bool const hole = faceList[f] < 0;
+			if (f + 1 + count > faceList.size())
+				break;
+			int const * face = faceList.data() + f + 1;
+			f += count + 1;
+
+			bool valid = true;
+			for (int i = 0; i < count; ++i)
+				valid = valid && (uint32_t)face[i] < pointCount;
+			if (!valid)
+				continue;
+
+			for (int i = 0; i < count; ++i)
+			{
+				uint32_t const a = face[i];
+				uint32_t const b = face[(i + 1) % count];
+				if (a == b)
+					continue;
+				uint64_t const key = ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+				if (seen.insert(key).second)
+				{
+					edges.push_back(a);
+					edges.push_back(b);
+				}
+			}
+
+			if (hole)
+				continue;
+			for (int i = 2; i < count; ++i)
+			{
+				triangles.push_back(face[0]);
+				triangles.push_back(face[i - 1]);
+				triangles.push_back(face[i]);
+			}
+		}
+
+		std::vector<float> coordinates;
+		coordinates.reserve(3 * (points.size() + edges.size() / 2));
+		for (auto const & point : points)
+		{
+			coordinates.push_back(point.x);
+			coordinates.push_back(point.y);
+			coordinates.push_back(point.z);
+		}
+		for (size_t e = 0; e < edges.size(); e += 2)
+		{
+			HPS::Point const & a = points[edges[e]];
+			HPS::Point const & b = points[edges[e + 1]];
+			coordinates.push_back(0.5f * (a.x + b.x));
+			coordinates.push_back(0.5f * (a.y + b.y));
+			coordinates.push_back(0.5f * (a.z + b.z));
+		}
+		snapPoints.build(coordinates);
+
+		std::vector<BVH::Box> boxes;
+		boxes.reserve(triangles.size() / 3);
+		for (size_t t = 0; t < triangles.size(); t += 3)
+		{
+			BVH::Box box = BVH::Box::empty();
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				HPS::Point const & p = points[triangles[t + corner]];
+				float const q[3] = {p.x, p.y, p.z};
+				box.expand(q);
+			}
+			boxes.push_back(box);
+		}
+		triangleBoxes.build(boxes);
+	}
+
+	// Nearest triangle along the ray
+	bool raycast(HPS::Point const & origin, HPS::Vector const & direction, uint32_t & triangle, float & t) const
+	{
+		float const o[3] = {origin.x, origin.y, origin.z};
+		float const d[3] = {direction.x, direction.y, direction.z};
+
+		// A triangle lies in its box, so none in a box entered beyond the nearest hit can be nearer
+		t = FLT_MAX;
+		triangleBoxes.raycast(o, d, [&](uint32_t item, float) {
+			uint32_t const * corners = &triangles[3 * item];
+			float const distance = intersect(origin, direction, points[corners[0]], points[corners[1]], points[corners[2]]);
+			if (distance < t)
+			{
+				t = distance;
+				triangle = item;
+			}
+			return t;
+		});
+		return t < FLT_MAX;
+	}
+};
+
+Snapper::Snapper(SpatialIndex const & index)
+	: _index(index), _useCount(0)
+{
+}
+
+Snapper::~Snapper()
+{
+}
+
+bool Snapper::snap(HPS::Canvas const & canvas, HPS::WindowPoint const & location, Snap & snap)
+{
+	TRACE_SCOPE("measure", "Snapper::snap");
+	snap = Snap();
+
+	// The pick ray, and the one SNAP_RADIUS aside: their gap is the tolerance along the ray
+	HPS::Point origin, sideOrigin;
+	HPS::Vector direction, sideDirection;
+	if (!SpatialIndex::pickRay(canvas, location, origin, direction) ||
+		!SpatialIndex::pickRay(canvas, HPS::WindowPoint(location.x + SNAP_RADIUS, location.y, location.z), sideOrigin, sideDirection))
+		return false;
+
+	float const radius = (float)(sideOrigin - origin).Length();
+	float const spread = (float)(sideDirection - direction).Length();
+	float const length = (float)direction.Length();
+
+	std::vector<SpatialIndex::Hit> hits;
+	std::vector<std::shared_ptr<Geometry const>> geometries;
+	Candidate face = {NO_HIT, FLT_MAX, 0, 0};
+	std::vector<Candidate> points;
+
+	// Nothing in a box entered beyond this can show in front of the nearest face
+	auto depthLimit = [&]() {
+		return face.hit != NO_HIT ? face.t + DEPTH_TOLERANCE * (radius + spread * face.t) / length : FLT_MAX;
+	};
+
+	_index.raycast(origin, direction, [&](SpatialIndex::Hit const & hit) {
+		HPS::MatrixKit inverse;
+		if (!hit.matrix.ShowInverse(inverse))
+			return depthLimit();
+
+		size_t const h = hits.size();
+		hits.push_back(hit);
+		geometries.push_back(geometry(hit.item.shell));
+		Geometry const & shell = *geometries[h];
+
+		// t is the same in object space, the tolerance scales with the matrix
+		HPS::Point const objectOrigin = inverse.Transform(origin);
+		HPS::Vector const objectDirection = inverse.Transform(direction);
+		float const scale = objectScale(inverse);
+
+		uint32_t triangle;
+		float t;
+		if (shell.raycast(objectOrigin, objectDirection, triangle, t) && t < face.t)
+			face = Candidate{h, t, 0, triangle};
+
+		KDTree::Cone const cone = {
+			{objectOrigin.x, objectOrigin.y, objectOrigin.z},
+			{objectDirection.x, objectDirection.y, objectDirection.z},
+			radius * scale, spread * scale};
+		Candidate point = {h, 0, 0, 0};
+		if (shell.snapPoints.nearest(cone, FLT_MAX, point.index, point.t, point.score))
+			points.push_back(point);
+		return depthLimit();
+	});
+
+	Candidate const * best = nullptr;
+	float const maxT = depthLimit();
+	for (auto const & point : points)
+	{
+		if (point.t <= maxT && (best == nullptr || point.score < best->score))
+			best = &point;
+	}
+
+	if (best != nullptr)
+	{
+		SpatialIndex::Hit const & hit = hits[best->hit];
+		Geometry const & shell = *geometries[best->hit];
+
+		snap.item = hit.item;
+		if (best->index < shell.points.size())
+		{
+			snap.kind = Snap::Vertex;
+			snap.position = hit.matrix.Transform(shell.points[best->index]);
+		}
+		else
+		{
+			size_t const e = 2 * (best->index - shell.points.size());
+			snap.kind = Snap::EdgeMidpoint;
+			snap.edge[0] = hit.matrix.Transform(shell.points[shell.edges[e]]);
+			snap.edge[1] = hit.matrix.Transform(shell.points[shell.edges[e + 1]]);
+			snap.position = HPS::Midpoint(snap.edge[0], snap.edge[1]);
+		}
+		return true;
+	}
+
+	if (face.hit != NO_HIT)
+	{
+		SpatialIndex::Hit const & hit = hits[face.hit];
+		Geometry const & shell = *geometries[face.hit];
+		uint32_t const * corners = &shell.triangles[3 * face.index];
+
+		// Through world space corners, so the normal follows any matrix
+		HPS::Point const a = hit.matrix.Transform(shell.points[corners[0]]);
+		HPS::Point const b = hit.matrix.Transform(shell.points[corners[1]]);
+		HPS::Point const c = hit.matrix.Transform(shell.points[corners[2]]);
+
+		snap.kind = Snap::Face;
+		snap.item = hit.item;
+		snap.position = origin + direction * face.t;
+		snap.normal = (b - a).Cross(c - a).Normalize();
+		return true;
+	}
+
+	return false;
+}
+
+void Snapper::clear()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_cache.clear();
+}
+
+size_t Snapper::cachedShells() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _cache.size();
+}
+
+std::shared_ptr<Snapper::Geometry const> Snapper::geometry(HPS::ShellKey const & shell)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto found = _cache.find(shell);
+		if (found != _cache.end())
+		{
+			found->second.lastUse = ++_useCount;
+			return found->second.geometry;
+		}
+	}
+
+	std::shared_ptr<Geometry const> geometry(new Geometry(shell));
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_cache.size() >= MAX_CACHED_SHELLS)
+	{
+		auto oldest = _cache.begin();
+		for (auto it = _cache.begin(); it != _cache.end(); ++it)
+		{
+			if (it->second.lastUse < oldest->second.lastUse)
+				oldest = it;
+		}
+		_cache.erase(oldest);
+	}
+
+	CacheEntry & entry = _cache[shell];
+	entry.geometry = geometry;
+	entry.lastUse = ++_useCount;
+	return geometry;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "hps.h"
+#include "sprk.h"
+#include "SpatialIndex.h"
+
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <unordered_map>
+
+// Snapper finds the vertex, edge or face under the finger, for measurements.
+//
+// The spatial index gives the shells whose boxes the pick ray crosses.  For each of them a
+//  KDTree over its vertices and edge midpoints, and a BVH over its triangles, are built the
+//  first time the finger comes over it and kept for later moves (up to MAX_CACHED_SHELLS, the
+//  least recently used going first), so a snap then costs a few tree queries and no HPS
+//  selection.  Shells reached through includes share their trees.
+//
+// The nearest face along the ray hides what lies behind it: a vertex or edge midpoint within
+//  SNAP_RADIUS of the finger wins, unless it is farther than that face; otherwise the face
+//  point is the snap.  Shells are tried in the order the ray enters their boxes, however many
+//  there are, until the next box starts behind the nearest face found; triangles within a
+//  shell likewise.
+
+class Snapper
+{
+public:
+	// Distance from the finger within which vertices and edge midpoints snap, in window units
+	static const float		SNAP_RADIUS;
+
+	static const size_t		MAX_CACHED_SHELLS = 256;
+
+	struct Snap
+	{
+		enum Kind
+		{
+			None,
+			Vertex,
+			EdgeMidpoint,
+			Face
+		};
+
+		Kind				kind;
+		SpatialIndex::Item	item;
+		HPS::Point			position;		// World space
+		HPS::Point			edge[2];		// EdgeMidpoint: the edge's ends
+		HPS::Vector			normal;			// Face: unit normal
+
+		Snap() : kind(None) {}
+	};
+
+	Snapper(SpatialIndex const & index);
+	~Snapper();
+
+	// Snap at a window location of the canvas' front view.  Returns false if there is nothing
+	//  there, or the spatial index is not ready.
+	bool			snap(HPS::Canvas const & canvas, HPS::WindowPoint const & location, Snap & snap);
+
+	// Forgets the trees, for a new model
+	void			clear();
+
+	size_t			cachedShells() const;
+
+private:
+	Snapper(Snapper const &);
+	void operator=(Snapper const &);
+
+	struct Geometry;
+
+	struct CacheEntry
+	{
+		std::shared_ptr<Geometry const>	geometry;
+		uint64_t						lastUse;
+	};
+
+	std::shared_ptr<Geometry const>	geometry(HPS::ShellKey const & shell);
+
+	SpatialIndex const &		_index;
+
+	mutable std::mutex			_mutex;
+	std::unordered_map<HPS::Key, CacheEntry, HPS::KeyHasher>	_cache;
+	uint64_t					_useCount;
+};
@@ -0,0 +1,728 @@
+#include "SpatialIndex.h"
+#include "MobileApp.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "dprintf.h"
+
+namespace
+{
+	BVH::Box localBounds(HPS::ShellKey const & shell)
+	{
+		HPS::PointArray points;
+		shell.ShowPoints(points);
+
+		BVH::Box box = BVH::Box::empty();
+		for (auto const & point : points)
+		{
+			float const p[3] = {point.x, point.y, point.z};
+			box.expand(p);
+		}
+		return box;
+	}
+
+	BVH::Box worldBounds(BVH::Box const & local, HPS::MatrixKit const & matrix)
+	{
+		BVH::Box box = BVH::Box::empty();
+		if (local.isEmpty())
+			return box;
+
+		for (int corner = 0; corner < 8; ++corner)
+		{
+			HPS::Point const p = matrix.Transform(HPS::Point(
+				(corner & 1) ? local.max[0] : local.min[0],
+				(corner & 2) ? local.max[1] : local.min[1],
+				(corner & 4) ? local.max[2] : local.min[2]));
+			float const q[3] = {p.x, p.y, p.z};
+			box.expand(q);
+		}
+		return box;
+	}
+
+	// Keys from an item up to 'root', through its includes, as they appear in a selection's key path
+	HPS::KeyArray modelPath(SpatialIndex::Item const & item, HPS::SegmentKey const & root)
+	{
+		HPS::KeyArray keys(1, item.shell);
+		size_t include = 0;
+		for (HPS::SegmentKey segment = item.shell.Owner(); segment.Type() != HPS::Type::None; )
+		{
+			keys.push_back(segment);
+			if (segment == root)
+				break;
+
+			if (include < item.includes.size() && segment == HPS::IncludeKey(item.includes[include]).GetTarget())
+			{
+				keys.push_back(item.includes[include]);
+				segment = item.includes[include].Owner();
+				++include;
+			}
+			else
+				segment = segment.Owner();
+		}
+		return keys;
+	}
+
+	const uint32_t	NO_NODE = 0xffffffffu;
+
+	// Segment to visit, with the transform and include path leading to it
+	struct Visit
+	{
+		HPS::SegmentKey		segment;
+		HPS::MatrixKit		matrix;
+		HPS::KeyArray		includes;
+		uint32_t			parent;
+
+		Visit() : parent(NO_NODE) {}
+	};
+}
+
+struct SpatialIndex::Snapshot
+{
+	// A segment once per include path leading to it.  Parents come before their children.
+	struct Node
+	{
+		HPS::SegmentKey				segment;
+		HPS::KeyArray				includes;
+		uint32_t					parent;			// Owner segment or includer, NO_NODE for the root
+		uint32_t					itemCount;		// Items in its subtree
+		HPS::MatrixKit				matrix;			// Object to world
+	};
+
+	HPS::SegmentKey					root;
+	BVH								bvh;
+	std::vector<Item>				items;
+	std::vector<HPS::MatrixKit>		matrices;		// Object to world, per item
+	std::vector<BVH::Box>			bounds;			// Object space, per item
+	std::vector<uint32_t>			itemNodes;		// Node holding each item
+	std::vector<Node>				nodes;
+};
+
+size_t SpatialIndex::ItemHasher::operator()(Item const & item) const
+{
+	HPS::KeyHasher const hasher;
+	size_t hash = hasher(item.shell);
+	for (auto const & include : item.includes)
+		hash = hash * 31 + hasher(include);
+	return hash;
+}
+
+SpatialIndex::SpatialIndex()
+	: _generation(0)
+{
+}
+
+SpatialIndex::~SpatialIndex()
+{
+	clear();
+}
+
+void SpatialIndex::rebuild(HPS::Model const & model)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	start(model.GetSegmentKey());
+}
+
+// Called with _mutex held
+void SpatialIndex::start(HPS::SegmentKey const & root)
+{
+	TaskScheduler & scheduler = MobileApp::inst().scheduler();
+	if (_build)
+		scheduler.cancel(_build);
+	_root = root;
+
+	unsigned int const generation = ++_generation;
+	_build = scheduler.submit(TaskScheduler::Load, [this, root, generation] {
+		std::shared_ptr<Snapshot> snapshot = build(root, _generation, generation);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (snapshot && _generation.load() == generation)
+			_snapshot = snapshot;
+	});
+}
+
+void SpatialIndex::refit(HPS::Key const & changed)
+{
+	TRACE_SCOPE("index", "SpatialIndex::refit");
+
+	std::shared_ptr<Snapshot> current;
+	unsigned int generation;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		// A build under way may already have read the old geometry: start it over instead
+		if (_build && !_build->isDone())
+		{
+			start(_root);
+			return;
+		}
+		if (!_snapshot)
+			return;
+		current = _snapshot;
+		generation = ++_generation;
+	}
+
+	// Queries may still hold the current snapshot, so the refitted one is a copy
+	std::shared_ptr<Snapshot> snapshot(new Snapshot(*current));
+	std::vector<Snapshot::Node> & nodes = snapshot->nodes;
+
+	// Nodes at or under the changed segment, parents first, take the new matrices
+	std::vector<bool> moved(nodes.size(), false);
+	for (size_t n = 0; n < nodes.size(); ++n)
+	{
+		uint32_t const parent = nodes[n].parent;
+		moved[n] = nodes[n].segment == changed || (parent != NO_NODE && moved[parent]);
+		if (!moved[n])
+			continue;
+
+		nodes[n].matrix = parent != NO_NODE ? nodes[parent].matrix : HPS::MatrixKit();
+		HPS::MatrixKit local;
+		if (nodes[n].segment.ShowModellingMatrix(local))
+			nodes[n].matrix = local.Multiply(nodes[n].matrix);
+	}
+
+	std::vector<BVH::Box> boxes;
+	boxes.reserve(snapshot->items.size());
+	bool remeasured = false;
+	BVH::Box changedBounds;
+	for (size_t i = 0; i < snapshot->items.size(); ++i)
+	{
+		uint32_t const node = snapshot->itemNodes[i];
+		bool const reshaped = snapshot->items[i].shell == changed;
+		if (reshaped)
+		{
+			if (!remeasured)
+			{
+				changedBounds = localBounds(snapshot->items[i].shell);
+				remeasured = true;
+			}
+			snapshot->bounds[i] = changedBounds;
+		}
+		if (moved[node])
+			snapshot->matrices[i] = nodes[node].matrix;
+		if (reshaped || moved[node])
+			boxes.push_back(worldBounds(snapshot->bounds[i], snapshot->matrices[i]));
+		else
+			boxes.push_back(snapshot->bvh.bounds((uint32_t)i));
+	}
+	snapshot->bvh.refit(boxes);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_generation.load() == generation)
+		_snapshot = snapshot;
+}
+
+void SpatialIndex::clear()
+{
+	TaskScheduler::TaskRef build;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		++_generation;
+		_snapshot.reset();
+		build.swap(_build);
+	}
+
+	// The task locks _mutex when it ends, so wait without holding it
+	if (build)
+	{
+		TaskScheduler & scheduler = MobileApp::inst().scheduler();
+		scheduler.cancel(build);
+		scheduler.wait(build);
+	}
+}
+
+bool SpatialIndex::isReady() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _snapshot != nullptr;
+}
+
+size_t SpatialIndex::itemCount() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _snapshot ? _snapshot->items.size() : 0;
+}
+
+std::shared_ptr<SpatialIndex::Snapshot> SpatialIndex::build(HPS::SegmentKey root, std::atomic<unsigned int> const & generation, unsigned int expected)
+{
+	TRACE_SCOPE("index", "SpatialIndex::build");
+	HPS::Time const start = HPS::Database::GetTime();
+
+	std::shared_ptr<Snapshot> snapshot(new Snapshot());
+	snapshot->root = root;
+	std::vector<BVH::Box> boxes;
+
+	// Shared shells (library prototypes) are measured once, whatever their number of instances
+	std::unordered_map<HPS::Key, BVH::Box, HPS::KeyHasher> shellBounds;
+
+	std::vector<Visit> pending(1);
+	pending[0].segment = root;
+
+	HPS::SearchResults results;
+	while (!pending.empty())
+	{
+		if (generation.load() != expected)
+			return nullptr;
+
+		Visit visit = std::move(pending.back());
+		pending.pop_back();
+
+		HPS::MatrixKit local;
+		if (visit.segment.ShowModellingMatrix(local))
+			visit.matrix = local.Multiply(visit.matrix);
+
+		uint32_t const node = (uint32_t)snapshot->nodes.size();
+		Snapshot::Node visited;
+		visited.segment = visit.segment;
+		visited.includes = visit.includes;
+		visited.parent = visit.parent;
+		visited.itemCount = 0;
+		visited.matrix = visit.matrix;
+		snapshot->nodes.push_back(std::move(visited));
+
+		if (visit.segment.Find(HPS::Search::Type::Shell, HPS::Search::Space::SegmentOnly, results) > 0)
+		{
+			for (HPS::SearchResultsIterator it = results.GetIterator(); it.IsValid(); it.Next())
+			{
+				HPS::ShellKey shell(it.GetItem());
+
+				auto cached = shellBounds.find(shell);
+				if (cached == shellBounds.end())
+					cached = shellBounds.insert(std::make_pair(shell, localBounds(shell))).first;
+
+				Item item;
+				item.shell = shell;
+				item.includes = visit.includes;
+
+				snapshot->items.push_back(item);
+				snapshot->matrices.push_back(visit.matrix);
+				snapshot->bounds.push_back(cached->second);
+				snapshot->itemNodes.push_back(node);
+				boxes.push_back(worldBounds(cached->second, visit.matrix));
+			}
+		}
+
+		HPS::SegmentKeyArray children;
+		visit.segment.ShowSubsegments(children);
+		for (auto const & child : children)
+		{
+			Visit next;
+			next.segment = child;
+			next.matrix = visit.matrix;
+			next.includes = visit.includes;
+			next.parent = node;
+			pending.push_back(std::move(next));
+		}
+
+		if (visit.segment.Find(HPS::Search::Type::Include, HPS::Search::Space::SegmentOnly, results) > 0)
+		{
+			for (HPS::SearchResultsIterator it = results.GetIterator(); it.IsValid(); it.Next())
+			{
+				HPS::IncludeKey include(it.GetItem());
+
+				Visit next;
+				next.segment = include.GetTarget();
+				next.matrix = visit.matrix;
+				next.includes.reserve(visit.includes.size() + 1);
+				next.includes.push_back(include);
+				next.includes.insert(next.includes.end(), visit.includes.begin(), visit.includes.end());
+				next.parent = node;
+				pending.push_back(std::move(next));
+			}
+		}
+	}
+
+	for (uint32_t node : snapshot->itemNodes)
+		++snapshot->nodes[node].itemCount;
+	for (size_t n = snapshot->nodes.size(); n-- > 1; )
+		snapshot->nodes[snapshot->nodes[n].parent].itemCount += snapshot->nodes[n].itemCount;
+
+	{
+		TRACE_SCOPE("index", "BVH::build");
+		snapshot->bvh.build(boxes);
+	}
+
+	dprintf("Spatial index: %u shell instances, %u nodes, %.0f ms\n", (unsigned)snapshot->items.size(),
+		(unsigned)snapshot->bvh.nodeCount(), (HPS::Database::GetTime() - start));
+	return snapshot;
+}
+
+size_t SpatialIndex::raycast(HPS::Point const & origin, HPS::Vector const & direction, size_t maxHits, std::vector<Hit> & hits) const
+{
+	TRACE_SCOPE("index", "SpatialIndex::raycast");
+	hits.clear();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_snapshot)
+		return 0;
+
+	float const o[3] = {origin.x, origin.y, origin.z};
+	float const d[3] = {direction.x, direction.y, direction.z};
+	std::vector<BVH::Hit> boxHits;
+	_snapshot->bvh.raycast(o, d, maxHits, boxHits);
+
+	hits.reserve(boxHits.size());
+	for (auto const & boxHit : boxHits)
+	{
+		Hit hit;
+		hit.item = _snapshot->items[boxHit.item];
+		hit.distance = boxHit.distance;
+		hit.matrix = _snapshot->matrices[boxHit.item];
+		hits.push_back(hit);
+	}
+	return hits.size();
+}
+
+size_t SpatialIndex::raycast(HPS::Point const & origin, HPS::Vector const & direction, HitVisitor const & visit) const
+{
+	TRACE_SCOPE("index", "SpatialIndex::raycast");
+
+	// Snapshots do not change once made, so the visit runs unlocked
+	std::shared_ptr<Snapshot> snapshot;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		snapshot = _snapshot;
+	}
+	if (!snapshot)
+		return 0;
+
+	float const o[3] = {origin.x, origin.y, origin.z};
+	float const d[3] = {direction.x, direction.y, direction.z};
+	size_t visited = 0;
+	snapshot->bvh.raycast(o, d, [&](uint32_t item, float distance) {
+		Hit hit;
+		hit.item = snapshot->items[item];
+		hit.distance = distance;
+		hit.matrix = snapshot->matrices[item];
+		++visited;
+		return visit(hit);
+	});
+	return visited;
+}
+
+size_t SpatialIndex::overlap(HPS::Point const & min, HPS::Point const & max, std::vector<Item> & items) const
+{
+	TRACE_SCOPE("index", "SpatialIndex::overlap");
+	items.clear();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_snapshot)
+		return 0;
+
+	BVH::Box const box = {{min.x, min.y, min.z}, {max.x, max.y, max.z}};
+	std::vector<uint32_t> indices;
+	_snapshot->bvh.overlap(box, indices);
+
+	items.reserve(indices.size());
+	for (uint32_t index : indices)
+		items.push_back(_snapshot->items[index]);
+	return items.size();
+}
+
+size_t SpatialIndex::volume(std::vector<float> const & planes, std::vector<Item> & inside, std::vector<Item> & crossing) const
+{
+	TRACE_SCOPE("index", "SpatialIndex::volume");
+	inside.clear();
+	crossing.clear();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_snapshot)
+		return 0;
+
+	std::vector<uint32_t> insideIndices, crossingIndices;
+	_snapshot->bvh.volume(planes, insideIndices, crossingIndices);
+
+	inside.reserve(insideIndices.size());
+	for (uint32_t index : insideIndices)
+		inside.push_back(_snapshot->items[index]);
+	crossing.reserve(crossingIndices.size());
+	for (uint32_t index : crossingIndices)
+		crossing.push_back(_snapshot->items[index]);
+	return inside.size() + crossing.size();
+}
+
+bool SpatialIndex::nearest(HPS::Point const & point, float maxDistance, Item & item, float & distance) const
+{
+	TRACE_SCOPE("index", "SpatialIndex::nearest");
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_snapshot)
+		return false;
+
+	float const p[3] = {point.x, point.y, point.z};
+	uint32_t index;
+	if (!_snapshot->bvh.nearest(p, maxDistance, index, distance))
+		return false;
+
+	item = _snapshot->items[index];
+	return true;
+}
+
+size_t SpatialIndex::instances(Filter const & filter, std::vector<Instance> & instances) const
+{
+	TRACE_SCOPE("index", "SpatialIndex::instances");
+	instances.clear();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_snapshot)
+		return 0;
+
+	for (size_t i = 0; i < _snapshot->items.size(); ++i)
+	{
+		if (filter(_snapshot->items[i]))
+		{
+			Instance instance;
+			instance.item = _snapshot->items[i];
+			instance.matrix = _snapshot->matrices[i];
+			instances.push_back(instance);
+		}
+	}
+	return instances.size();
+}
+
+size_t SpatialIndex::coveringPaths(Filter const & filter, HPS::Canvas canvas, std::vector<HPS::KeyPath> & paths) const
+{
+	TRACE_SCOPE("index", "SpatialIndex::coveringPaths");
+	paths.clear();
+
+	// Paths are made after unlocking: segments, as (segment, includes), and single items
+	std::vector<std::pair<HPS::SegmentKey, HPS::KeyArray>> segments;
+	std::vector<Item> items;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!_snapshot)
+			return 0;
+
+		std::vector<Snapshot::Node> const & nodes = _snapshot->nodes;
+		std::vector<bool> accepted(_snapshot->items.size());
+		std::vector<uint32_t> acceptedCounts(nodes.size(), 0);
+		for (size_t i = 0; i < _snapshot->items.size(); ++i)
+		{
+			accepted[i] = filter(_snapshot->items[i]);
+			if (accepted[i])
+				++acceptedCounts[_snapshot->itemNodes[i]];
+		}
+		for (size_t n = nodes.size(); n-- > 1; )
+			acceptedCounts[nodes[n].parent] += acceptedCounts[n];
+
+		auto covered = [&](uint32_t n) {
+			return nodes[n].itemCount > 0 && acceptedCounts[n] == nodes[n].itemCount;
+		};
+
+		// The topmost covered nodes, and the accepted items outside them
+		for (uint32_t n = 0; n < (uint32_t)nodes.size(); ++n)
+		{
+			if (covered(n) && (nodes[n].parent == NO_NODE || !covered(nodes[n].parent)))
+				segments.push_back(std::make_pair(nodes[n].segment, nodes[n].includes));
+		}
+		for (size_t i = 0; i < _snapshot->items.size(); ++i)
+		{
+			if (accepted[i] && !covered(_snapshot->itemNodes[i]))
+				items.push_back(_snapshot->items[i]);
+		}
+	}
+
+	HPS::KeyPath const view = viewPath(canvas);
+	paths.reserve(segments.size() + items.size());
+	for (auto const & segment : segments)
+	{
+		HPS::KeyPath path;
+		path.Append(segment.first).Append(segment.second).Append(view);
+		paths.push_back(path);
+	}
+	for (auto const & item : items)
+	{
+		HPS::KeyPath path;
+		path.Append(item.shell).Append(item.includes).Append(view);
+		paths.push_back(path);
+	}
+	return paths.size();
+}
+
+size_t SpatialIndex::instancesUnder(HPS::KeyPath const & path, std::vector<Instance> & instances) const
+{
+	HPS::SegmentKey root;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_snapshot)
+			root = _snapshot->root;
+	}
+
+	// The part of the path inside the model
+	HPS::KeyArray selected;
+	path.ShowKeys(selected);
+	auto end = std::find(selected.begin(), selected.end(), root);
+	if (end != selected.end())
+		selected.erase(end + 1, selected.end());
+	if (selected.empty())
+	{
+		instances.clear();
+		return 0;
+	}
+
+	// An item is under the selection when the selection's path ends its own
+	return this->instances([&selected, &root](Item const & item) {
+		HPS::KeyArray const keys = modelPath(item, root);
+		return keys.size() >= selected.size() && std::equal(selected.begin(), selected.end(), keys.end() - selected.size());
+	}, instances);
+}
+
+size_t SpatialIndex::overlappingPairs(Filter const & first, Filter const & second, float margin, std::vector<Pair> & pairs) const
+{
+	TRACE_SCOPE("index", "SpatialIndex::overlappingPairs");
+	pairs.clear();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_snapshot)
+		return 0;
+
+	std::vector<Item> const & items = _snapshot->items;
+	std::vector<bool> inFirst(items.size()), inSecond(items.size());
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		inFirst[i] = first(items[i]);
+		inSecond[i] = second(items[i]);
+	}
+
+	std::vector<uint32_t> candidates;
+	for (uint32_t i = 0; i < (uint32_t)items.size(); ++i)
+	{
+		if (!inFirst[i])
+			continue;
+
+		BVH::Box box = _snapshot->bvh.bounds(i);
+		if (box.isEmpty())
+			continue;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			box.min[axis] -= margin;
+			box.max[axis] += margin;
+		}
+
+		_snapshot->bvh.overlap(box, candidates);
+		for (uint32_t j : candidates)
+		{
+			// (j, i) is found from j when it matches both ways
+			if (j == i || !inSecond[j] || (j < i && inFirst[j] && inSecond[i]))
+				continue;
+
+			Pair pair;
+			pair.first.item = items[i];
+			pair.first.matrix = _snapshot->matrices[i];
+			pair.second.item = items[j];
+			pair.second.matrix = _snapshot->matrices[j];
+			pairs.push_back(pair);
+		}
+	}
+	return pairs.size();
+}
+
+bool SpatialIndex::pickRay(HPS::Canvas canvas, HPS::WindowPoint const & location, HPS::Point & origin, HPS::Vector & direction)
+{
+	HPS::View view = canvas.GetFrontView();
+	HPS::Layout layout = canvas.GetAttachedLayout();
+	HPS::SegmentKey viewSegment = view.GetSegmentKey();
+
+	HPS::KeyPath path;
+	path.Append(viewSegment);
+	path.Append(layout.GetAttachedViewIncludeLink(0)).Append(layout.GetSegmentKey());
+	path.Append(canvas.GetAttachedLayoutIncludeLink()).Append(canvas.GetWindowKey());
+
+	HPS::Point onScreen;
+	if (!path.ConvertCoordinate(HPS::Coordinate::Space::Window, location, HPS::Coordinate::Space::World, onScreen))
+		return false;
+
+	HPS::CameraKit camera;
+	HPS::Point position, target;
+	HPS::Camera::Projection projection;
+	if (!viewSegment.ShowCamera(camera) || !camera.ShowPosition(position) || !camera.ShowTarget(target) || !camera.ShowProjection(projection))
+		return false;
+
+	if (projection == HPS::Camera::Projection::Perspective)
+	{
+		origin = position;
+		direction = onScreen - position;
+	}
+	else
+	{
+		// Parallel rays, starting level with the camera
+		direction = target - position;
+		origin = onScreen - direction;
+	}
+	return true;
+}
+
+void SpatialIndex::boxPlanes(HPS::Point const & min, HPS::Point const & max, std::vector<float> & planes)
+{
+	float const coefficients[] = {
+		1, 0, 0, -min.x,	-1, 0, 0, max.x,
+		0, 1, 0, -min.y,	0, -1, 0, max.y,
+		0, 0, 1, -min.z,	0, 0, -1, max.z};
+	planes.assign(coefficients, coefficients + 24);
+}
+
+bool SpatialIndex::frustumPlanes(HPS::Canvas canvas, HPS::WindowPoint const & min, HPS::WindowPoint const & max, std::vector<float> & planes)
+{
+	planes.clear();
+
+	// Rays through the corners, counterclockwise, and through the center
+	HPS::WindowPoint const corners[4] = {
+		HPS::WindowPoint(min.x, min.y, 0), HPS::WindowPoint(max.x, min.y, 0),
+		HPS::WindowPoint(max.x, max.y, 0), HPS::WindowPoint(min.x, max.y, 0)};
+	HPS::Point origins[4], centerOrigin;
+	HPS::Vector directions[4], centerDirection;
+	for (int i = 0; i < 4; ++i)
+	{
+		if (!pickRay(canvas, corners[i], origins[i], directions[i]))
+			return false;
+	}
+	if (!pickRay(canvas, HPS::Midpoint(min, max), centerOrigin, centerDirection))
+		return false;
+
+	HPS::Point const center = centerOrigin + centerDirection;
+	auto addPlane = [&planes, &center](HPS::Vector normal, HPS::Point const & point) {
+		float const length = (float)normal.Length();
+		if (length <= 0.0f)
+			return;
+		normal = normal / length;
+		float d = -(float)normal.Dot(HPS::Vector(point));
+		if (normal.Dot(HPS::Vector(center)) + d < 0.0f)
+		{
+			normal = -normal;
+			d = -d;
+		}
+		float const plane[] = {normal.x, normal.y, normal.z, d};
+		planes.insert(planes.end(), plane, plane + 4);
+	};
+
+	// Each side holds the ray through one corner and the end of the next one
+	for (int i = 0; i < 4; ++i)
+	{
+		int const next = (i + 1) % 4;
+		addPlane(directions[i].Cross((origins[next] + directions[next]) - origins[i]), origins[i]);
+	}
+	addPlane(centerDirection, centerOrigin);
+	return planes.size() == 20;
+}
+
+HPS::KeyPath SpatialIndex::keyPath(Item const & item, HPS::Canvas canvas)
+{
+	HPS::KeyPath path;
+	path.Append(item.shell);
+	path.Append(item.includes);
+	path.Append(viewPath(canvas));
+	return path;
+}
+
+HPS::KeyPath SpatialIndex::viewPath(HPS::Canvas canvas)
+{
+	HPS::View view = canvas.GetFrontView();
+	HPS::Layout layout = canvas.GetAttachedLayout();
+
+	HPS::KeyPath path;
+	path.Append(view.GetAttachedModelIncludeLink()).Append(view.GetSegmentKey());
+	path.Append(layout.GetAttachedViewIncludeLink(0)).Append(layout.GetSegmentKey());
+	path.Append(canvas.GetAttachedLayoutIncludeLink()).Append(canvas.GetWindowKey());
+	return path;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "sprk.h"
+#include "BVH.h"
+#include "TaskScheduler.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// SpatialIndex keeps a BVH of the world space boxes of every shell of a model, so picks,
+//  box queries and nearest-object queries take microseconds instead of a trip through HPS
+//  selection.  Its answers are candidates, ordered and filtered by bounding box only; HPS
+//  selection is still the tool to refine them into exact hits.
+//
+// Each shell instance is an item: a shell reached through includes is indexed once per
+//  include path, with the modelling matrices along that path applied.
+//
+// rebuild() runs on the MobileApp task scheduler (Load lane).  Queries see the previous
+//  index, or none, until it is done.  refit() updates the index in place of a rebuild after
+//  edits which move shells without adding or removing any.  All methods are thread safe.
+
+class SpatialIndex
+{
+public:
+	struct Item
+	{
+		HPS::ShellKey		shell;
+		HPS::KeyArray		includes;		// Include keys leading to the shell, innermost first
+
+		bool	operator==(Item const & other) const { return shell == other.shell && includes == other.includes; }
+	};
+
+	// For unordered containers of items
+	struct ItemHasher
+	{
+		size_t	operator()(Item const & item) const;
+	};
+
+	struct Hit
+	{
+		Item				item;
+		float				distance;		// Along the ray, to the item's box
+		HPS::MatrixKit		matrix;			// Object to world
+	};
+
+	struct Instance
+	{
+		Item				item;
+		HPS::MatrixKit		matrix;			// Object to world
+	};
+
+	struct Pair
+	{
+		Instance			first;
+		Instance			second;
+	};
+
+	typedef std::function<bool(Item const &)>	Filter;
+
+	SpatialIndex();
+	~SpatialIndex();
+
+	// Indexes the shells of 'model', replacing the current index once done
+	void			rebuild(HPS::Model const & model);
+
+	// Updates the boxes after the points of a shell, or the modelling matrix of a segment, changed.
+	//  The tree keeps its shape, so this takes a fraction of a rebuild, on the calling thread.
+	//  Edits which add or remove shells, segments or includes still need rebuild().
+	void			refit(HPS::Key const & changed);
+
+	// Drops the index, waiting for a running build to stop
+	void			clear();
+
+	bool			isReady() const;
+	size_t			itemCount() const;
+
+	// Items whose box the ray crosses, nearest first
+	size_t			raycast(HPS::Point const & origin, HPS::Vector const & direction, size_t maxHits, std::vector<Hit> & hits) const;
+
+	// Called with each item whose box the ray crosses, nearest first.  Returns how far along the
+	//  ray, in the same units as Hit::distance, later items are still wanted.
+	typedef std::function<float(Hit const &)>	HitVisitor;
+
+	// Same, without a limit on the number of hits (see BVH::raycast()).  The index is not locked
+	//  while 'visit' runs.  Returns the number of items visited.
+	size_t			raycast(HPS::Point const & origin, HPS::Vector const & direction, HitVisitor const & visit) const;
+
+	// Items whose box overlaps the given world space box
+	size_t			overlap(HPS::Point const & min, HPS::Point const & max, std::vector<Item> & items) const;
+
+	// Items whose box touches a convex volume (see BVH::volume()), split between those inside it
+	//  and those which cross, or may cross, its boundary
+	size_t			volume(std::vector<float> const & planes, std::vector<Item> & inside, std::vector<Item> & crossing) const;
+
+	// Item whose box is nearest to 'point', if one lies within maxDistance
+	bool			nearest(HPS::Point const & point, float maxDistance, Item & item, float & distance) const;
+
+	// Instances of the items accepted by 'filter'
+	size_t			instances(Filter const & filter, std::vector<Instance> & instances) const;
+
+	// Fewest key paths, as keyPath() makes them, covering the items accepted by 'filter': a segment
+	//  reached through a given include path stands for its whole subtree once every item in it is
+	//  accepted, along with the geometry other than shells it holds.  Large sets then take one
+	//  highlight per segment instead of one per shell.
+	size_t			coveringPaths(Filter const & filter, HPS::Canvas canvas, std::vector<HPS::KeyPath> & paths) const;
+
+	// Instances drawn under a selected shell or segment, given its key path as selection reports
+	//  it: from the selected key up to the window, through the includes it was selected through
+	size_t			instancesUnder(HPS::KeyPath const & path, std::vector<Instance> & instances) const;
+
+	// Pairs of distinct items whose boxes, grown by 'margin', overlap, the first item accepted by
+	//  'first' and the second by 'second'.  A pair which would match both ways is reported once.
+	size_t			overlappingPairs(Filter const & first, Filter const & second, float margin, std::vector<Pair> & pairs) const;
+
+	// Ray through a window space location of the canvas' front view, in world space
+	static bool		pickRay(HPS::Canvas canvas, HPS::WindowPoint const & location, HPS::Point & origin, HPS::Vector & direction);
+
+	// Planes bounding a world space box, as volume() takes them
+	static void		boxPlanes(HPS::Point const & min, HPS::Point const & max, std::vector<float> & planes);
+
+	// Planes bounding what the canvas' front view shows inside a window space rectangle: its four
+	//  sides, and the camera's position in front
+	static bool		frustumPlanes(HPS::Canvas canvas, HPS::WindowPoint const & min, HPS::WindowPoint const & max, std::vector<float> & planes);
+
+	// Full key path of an item seen in the canvas' front view, as HPS selection and highlighting expect
+	static HPS::KeyPath	keyPath(Item const & item, HPS::Canvas canvas);
+
+	// Path from the front view's model include up to the window, to complete paths found under the model
+	static HPS::KeyPath	viewPath(HPS::Canvas canvas);
+
+private:
+	SpatialIndex(SpatialIndex const &);
+	void operator=(SpatialIndex const &);
+
+	struct Snapshot;
+
+	void								start(HPS::SegmentKey const & root);
+	static std::shared_ptr<Snapshot>	build(HPS::SegmentKey root, std::atomic<unsigned int> const & generation, unsigned int expected);
+
+	mutable std::mutex			_mutex;
+	std::shared_ptr<Snapshot>	_snapshot;
+	TaskScheduler::TaskRef		_build;
+	HPS::SegmentKey				_root;			// Of the last build started
+
+	// Bumped by rebuild(), refit() and clear(); a build which sees it change gives up
+	std::atomic<unsigned int>	_generation;
+};
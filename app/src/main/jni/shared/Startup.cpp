@@ -0,0 +1,42 @@
+#include "Startup.h"
+#include "Trace.h"
+
+#include <atomic>
+
+#include "dprintf.h"
+
+namespace
+{
+	const char *			MILESTONE_NAMES[Startup::MilestoneCount] = {"LibraryLoaded", "WorldCreated", "SurfaceBound", "FirstFrame"};
+
+	// Trace::Now() of each milestone, 0 until reached
+	std::atomic<int64_t>	g_times[Startup::MilestoneCount];
+}
+
+void Startup::reached(Milestone milestone)
+{
+	int64_t expected = 0;
+	if (!g_times[milestone].compare_exchange_strong(expected, Trace::Now()))
+		return;
+
+	if (milestone != FirstFrame)
+		return;
+
+	int64_t const start = g_times[LibraryLoaded].load();
+	if (start == 0)
+		return;
+
+	// Each span runs from the previous milestone reached
+	int64_t previous = start;
+	for (int i = LibraryLoaded + 1; i < MilestoneCount; ++i)
+	{
+		int64_t const time = g_times[i].load();
+		if (time == 0)
+			continue;
+
+		dprintf("Startup: %s at %.1f ms\n", MILESTONE_NAMES[i], (time - start) / 1000.0);
+		TRACE_COMPLETE("startup", MILESTONE_NAMES[i], previous, time - previous);
+		if (time > previous)
+			previous = time;
+	}
+}
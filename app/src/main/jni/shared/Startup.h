@@ -0,0 +1,20 @@
+#pragma once
+
+// Startup records when the app reaches each step of a cold start, from the native library
+//  being loaded to the first frame on screen.  Tracing is usually not running that early, so
+//  the times are kept until the first frame, then logged and replayed as "startup" spans.
+
+namespace Startup
+{
+	enum Milestone
+	{
+		LibraryLoaded,		// JNI_OnLoad
+		WorldCreated,		// HPS::World ready, on its init thread
+		SurfaceBound,		// First MobileSurface::bind done
+		FirstFrame,			// First canvas update completed
+		MilestoneCount
+	};
+
+	// Only the first call for each milestone counts
+	void		reached(Milestone milestone);
+}
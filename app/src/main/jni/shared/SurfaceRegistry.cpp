@@ -0,0 +1,106 @@
+#include "SurfaceRegistry.h"
+#include "MobileSurface.h"
+
+namespace
+{
+	// Set in Slot::users by destroy(): the surface is deleted when the count drops to zero
+	const uint32_t	RETIRED = 0x80000000u;
+
+	// A slot is live while its generation is odd.  It is free for add() once it is even and
+	//  its surface pointer has been cleared by the deletion.
+	struct Slot
+	{
+		std::atomic<uint32_t>			generation;
+		std::atomic<uint32_t>			users;
+		std::atomic<MobileSurface *>	surface;
+	};
+
+	Slot	slots[SurfaceRegistry::MAX_SURFACES];
+
+	SurfaceHandle makeHandle(uint32_t generation, int slot)
+	{
+		return ((SurfaceHandle)generation << 32) | (uint32_t)slot;
+	}
+
+	// Slot index of a well-formed handle, or -1
+	int slotOf(SurfaceHandle handle)
+	{
+		int64_t const slot = handle & 0xffffffff;
+		return (handle > 0 && slot < SurfaceRegistry::MAX_SURFACES) ? (int)slot : -1;
+	}
+
+	uint32_t generationOf(SurfaceHandle handle)
+	{
+		return (uint32_t)(handle >> 32);
+	}
+
+	// Called when the count of a retired slot reached zero.  A lookup with a stale handle may
+	//  count itself in meanwhile, so only the thread clearing RETIRED deletes the surface.
+	void deleteRetired(Slot & slot)
+	{
+		uint32_t expected = RETIRED;
+		if (!slot.users.compare_exchange_strong(expected, 0))
+			return;
+
+		delete slot.surface.load();
+		slot.surface.store(nullptr);
+	}
+}
+
+SurfaceHandle SurfaceRegistry::add(MobileSurface *surface)
+{
+	for (int i = 0; i < MAX_SURFACES; ++i)
+	{
+		MobileSurface *expected = nullptr;
+		if (!slots[i].surface.compare_exchange_strong(expected, surface))
+			continue;
+
+		// Generation 0 is never live, so handles are never 0
+		uint32_t const generation = slots[i].generation.fetch_add(1) + 1;
+		surface->_handle = makeHandle(generation, i);
+		return surface->_handle;
+	}
+
+	delete surface;
+	return 0;
+}
+
+bool SurfaceRegistry::destroy(SurfaceHandle handle)
+{
+	int const i = slotOf(handle);
+	if (i < 0)
+		return false;
+
+	// Only one caller can move the slot out of this generation; new acquires fail from here on
+	uint32_t expected = generationOf(handle);
+	if ((expected & 1) == 0 || !slots[i].generation.compare_exchange_strong(expected, expected + 1))
+		return false;
+
+	if (slots[i].users.fetch_or(RETIRED) == 0)
+		deleteRetired(slots[i]);
+	return true;
+}
+
+MobileSurface * SurfaceRegistry::acquire(SurfaceHandle handle, int & slot)
+{
+	int const i = slotOf(handle);
+	if (i < 0)
+		return nullptr;
+
+	// Count ourselves in before checking the generation, so destroy() cannot miss us
+	slots[i].users.fetch_add(1);
+	if (slots[i].generation.load() != generationOf(handle) || (generationOf(handle) & 1) == 0)
+	{
+		release(i);
+		return nullptr;
+	}
+
+	slot = i;
+	return slots[i].surface.load();
+}
+
+void SurfaceRegistry::release(int slot)
+{
+	if (slots[slot].users.fetch_sub(1) == RETIRED + 1)
+		deleteRetired(slots[slot]);
+}
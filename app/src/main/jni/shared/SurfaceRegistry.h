@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+class MobileSurface;
+
+// SurfaceRegistry owns the MobileSurfaces and hands the gui opaque handles instead of pointers.
+//
+// A handle is a slot index plus the generation of the slot when the surface was added.
+//  Destroying a surface bumps the generation, so stale handles (a queued async action, a
+//  touch arriving after release) are rejected by acquire() instead of reaching freed memory.
+//  Lookups are lock-free: a Ref counts itself in the slot.  destroy() retires the slot and
+//  returns at once; the surface is deleted by destroy() when no Ref uses it, otherwise by the
+//  last Ref to go away, on whichever thread that is.
+
+typedef int64_t		SurfaceHandle;
+
+class SurfaceRegistry
+{
+public:
+	static const int		MAX_SURFACES = 32;
+
+	// Takes ownership of 'surface'.  Returns 0 when every slot is in use.
+	static SurfaceHandle	add(MobileSurface *surface);
+
+	// Invalidates 'handle' and deletes its surface once no Ref uses it, without waiting for them.
+	//  Returns false for stale handles.
+	static bool				destroy(SurfaceHandle handle);
+
+	// Keeps a surface alive while in scope.  Converts to false when the handle is stale.
+	template <typename T>
+	class Ref
+	{
+	public:
+		explicit Ref(SurfaceHandle handle) : _slot(-1), _surface(static_cast<T *>(acquire(handle, _slot))) {}
+		~Ref() { if (_surface) release(_slot); }
+
+		explicit operator bool() const { return _surface != nullptr; }
+		T *		operator->() const { return _surface; }
+		T *		get() const { return _surface; }
+
+	private:
+		Ref(Ref const &);
+		void operator=(Ref const &);
+
+		int		_slot;
+		T *		_surface;
+	};
+
+private:
+	static MobileSurface *	acquire(SurfaceHandle handle, int & slot);
+	static void				release(int slot);
+};
@@ -0,0 +1,276 @@
+#include "TaskScheduler.h"
+#include "CpuTopology.h"
+#include "ThreadPlacement.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "dprintf.h"
+
+namespace
+{
+	const char *		PRIORITY_NAMES[TaskScheduler::PriorityCount] = {"interactive", "load", "background"};
+
+	const ThreadPlacement::Role		PRIORITY_ROLES[TaskScheduler::PriorityCount] = {
+		ThreadPlacement::Latency, ThreadPlacement::Throughput, ThreadPlacement::Background};
+
+	// Scheduler and worker index of the calling thread, if it is a worker
+	thread_local TaskScheduler const *	t_scheduler = nullptr;
+	thread_local int					t_worker = -1;
+
+	unsigned int defaultWorkerCount()
+	{
+		unsigned int const cpus = CpuTopology::get().cpuCount();
+		return std::max(1u, cpus - 1);
+	}
+}
+
+TaskScheduler::Task::Task(Priority priority, Function function)
+	: _priority(priority), _function(std::move(function)), _state(Waiting), _pendingDependencies(1)
+{
+}
+
+TaskScheduler::TaskScheduler(unsigned int workerCount)
+	: _nextWorker(0), _queued(0), _stopping(false)
+{
+	if (workerCount == 0)
+		workerCount = defaultWorkerCount();
+
+	for (unsigned int i = 0; i < workerCount; ++i)
+	{
+		_workers.emplace_back(new Worker());
+		snprintf(_workers.back()->name, sizeof(_workers.back()->name), "TaskWorker %u", i);
+	}
+
+	// Started once every worker exists, since they steal from each other
+	for (unsigned int i = 0; i < workerCount; ++i)
+		_workers[i]->thread = std::thread(&TaskScheduler::run, this, (int)i);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_stopping = true;
+	}
+	_wake.notify_all();
+
+	for (auto & worker : _workers)
+		worker->thread.join();
+}
+
+TaskScheduler::TaskRef TaskScheduler::submit(Priority priority, Function function)
+{
+	return submit(priority, std::move(function), std::vector<TaskRef>());
+}
+
+TaskScheduler::TaskRef TaskScheduler::submit(Priority priority, Function function, std::vector<TaskRef> const & dependencies)
+{
+	TaskRef task(new Task(priority, std::move(function)));
+
+	bool dependencyCancelled = false;
+	for (auto const & dependency : dependencies)
+	{
+		std::lock_guard<std::mutex> lock(dependency->_mutex);
+		if (dependency->isDone())
+			dependencyCancelled |= dependency->state() != Task::Finished;
+		else
+		{
+			++task->_pendingDependencies;
+			dependency->_dependents.push_back(task);
+		}
+	}
+
+	if (dependencyCancelled)
+		cancel(task);
+
+	// Drop the reference held by submit() itself; the task is queued if nothing else holds it back
+	dependencyDone(task);
+	return task;
+}
+
+bool TaskScheduler::cancel(TaskRef const & task)
+{
+	int state = task->_state.load();
+	do
+	{
+		if (state != Task::Waiting && state != Task::Queued)
+			return false;
+	} while (!task->_state.compare_exchange_weak(state, Task::Cancelled));
+
+	// A queued task stays in its queue until a worker takes and skips it
+	complete(task, Task::Cancelled);
+	return true;
+}
+
+void TaskScheduler::wait(TaskRef const & task)
+{
+	int const worker = currentWorker();
+	if (worker >= 0)
+	{
+		while (!task->isDone())
+		{
+			TaskRef other = take(worker);
+			if (other)
+				execute(other);
+			else
+				std::this_thread::yield();
+		}
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(task->_mutex);
+	task->_done.wait(lock, [&task] { return task->isDone(); });
+}
+
+void TaskScheduler::run(int index)
+{
+	t_scheduler = this;
+	t_worker = index;
+	TRACE_THREAD_NAME(_workers[index]->name);
+
+	for (;;)
+	{
+		TaskRef task = take(index);
+		if (task)
+		{
+			execute(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_sleepMutex);
+		_wake.wait(lock, [this] { return _stopping || _queued.load() > 0; });
+		if (_stopping && _queued.load() == 0)
+			return;
+	}
+}
+
+int TaskScheduler::currentWorker() const
+{
+	return t_scheduler == this ? t_worker : -1;
+}
+
+void TaskScheduler::enqueue(TaskRef const & task)
+{
+	// Workers keep what they spawn, other threads spread their tasks over the workers
+	int index = currentWorker();
+	if (index < 0)
+		index = (int)(_nextWorker++ % _workers.size());
+
+	{
+		Worker & worker = *_workers[index];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.queues[task->_priority].push_back(task);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		++_queued;
+	}
+	_wake.notify_one();
+}
+
+TaskScheduler::TaskRef TaskScheduler::take(int index)
+{
+	int const count = (int)_workers.size();
+
+	for (int priority = 0; priority < PriorityCount; ++priority)
+	{
+		// Own queue, newest first
+		{
+			Worker & worker = *_workers[index];
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			std::deque<TaskRef> & queue = worker.queues[priority];
+			if (!queue.empty())
+			{
+				TaskRef task = std::move(queue.back());
+				queue.pop_back();
+				--_queued;
+				return task;
+			}
+		}
+
+		// Steal the oldest task of another worker
+		for (int i = 1; i < count; ++i)
+		{
+			Worker & victim = *_workers[(index + i) % count];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			std::deque<TaskRef> & queue = victim.queues[priority];
+			if (!queue.empty())
+			{
+				TaskRef task = std::move(queue.front());
+				queue.pop_front();
+				--_queued;
+				TRACE_INSTANT("task", "steal");
+				return task;
+			}
+		}
+	}
+
+	return TaskRef();
+}
+
+void TaskScheduler::execute(TaskRef const & task)
+{
+	// Cancelled tasks are left in the queues and skipped here
+	int expected = Task::Queued;
+	if (!task->_state.compare_exchange_strong(expected, Task::Running))
+		return;
+
+	ThreadPlacement::apply(PRIORITY_ROLES[task->_priority]);
+
+	// An HPS exception, e.g. on a key deleted by a rebuild, fails the task rather than the process
+	Task::State state = Task::Finished;
+	{
+		// Categorized by cluster so the trace shows how long each lane takes where it ran
+		TRACE_SCOPE(ThreadPlacement::currentClusterName(), PRIORITY_NAMES[task->_priority]);
+		try
+		{
+			task->_function();
+		}
+		catch (std::exception const & e)
+		{
+			eprintf("%s task failed: %s\n", PRIORITY_NAMES[task->_priority], e.what());
+			state = Task::Failed;
+		}
+		catch (...)
+		{
+			eprintf("%s task failed\n", PRIORITY_NAMES[task->_priority]);
+			state = Task::Failed;
+		}
+	}
+
+	// Release captured resources now rather than when the last TaskRef goes away
+	task->_function = Function();
+	complete(task, state);
+}
+
+void TaskScheduler::complete(TaskRef const & task, Task::State state)
+{
+	std::vector<TaskRef> dependents;
+	{
+		std::lock_guard<std::mutex> lock(task->_mutex);
+		task->_state.store(state);
+		dependents.swap(task->_dependents);
+	}
+	task->_done.notify_all();
+
+	for (auto const & dependent : dependents)
+	{
+		if (state != Task::Finished)
+			cancel(dependent);
+		dependencyDone(dependent);
+	}
+}
+
+void TaskScheduler::dependencyDone(TaskRef const & task)
+{
+	if (--task->_pendingDependencies != 0)
+		return;
+
+	int expected = Task::Waiting;
+	if (task->_state.compare_exchange_strong(expected, Task::Queued))
+		enqueue(task);
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// TaskScheduler is the pool shared by all native background work (import post-processing,
+//  thumbnails, LOD building, spatial indexing, ...), so such jobs do not each start threads
+//  and oversubscribe the cores.  It is owned by MobileApp.
+//
+// Each worker has its own queues and takes its newest task first, which keeps related work
+//  on one core; idle workers steal the oldest tasks of the others.  Tasks are taken by
+//  priority lane first: an Interactive task is always picked before any Load task, and a
+//  Load task before any Background task.
+//
+// Usage:
+//
+//   TaskScheduler & scheduler = MobileApp::inst().scheduler();
+//   auto parse = scheduler.submit(TaskScheduler::Load, [] { ... });
+//   auto index = scheduler.submit(TaskScheduler::Background, [] { ... }, {parse});
+//   ...
+//   scheduler.cancel(index);		// Skipped if it has not started yet
+
+class TaskScheduler
+{
+public:
+	enum Priority
+	{
+		Interactive,		// Work the user is waiting on (selection, queries)
+		Load,				// Import and its post-processing
+		Background,			// Anything that can wait (thumbnails, LODs, indexes)
+		PriorityCount
+	};
+
+	typedef std::function<void()>	Function;
+
+	class Task
+	{
+	public:
+		enum State
+		{
+			Waiting,		// On its dependencies
+			Queued,
+			Running,
+			Finished,
+			Cancelled,
+			Failed			// Threw an exception
+		};
+
+		State		state() const { return (State)_state.load(); }
+		bool		isDone() const { return state() >= Finished; }
+
+	private:
+		friend class TaskScheduler;
+
+		Task(Priority priority, Function function);
+		Task(Task const &);
+		void operator=(Task const &);
+
+		Priority					_priority;
+		Function					_function;
+		std::atomic<int>			_state;
+		std::atomic<int>			_pendingDependencies;
+		std::mutex					_mutex;
+		std::condition_variable		_done;
+		std::vector<std::shared_ptr<Task>>	_dependents;
+	};
+
+	typedef std::shared_ptr<Task>	TaskRef;
+
+	// With 0 workers, the pool is sized from CpuTopology: one worker per core, minus one core of
+	//  the fastest cluster which is left to the render and ui threads.
+	explicit TaskScheduler(unsigned int workerCount = 0);
+
+	// Runs the tasks already queued, then stops the workers
+	~TaskScheduler();
+
+	TaskRef			submit(Priority priority, Function function);
+
+	// 'function' runs once every task of 'dependencies' has finished.  If one of them is
+	//  cancelled or fails, this task is cancelled too.
+	TaskRef			submit(Priority priority, Function function, std::vector<TaskRef> const & dependencies);
+
+	// Cancels a task which has not started yet, along with the tasks depending on it.
+	//  Returns false if the task is already running or done.
+	bool			cancel(TaskRef const & task);
+
+	// Blocks until 'task' has finished or been cancelled.  Called from a task, the worker runs
+	//  other tasks meanwhile instead of blocking.
+	void			wait(TaskRef const & task);
+
+	unsigned int	workerCount() const { return (unsigned int)_workers.size(); }
+
+private:
+	TaskScheduler(TaskScheduler const &);		// Non-copyable
+	void operator=(TaskScheduler const &);
+
+	struct Worker
+	{
+		std::mutex				mutex;
+		std::deque<TaskRef>		queues[PriorityCount];
+		std::thread				thread;
+		char					name[24];		// Outlives any trace session
+	};
+
+	void			run(int index);
+	int				currentWorker() const;
+	void			enqueue(TaskRef const & task);
+	TaskRef			take(int index);
+	void			execute(TaskRef const & task);
+	void			complete(TaskRef const & task, Task::State state);
+	void			dependencyDone(TaskRef const & task);
+
+	std::vector<std::unique_ptr<Worker>>	_workers;
+	std::atomic<unsigned int>	_nextWorker;
+	std::atomic<int>			_queued;
+
+	std::mutex					_sleepMutex;
+	std::condition_variable		_wake;
+	bool						_stopping;
+};
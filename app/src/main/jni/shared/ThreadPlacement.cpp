@@ -0,0 +1,90 @@
+#include "ThreadPlacement.h"
+#include "CpuTopology.h"
+#include "Trace.h"
+
+#include <atomic>
+#include <sched.h>
+
+#include "dprintf.h"
+
+namespace
+{
+	const char *	ROLE_NAMES[ThreadPlacement::RoleCount] = {"latency", "throughput", "background"};
+	const char *	CLUSTER_NAMES[] = {"cluster0", "cluster1", "cluster2", "cluster3", "cluster4", "cluster5", "cluster6", "cluster7"};
+	const int		MAX_CLUSTERS = sizeof(CLUSTER_NAMES) / sizeof(CLUSTER_NAMES[0]);
+
+	std::atomic<int>	g_policy[ThreadPlacement::RoleCount] = {
+		{ThreadPlacement::BigCores}, {ThreadPlacement::BigCores}, {ThreadPlacement::LittleCores}};
+
+	// Core set the calling thread is pinned to, -1 if it was never pinned
+	thread_local int	t_cores = -1;
+
+	bool pin(ThreadPlacement::CoreSet cores)
+	{
+		CpuTopology const & topology = CpuTopology::get();
+		size_t const clusterCount = topology.clusters.size();
+
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (size_t i = 0; i < clusterCount; ++i)
+		{
+			bool const little = i + 1 == clusterCount;
+			if (clusterCount == 1 || cores == ThreadPlacement::AnyCores ||
+				(cores == ThreadPlacement::BigCores) != little)
+			{
+				for (int cpu : topology.clusters[i].cpus)
+					CPU_SET(cpu, &set);
+			}
+		}
+
+		if (sched_setaffinity(0, sizeof(set), &set) != 0)
+		{
+			wprintf("Could not set thread affinity\n");
+			return false;
+		}
+		return true;
+	}
+}
+
+void ThreadPlacement::setPolicy(Role role, CoreSet cores)
+{
+	g_policy[role].store(cores);
+}
+
+ThreadPlacement::CoreSet ThreadPlacement::policy(Role role)
+{
+	return (CoreSet)g_policy[role].load();
+}
+
+void ThreadPlacement::apply(Role role)
+{
+	int const cores = g_policy[role].load(std::memory_order_relaxed);
+	if (cores == t_cores)
+		return;
+
+	// A thread which was never pinned already runs anywhere
+	if (CpuTopology::get().clusters.size() < 2 || (t_cores < 0 && cores == AnyCores))
+	{
+		t_cores = cores;
+		return;
+	}
+
+	if (pin((CoreSet)cores))
+		TRACE_INSTANT("placement", ROLE_NAMES[role]);
+	t_cores = cores;
+}
+
+const char * ThreadPlacement::currentClusterName()
+{
+	int const cpu = sched_getcpu();
+	CpuTopology const & topology = CpuTopology::get();
+	for (size_t i = 0; i < topology.clusters.size() && i < (size_t)MAX_CLUSTERS; ++i)
+	{
+		for (int c : topology.clusters[i].cpus)
+		{
+			if (c == cpu)
+				return CLUSTER_NAMES[i];
+		}
+	}
+	return "cluster?";
+}
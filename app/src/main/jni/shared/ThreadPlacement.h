@@ -0,0 +1,40 @@
+#pragma once
+
+// ThreadPlacement moves threads onto the cores suited to their work, using the clusters of
+//  CpuTopology.  Latency threads (HPS render and event threads, interactive tasks) and
+//  throughput threads (import, async actions, load tasks) belong on the big cores; background
+//  tasks can be left to the LITTLE ones.  The policy is set with MobileApp::setThreadPlacement.
+//
+// Threads call apply() with their role whenever they start a piece of work.  The affinity is
+//  only changed when the policy for that role differs from what the thread already has, so
+//  apply() normally costs a thread-local check.  Each change is recorded as a "placement"
+//  instant in the trace, and tasks record the cluster they ran on as their trace category.
+//
+// With a single cluster (or when sysfs is unreadable) nothing is pinned.
+
+namespace ThreadPlacement
+{
+	enum Role
+	{
+		Latency,
+		Throughput,
+		Background,
+		RoleCount
+	};
+
+	enum CoreSet
+	{
+		AnyCores = 0,
+		BigCores = 1,		// Every cluster but the slowest
+		LittleCores = 2		// The slowest cluster
+	};
+
+	void			setPolicy(Role role, CoreSet cores);
+	CoreSet			policy(Role role);
+
+	// Pins the calling thread to the cores of 'role' if it is not already there
+	void			apply(Role role);
+
+	// "cluster0" (fastest), "cluster1", ... for the core running the calling thread
+	const char *	currentClusterName();
+}
@@ -0,0 +1,257 @@
+#include "TouchRecording.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "dprintf.h"
+
+namespace
+{
+	const char			MAGIC[4] = { 'H', 'T', 'R', 'C' };
+	const uint16_t		VERSION = 1;
+
+	// Serialization helpers: fields are written one by one so the layout never depends on struct padding
+
+	template <typename T>
+	void put(std::vector<uint8_t> & out, T value)
+	{
+		uint8_t bytes[sizeof(T)];
+		memcpy(bytes, &value, sizeof(T));
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+
+	class Reader
+	{
+	public:
+		Reader(std::vector<uint8_t> const & data) : _data(data), _offset(0), _ok(true) {}
+
+		template <typename T>
+		T get()
+		{
+			T value = T();
+			if (_offset + sizeof(T) > _data.size())
+			{
+				_ok = false;
+				return value;
+			}
+			memcpy(&value, _data.data() + _offset, sizeof(T));
+			_offset += sizeof(T);
+			return value;
+		}
+
+		bool ok() const { return _ok; }
+
+	private:
+		std::vector<uint8_t> const &	_data;
+		size_t							_offset;
+		bool							_ok;
+	};
+
+	void putPoint(std::vector<uint8_t> & out, float x, float y, float z)
+	{
+		put(out, x);
+		put(out, y);
+		put(out, z);
+	}
+}
+
+TouchRecording::TouchRecording()
+	: _width(0), _height(0), _startTime(0)
+{
+}
+
+void TouchRecording::begin(HPS::CameraKit const & camera, unsigned int width, unsigned int height)
+{
+	_entries.clear();
+	_touches.clear();
+	_camera = camera;
+	_width = width;
+	_height = height;
+	_startTime = 0;
+}
+
+void TouchRecording::add(Type type, int64_t eventTime, int numTouches, int xPosArray[], int yPosArray[], HPS::TouchID idArray[], size_t tapCount)
+{
+	if (_entries.empty())
+		_startTime = eventTime;
+
+	Entry		entry;
+	entry.time = eventTime - _startTime;
+	entry.type = type;
+	entry.tapCount = (uint16_t)tapCount;
+	entry.touchCount = (uint32_t)numTouches;
+	entry.firstTouch = (uint32_t)_touches.size();
+
+	// Events may arrive slightly out of order between the MotionEvent clock and the
+	//  tap gesture callbacks; keep the stream monotonic so deltas stay unsigned
+	if (!_entries.empty() && entry.time < _entries.back().time)
+		entry.time = _entries.back().time;
+
+	for (int i = 0; i < numTouches; ++i)
+	{
+		Touch	touch;
+		touch.x = xPosArray[i];
+		touch.y = yPosArray[i];
+		touch.id = idArray ? idArray[i] : 0;
+		_touches.push_back(touch);
+	}
+
+	_entries.push_back(entry);
+}
+
+bool TouchRecording::save(const char *fileName) const
+{
+	std::vector<uint8_t>	out;
+	out.reserve(64 + _entries.size() * 8 + _touches.size() * 6);
+
+	out.insert(out.end(), MAGIC, MAGIC + sizeof(MAGIC));
+	put<uint16_t>(out, VERSION);
+	put<uint16_t>(out, 0);
+	put<uint32_t>(out, _width);
+	put<uint32_t>(out, _height);
+	put<uint32_t>(out, (uint32_t)_entries.size());
+
+	HPS::Point					position(0, 0, -5), target(0, 0, 0);
+	HPS::Vector					up(0, 1, 0);
+	float						fieldWidth = 0, fieldHeight = 0;
+	HPS::Camera::Projection		projection = HPS::Camera::Projection::Perspective;
+	_camera.ShowPosition(position);
+	_camera.ShowTarget(target);
+	_camera.ShowUpVector(up);
+	_camera.ShowField(fieldWidth, fieldHeight);
+	_camera.ShowProjection(projection);
+
+	putPoint(out, position.x, position.y, position.z);
+	putPoint(out, target.x, target.y, target.z);
+	putPoint(out, up.x, up.y, up.z);
+	put(out, fieldWidth);
+	put(out, fieldHeight);
+	put<uint32_t>(out, (uint32_t)projection);
+
+	int64_t		previous = 0;
+	for (auto const & entry : _entries)
+	{
+		put<uint32_t>(out, (uint32_t)(entry.time - previous));
+		put<uint8_t>(out, (uint8_t)entry.type);
+		put<uint8_t>(out, (uint8_t)entry.touchCount);
+		put<uint16_t>(out, entry.tapCount);
+		for (uint32_t i = 0; i < entry.touchCount; ++i)
+		{
+			Touch const & touch = _touches[entry.firstTouch + i];
+			put<int16_t>(out, (int16_t)touch.x);
+			put<int16_t>(out, (int16_t)touch.y);
+			put<uint16_t>(out, (uint16_t)touch.id);
+		}
+		previous = entry.time;
+	}
+
+	FILE *file = fopen(fileName, "wb");
+	if (file == nullptr)
+	{
+		eprintf("Unable to write touch recording %s\n", fileName);
+		return false;
+	}
+
+	bool const written = fwrite(out.data(), 1, out.size(), file) == out.size();
+	fclose(file);
+
+	if (!written)
+		eprintf("Unable to write touch recording %s\n", fileName);
+	return written;
+}
+
+bool TouchRecording::load(const char *fileName)
+{
+	FILE *file = fopen(fileName, "rb");
+	if (file == nullptr)
+	{
+		eprintf("Unable to open touch recording %s\n", fileName);
+		return false;
+	}
+
+	std::vector<uint8_t>	data;
+	uint8_t					chunk[4096];
+	size_t					read;
+	while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+		data.insert(data.end(), chunk, chunk + read);
+	fclose(file);
+
+	if (data.size() < sizeof(MAGIC) || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0)
+	{
+		eprintf("%s is not a touch recording\n", fileName);
+		return false;
+	}
+
+	Reader		in(data);
+	for (size_t i = 0; i < sizeof(MAGIC); ++i)
+		in.get<char>();
+
+	uint16_t const version = in.get<uint16_t>();
+	if (version != VERSION)
+	{
+		eprintf("Unsupported touch recording version %u in %s\n", (unsigned)version, fileName);
+		return false;
+	}
+	in.get<uint16_t>();
+
+	_width = in.get<uint32_t>();
+	_height = in.get<uint32_t>();
+	uint32_t const entryCount = in.get<uint32_t>();
+
+	float		v[11];
+	for (float & f : v)
+		f = in.get<float>();
+	uint32_t const projection = in.get<uint32_t>();
+
+	_camera = HPS::CameraKit()
+		.SetPosition(HPS::Point(v[0], v[1], v[2]))
+		.SetTarget(HPS::Point(v[3], v[4], v[5]))
+		.SetUpVector(HPS::Vector(v[6], v[7], v[8]))
+		.SetField(v[9], v[10])
+		.SetProjection((HPS::Camera::Projection)projection);
+
+	_entries.clear();
+	_touches.clear();
+	_startTime = 0;
+
+	int64_t		time = 0;
+	for (uint32_t e = 0; e < entryCount && in.ok(); ++e)
+	{
+		Entry		entry;
+		time += in.get<uint32_t>();
+		entry.time = time;
+		uint8_t const type = in.get<uint8_t>();
+		if (in.ok() && type > (uint8_t)Type::DoubleTap)
+		{
+			eprintf("Unknown entry type %u in touch recording %s\n", (unsigned)type, fileName);
+			_entries.clear();
+			_touches.clear();
+			return false;
+		}
+		entry.type = (Type)type;
+		entry.touchCount = in.get<uint8_t>();
+		entry.tapCount = in.get<uint16_t>();
+		entry.firstTouch = (uint32_t)_touches.size();
+
+		for (uint32_t i = 0; i < entry.touchCount; ++i)
+		{
+			Touch	touch;
+			touch.x = in.get<int16_t>();
+			touch.y = in.get<int16_t>();
+			touch.id = in.get<uint16_t>();
+			_touches.push_back(touch);
+		}
+
+		_entries.push_back(entry);
+	}
+
+	if (!in.ok())
+	{
+		eprintf("Touch recording %s is truncated\n", fileName);
+		_entries.clear();
+		_touches.clear();
+		return false;
+	}
+
+	return true;
+}
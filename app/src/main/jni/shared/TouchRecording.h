@@ -0,0 +1,87 @@
+#pragma once
+
+#include "hps.h"
+
+#include <stdint.h>
+#include <vector>
+
+// TouchRecording holds a stream of touchDown/touchMove/touchUp/singleTap/doubleTap
+//  calls with their timing, so the same interaction can be replayed against a model
+//  to compare builds (see MobileSurface::replayTouchRecording).
+//
+// The recording also keeps the window size (touches are rescaled when replaying on
+//  a different surface size) and the camera at the time recording started, which is
+//  restored before replaying so the replay is deterministic.
+//
+// File layout (little-endian):
+//   header:  "HTRC", uint16 version, uint16 reserved,
+//            uint32 window width, uint32 window height, uint32 entry count,
+//            float position[3], target[3], up[3], field[2], uint32 projection
+//   entry:   uint32 microseconds since previous entry, uint8 type, uint8 touch count,
+//            uint16 tap count, then per touch: int16 x, int16 y, uint16 id
+
+class TouchRecording
+{
+public:
+	enum class Type : uint8_t
+	{
+		TouchDown,
+		TouchMove,
+		TouchUp,
+		SingleTap,
+		DoubleTap
+	};
+
+	struct Touch
+	{
+		int					x;
+		int					y;
+		HPS::TouchID		id;
+	};
+
+	struct Entry
+	{
+		int64_t				time;			// Microseconds since the first entry
+		Type				type;
+		uint16_t			tapCount;
+		uint32_t			touchCount;
+		uint32_t			firstTouch;		// Index into touches()
+	};
+
+	// Index of each value filled by MobileSurface::replayTouchRecording
+	enum ReplayStat
+	{
+		EventCount,
+		FrameCount,
+		Duration,			// ms
+		MeanFrameTime,		// ms
+		MedianFrameTime,	// ms
+		Percentile95FrameTime,	// ms
+		MaxFrameTime,		// ms
+		FramesPerSecond,
+		ReplayStatCount
+	};
+
+	TouchRecording();
+
+	void					begin(HPS::CameraKit const & camera, unsigned int width, unsigned int height);
+	void					add(Type type, int64_t eventTime, int numTouches, int xPosArray[], int yPosArray[], HPS::TouchID idArray[], size_t tapCount = 1);
+
+	bool					save(const char *fileName) const;
+	bool					load(const char *fileName);
+
+	std::vector<Entry> const &	entries() const { return _entries; }
+	Touch const *			touches(Entry const & entry) const { return _touches.data() + entry.firstTouch; }
+
+	HPS::CameraKit const &	camera() const { return _camera; }
+	unsigned int			width() const { return _width; }
+	unsigned int			height() const { return _height; }
+
+private:
+	std::vector<Entry>		_entries;
+	std::vector<Touch>		_touches;
+	HPS::CameraKit			_camera;
+	unsigned int			_width;
+	unsigned int			_height;
+	int64_t					_startTime;
+};
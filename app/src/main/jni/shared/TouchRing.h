@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Touch input travels from the gui to MobileSurface through a ring of fixed size samples
+//  in memory shared by both sides (a direct ByteBuffer on Android).  The gui writes each
+//  MotionEvent once into the next slots and passes only slot indices across; MobileSurface
+//  reads the positions and ids in place, so dragging allocates nothing and copies nothing.
+//
+// The layout is mirrored by the TOUCH_* constants in AndroidMobileSurfaceView.java.
+
+struct TouchSample
+{
+	enum Action
+	{
+		Down = 0,
+		Move = 1,
+		Up = 2,
+		Cancel = 3
+	};
+
+	static const int	MAX_TOUCHES = 10;
+
+	int64_t				eventTime;		// CLOCK_MONOTONIC microseconds
+	int32_t				action;			// TouchSample::Action
+	int32_t				count;
+	int32_t				x[MAX_TOUCHES];
+	int32_t				y[MAX_TOUCHES];
+	int64_t				id[MAX_TOUCHES];
+};
+
+static_assert(sizeof(TouchSample) == 176, "TouchSample layout must match AndroidMobileSurfaceView.TOUCH_SAMPLE_BYTES");
+static_assert(offsetof(TouchSample, x) == 16 && offsetof(TouchSample, y) == 56 && offsetof(TouchSample, id) == 96,
+	"TouchSample layout must match AndroidMobileSurfaceView.TOUCH_* offsets");
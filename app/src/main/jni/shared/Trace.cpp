@@ -0,0 +1,267 @@
+#include "Trace.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+// dprintf.h redefines printf-like names, so it has to come after the system headers
+#include "dprintf.h"
+
+namespace
+{
+    // Events per thread and per session.  Further events are dropped (and counted).
+    const uint32_t      kEventsPerThread = 16384;
+
+    // Buffers kept past this many are taken from exited threads even when that drops their events
+    const size_t        kMaxBuffers = 32;
+
+    struct Event
+    {
+        const char *    category;
+        const char *    name;
+        int64_t         timestamp;
+        int64_t         value;          // Duration for spans, value for counters
+        char            phase;          // Chrome trace-event phase: 'X', 'i' or 'C'
+    };
+
+    // Each thread only ever appends to its own buffer, so recording needs no locks.
+    // 'count' is published with release semantics so Write() can read a consistent prefix.
+    // Resetting a buffer (new session, new owner) takes g_registryMutex, as Write() does.
+    struct ThreadBuffer
+    {
+        ThreadBuffer() : tid(0), name(nullptr), session(0), count(0), events(nullptr) {}
+
+        int                         tid;
+        std::atomic<const char *>   name;
+        std::atomic<uint32_t>       session;
+        std::atomic<uint32_t>       count;
+        Event *                     events;
+    };
+
+    std::atomic<bool>           g_enabled(false);
+    std::atomic<uint32_t>       g_session(0);
+    std::atomic<uint32_t>       g_dropped(0);
+
+    // Only touched when a thread starts or stops tracing, once per session, and by Write()
+    std::mutex                  g_registryMutex;
+    std::vector<ThreadBuffer *> g_buffers;
+    std::vector<ThreadBuffer *> g_freeBuffers;     // Of exited threads, kept for Write() until reused
+
+    thread_local ThreadBuffer * t_buffer = nullptr;
+    thread_local const char *   t_threadName = nullptr;
+
+    pthread_key_t               g_exitKey;
+    pthread_once_t              g_exitKeyOnce = PTHREAD_ONCE_INIT;
+
+    // Worker and attached JNI threads come and go: their buffers go to the next new thread
+    void releaseBuffer(void * buffer)
+    {
+        // Runs on the exiting thread: anything it traces later takes a buffer again
+        t_buffer = nullptr;
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        g_freeBuffers.push_back(static_cast<ThreadBuffer *>(buffer));
+    }
+
+    void createExitKey()
+    {
+        pthread_key_create(&g_exitKey, releaseBuffer);
+    }
+
+    ThreadBuffer * threadBuffer()
+    {
+        ThreadBuffer * buffer = t_buffer;
+        uint32_t session = g_session.load(std::memory_order_acquire);
+        if (buffer == nullptr)
+        {
+            pthread_once(&g_exitKeyOnce, createExitKey);
+            {
+                std::lock_guard<std::mutex> lock(g_registryMutex);
+                // Preferably one whose events belong to an earlier session
+                auto reused = g_freeBuffers.end();
+                for (auto it = g_freeBuffers.begin(); it != g_freeBuffers.end(); ++it)
+                {
+                    if ((*it)->session.load(std::memory_order_relaxed) != session)
+                        reused = it;
+                }
+                if (reused == g_freeBuffers.end() && !g_freeBuffers.empty() && g_buffers.size() >= kMaxBuffers)
+                    reused = g_freeBuffers.begin();
+
+                if (reused != g_freeBuffers.end())
+                {
+                    buffer = *reused;
+                    g_freeBuffers.erase(reused);
+                    if (buffer->session.load(std::memory_order_relaxed) == session)
+                        g_dropped.fetch_add(buffer->count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                }
+                else
+                {
+                    buffer = new ThreadBuffer();
+                    buffer->events = new Event[kEventsPerThread];
+                    g_buffers.push_back(buffer);
+                }
+                buffer->tid = (int)syscall(__NR_gettid);
+                buffer->name.store(t_threadName, std::memory_order_relaxed);
+                buffer->count.store(0, std::memory_order_relaxed);
+                buffer->session.store(session, std::memory_order_release);
+            }
+            pthread_setspecific(g_exitKey, buffer);
+            t_buffer = buffer;
+        }
+
+        // First event of a new session: the owning thread recycles its own buffer
+        if (buffer->session.load(std::memory_order_relaxed) != session)
+        {
+            std::lock_guard<std::mutex> lock(g_registryMutex);
+            buffer->count.store(0, std::memory_order_relaxed);
+            buffer->session.store(session, std::memory_order_release);
+        }
+
+        return buffer;
+    }
+
+    void record(char phase, const char * category, const char * name, int64_t timestamp, int64_t value)
+    {
+        if (!g_enabled.load(std::memory_order_relaxed))
+            return;
+
+        ThreadBuffer * buffer = threadBuffer();
+        uint32_t index = buffer->count.load(std::memory_order_relaxed);
+        if (index >= kEventsPerThread)
+        {
+            g_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        Event & event = buffer->events[index];
+        event.category = category;
+        event.name = name;
+        event.timestamp = timestamp;
+        event.value = value;
+        event.phase = phase;
+
+        buffer->count.store(index + 1, std::memory_order_release);
+    }
+
+    void writeString(FILE * file, const char * str)
+    {
+        fputc('"', file);
+        for (const char * c = str ? str : ""; *c; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+                fputc('\\', file);
+            if ((unsigned char)*c >= 0x20)
+                fputc(*c, file);
+        }
+        fputc('"', file);
+    }
+}
+
+int64_t Trace::Now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void Trace::Start()
+{
+    g_dropped.store(0, std::memory_order_relaxed);
+    g_session.fetch_add(1, std::memory_order_acq_rel);
+    g_enabled.store(true, std::memory_order_release);
+}
+
+void Trace::Stop()
+{
+    g_enabled.store(false, std::memory_order_release);
+}
+
+bool Trace::IsEnabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void Trace::SetThreadName(const char * name)
+{
+    t_threadName = name;
+    if (t_buffer != nullptr)
+        t_buffer->name.store(name, std::memory_order_relaxed);
+}
+
+void Trace::Complete(const char * category, const char * name, int64_t start, int64_t duration)
+{
+    record('X', category, name, start, duration);
+}
+
+void Trace::Instant(const char * category, const char * name)
+{
+    record('i', category, name, Now(), 0);
+}
+
+void Trace::Counter(const char * name, int64_t value)
+{
+    record('C', "counter", name, Now(), value);
+}
+
+bool Trace::Write(const char * fileName)
+{
+    FILE * file = fopen(fileName, "w");
+    if (file == nullptr)
+    {
+        eprintf("Trace: cannot open %s\n", fileName);
+        return false;
+    }
+
+    const int pid = (int)getpid();
+    const uint32_t session = g_session.load(std::memory_order_acquire);
+    bool first = true;
+    size_t written = 0;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    for (ThreadBuffer * buffer : g_buffers)
+    {
+        if (buffer->session.load(std::memory_order_acquire) != session)
+            continue;
+
+        const char * threadName = buffer->name.load(std::memory_order_relaxed);
+        if (threadName != nullptr)
+        {
+            fprintf(file, "%s{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":", first ? "" : ",\n", pid, buffer->tid);
+            writeString(file, threadName);
+            fprintf(file, "}}");
+            first = false;
+        }
+
+        const uint32_t count = buffer->count.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            Event const & event = buffer->events[i];
+            fprintf(file, "%s{\"ph\":\"%c\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"cat\":", first ? "" : ",\n", event.phase, pid, buffer->tid, (long long)event.timestamp);
+            writeString(file, event.category);
+            fprintf(file, ",\"name\":");
+            writeString(file, event.name);
+
+            if (event.phase == 'X')
+                fprintf(file, ",\"dur\":%lld}", (long long)event.value);
+            else if (event.phase == 'C')
+                fprintf(file, ",\"args\":{\"value\":%lld}}", (long long)event.value);
+            else
+                fprintf(file, ",\"s\":\"t\"}");
+
+            first = false;
+            ++written;
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    dprintf("Trace: wrote %u events to %s (%u dropped)\n", (unsigned)written, fileName, (unsigned)g_dropped.load(std::memory_order_relaxed));
+    return true;
+}
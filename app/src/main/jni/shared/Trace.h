@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+
+// Trace is a lightweight span tracer used to see where time goes across the
+//  Java/JNI/HPS boundary.  Spans are recorded into per-thread buffers without
+//  taking locks, and Trace::Write() dumps them as a Chrome trace-event JSON
+//  file which opens in Perfetto (ui.perfetto.dev) or chrome://tracing.
+//
+// Tracing is compiled in only when USING_TRACING is defined (see
+//  android_sandbox.mk).  Otherwise the TRACE_* macros do nothing, and their
+//  arguments are not evaluated.
+//
+// Names and categories must be string literals (or otherwise outlive the
+//  trace session); only the pointer is recorded.
+//
+// Usage:
+//
+//   void MobileSurface::refresh()
+//   {
+//       TRACE_SCOPE("surface", "refresh");
+//       ...
+//   }
+
+namespace Trace
+{
+    // Monotonic clock in microseconds
+    int64_t     Now();
+
+    // Begin a new trace session, discarding anything recorded previously
+    void        Start();
+
+    // Stop recording.  Recorded events are kept until the next Start()
+    void        Stop();
+
+    bool        IsEnabled();
+
+    // Write the events of the current session to a JSON trace file
+    bool        Write(const char *fileName);
+
+    // Name the calling thread in the trace output
+    void        SetThreadName(const char *name);
+
+    // Record a span which started at 'start' and lasted 'duration' microseconds
+    void        Complete(const char *category, const char *name, int64_t start, int64_t duration);
+
+    // Record a single point in time
+    void        Instant(const char *category, const char *name);
+
+    // Record a value which is displayed as a graph
+    void        Counter(const char *name, int64_t value);
+
+    // Records a span covering the lifetime of the object
+    class Scope
+    {
+    public:
+        Scope(const char *category, const char *name)
+            : _category(category), _name(name), _start(IsEnabled() ? Now() : -1) {}
+
+        ~Scope()
+        {
+            if (_start >= 0)
+                Complete(_category, _name, _start, Now() - _start);
+        }
+
+    private:
+        Scope(Scope const &);
+        void operator=(Scope const &);
+
+        const char *    _category;
+        const char *    _name;
+        int64_t         _start;
+    };
+}
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+#ifdef USING_TRACING
+    #define TRACE_SCOPE(category, name)                         Trace::Scope TRACE_CONCAT(_traceScope, __LINE__)(category, name)
+    #define TRACE_COMPLETE(category, name, start, duration)     Trace::Complete(category, name, start, duration)
+    #define TRACE_INSTANT(category, name)                       Trace::Instant(category, name)
+    #define TRACE_COUNTER(name, value)                          Trace::Counter(name, value)
+    #define TRACE_THREAD_NAME(name)                             Trace::SetThreadName(name)
+#else
+    // Arguments are not evaluated, but still count as used
+    #define TRACE_SCOPE(category, name)                         ((void)sizeof(category), (void)sizeof(name))
+    #define TRACE_COMPLETE(category, name, start, duration)     ((void)sizeof(category), (void)sizeof(name), (void)sizeof(start), (void)sizeof(duration))
+    #define TRACE_INSTANT(category, name)                       ((void)sizeof(category), (void)sizeof(name))
+    #define TRACE_COUNTER(name, value)                          ((void)sizeof(name), (void)sizeof(value))
+    #define TRACE_THREAD_NAME(name)                             ((void)sizeof(name))
+#endif
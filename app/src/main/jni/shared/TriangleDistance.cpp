@@ -0,0 +1,242 @@
+#include "TriangleDistance.h"
+
+#include <algorithm>
+#include <stdlib.h>
+
+namespace
+{
+	const float		EPSILON = 1e-12f;
+
+	inline float clamp01(float v)
+	{
+		return std::min(std::max(v, 0.0f), 1.0f);
+	}
+
+	// Closest points of the 9 edge pairs of p and q, one pair per lane.  Written without branches,
+	//  as selects over fixed size arrays, for the auto-vectorizer.  Returns the nearest lane.
+	int nearestEdges(Triangle const & p, Triangle const & q, float & distance2, float first[3], float second[3])
+	{
+		float p0[3][9], d1[3][9], q0[3][9], d2[3][9];
+		float const * pc[3] = {p.x, p.y, p.z};
+		float const * qc[3] = {q.x, q.y, q.z};
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			for (int lane = 0; lane < 9; ++lane)
+			{
+				int const i = lane / 3, j = lane % 3;
+				p0[axis][lane] = pc[axis][i];
+				d1[axis][lane] = pc[axis][(i + 1) % 3] - pc[axis][i];
+				q0[axis][lane] = qc[axis][j];
+				d2[axis][lane] = qc[axis][(j + 1) % 3] - qc[axis][j];
+			}
+		}
+
+		float s[9], t[9], dist2[9];
+		for (int lane = 0; lane < 9; ++lane)
+		{
+			float const rx = p0[0][lane] - q0[0][lane];
+			float const ry = p0[1][lane] - q0[1][lane];
+			float const rz = p0[2][lane] - q0[2][lane];
+			float const a = d1[0][lane] * d1[0][lane] + d1[1][lane] * d1[1][lane] + d1[2][lane] * d1[2][lane];
+			float const e = d2[0][lane] * d2[0][lane] + d2[1][lane] * d2[1][lane] + d2[2][lane] * d2[2][lane];
+			float const b = d1[0][lane] * d2[0][lane] + d1[1][lane] * d2[1][lane] + d1[2][lane] * d2[2][lane];
+			float const c = d1[0][lane] * rx + d1[1][lane] * ry + d1[2][lane] * rz;
+			float const f = d2[0][lane] * rx + d2[1][lane] * ry + d2[2][lane] * rz;
+			float const denominator = a * e - b * b;
+
+			// Closest points of the lines, then clamped to the segments (Ericson, Real-Time Collision Detection 5.1.9)
+			float const sLine = denominator > EPSILON ? clamp01((b * f - c * e) / denominator) : 0.0f;
+			float const tLine = e > EPSILON ? (b * sLine + f) / e : 0.0f;
+			float const tSegment = clamp01(tLine);
+			float const sClamped = a > EPSILON ? clamp01((b * tSegment - c) / a) : 0.0f;
+			s[lane] = tLine != tSegment ? sClamped : sLine;
+			t[lane] = tSegment;
+
+			float const dx = rx + d1[0][lane] * s[lane] - d2[0][lane] * t[lane];
+			float const dy = ry + d1[1][lane] * s[lane] - d2[1][lane] * t[lane];
+			float const dz = rz + d1[2][lane] * s[lane] - d2[2][lane] * t[lane];
+			dist2[lane] = dx * dx + dy * dy + dz * dz;
+		}
+
+		int best = 0;
+		for (int lane = 1; lane < 9; ++lane)
+		{
+			if (dist2[lane] < dist2[best])
+				best = lane;
+		}
+
+		distance2 = dist2[best];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			first[axis] = p0[axis][best] + d1[axis][best] * s[best];
+			second[axis] = q0[axis][best] + d2[axis][best] * t[best];
+		}
+		return best;
+	}
+
+	inline void corner(Triangle const & triangle, int i, float point[3])
+	{
+		point[0] = triangle.x[i];
+		point[1] = triangle.y[i];
+		point[2] = triangle.z[i];
+	}
+
+	inline float dot(float const a[3], float const b[3])
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	inline void cross(float const a[3], float const b[3], float out[3])
+	{
+		out[0] = a[1] * b[2] - a[2] * b[1];
+		out[1] = a[2] * b[0] - a[0] * b[2];
+		out[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	// True if 'point', taken in the plane of the triangle, lies inside it
+	bool inside(Triangle const & triangle, float const normal[3], float const point[3])
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			float a[3], b[3];
+			corner(triangle, i, a);
+			corner(triangle, (i + 1) % 3, b);
+			float const edge[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+			float const toPoint[3] = {point[0] - a[0], point[1] - a[1], point[2] - a[2]};
+			float side[3];
+			cross(edge, toPoint, side);
+			if (dot(side, normal) < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	// Vertices of 'p' facing the inside of 'q', and edges of 'p' crossing 'q'.  Updates the
+	//  distance and points when nearer; returns true on an intersection.
+	bool faceCases(Triangle const & p, Triangle const & q, float & distance2, float onP[3], float onQ[3])
+	{
+		float q0[3], q1[3], q2[3];
+		corner(q, 0, q0);
+		corner(q, 1, q1);
+		corner(q, 2, q2);
+		float const e0[3] = {q1[0] - q0[0], q1[1] - q0[1], q1[2] - q0[2]};
+		float const e1[3] = {q2[0] - q0[0], q2[1] - q0[1], q2[2] - q0[2]};
+		float normal[3];
+		cross(e0, e1, normal);
+		float const length2 = dot(normal, normal);
+		if (length2 <= EPSILON)
+			return false;
+
+		float height[3];
+		float vertices[3][3];
+		for (int i = 0; i < 3; ++i)
+		{
+			corner(p, i, vertices[i]);
+			float const offset[3] = {vertices[i][0] - q0[0], vertices[i][1] - q0[1], vertices[i][2] - q0[2]};
+			height[i] = dot(offset, normal);
+		}
+
+		for (int i = 0; i < 3; ++i)
+		{
+			// Edge crossing the plane, at a point inside the triangle
+			int const j = (i + 1) % 3;
+			if ((height[i] <= 0.0f) != (height[j] <= 0.0f) && height[i] != height[j])
+			{
+				float const u = height[i] / (height[i] - height[j]);
+				float const crossing[3] = {
+					vertices[i][0] + (vertices[j][0] - vertices[i][0]) * u,
+					vertices[i][1] + (vertices[j][1] - vertices[i][1]) * u,
+					vertices[i][2] + (vertices[j][2] - vertices[i][2]) * u};
+				if (inside(q, normal, crossing))
+				{
+					distance2 = 0.0f;
+					std::copy(crossing, crossing + 3, onP);
+					std::copy(crossing, crossing + 3, onQ);
+					return true;
+				}
+			}
+
+			// Vertex above the inside of the triangle
+			float const d2 = height[i] * height[i] / length2;
+			if (d2 < distance2)
+			{
+				float const scale = height[i] / length2;
+				float const foot[3] = {
+					vertices[i][0] - normal[0] * scale,
+					vertices[i][1] - normal[1] * scale,
+					vertices[i][2] - normal[2] * scale};
+				if (inside(q, normal, foot))
+				{
+					distance2 = d2;
+					std::copy(vertices[i], vertices[i] + 3, onP);
+					std::copy(foot, foot + 3, onQ);
+				}
+			}
+		}
+		return false;
+	}
+}
+
+BVH::Box Triangle::bounds() const
+{
+	BVH::Box box = BVH::Box::empty();
+	for (int c = 0; c < 3; ++c)
+	{
+		float const point[3] = {x[c], y[c], z[c]};
+		box.expand(point);
+	}
+	return box;
+}
+
+size_t appendTriangles(HPS::ShellKey const & shell, HPS::MatrixKit const & matrix, std::vector<Triangle> & triangles)
+{
+	HPS::PointArray points;
+	HPS::IntArray faceList;
+	shell.ShowPoints(points);
+	shell.ShowFacelist(faceList);
+	points = matrix.Transform(points);
+
+	size_t const before = triangles.size();
+	for (size_t f = 0; f < faceList.size(); )
+	{
+		int const count = abs(faceList[f]);
+		bool const hole = faceList[f] < 0;
+		if (f + 1 + count > faceList.size())
+			break;
+		int const * face = faceList.data() + f + 1;
+		f += count + 1;
+		if (hole)
+			continue;
+
+		for (int i = 2; i < count; ++i)
+		{
+			int const corners[3] = {face[0], face[i - 1], face[i]};
+			if ((size_t)corners[0] >= points.size() || (size_t)corners[1] >= points.size() || (size_t)corners[2] >= points.size())
+				continue;
+
+			Triangle triangle;
+			for (int c = 0; c < 3; ++c)
+			{
+				HPS::Point const & point = points[corners[c]];
+				triangle.x[c] = point.x;
+				triangle.y[c] = point.y;
+				triangle.z[c] = point.z;
+			}
+			triangles.push_back(triangle);
+		}
+	}
+	return triangles.size() - before;
+}
+
+float triangleDistance(Triangle const & p, Triangle const & q, float onP[3], float onQ[3])
+{
+	float distance2;
+	nearestEdges(p, q, distance2, onP, onQ);
+	if (distance2 == 0.0f)
+		return 0.0f;
+
+	if (faceCases(p, q, distance2, onP, onQ))
+		return 0.0f;
+	faceCases(q, p, distance2, onQ, onP);
+	return distance2;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "hps.h"
+#include "BVH.h"
+
+#include <vector>
+
+// Exact distances between triangles, for MinimumDistance and ClashDetector.
+//
+// Shells are fanned into world space triangles, and a pair of triangles is measured with a
+//  kernel testing their 9 edge pairs side by side, laid out so the compiler can vectorize it,
+//  plus the 6 vertex-face pairs and the edge-face intersections.
+
+// Corners stored by coordinate, so the kernel reads each coordinate of the three corners
+//  from contiguous memory
+struct Triangle
+{
+	float		x[3];
+	float		y[3];
+	float		z[3];
+
+	BVH::Box	bounds() const;
+};
+
+// Appends the faces of 'shell', fanned from their first point and taken to world space by
+//  'matrix'.  Holes and faces pointing past the points are skipped.  Returns the number of
+//  triangles appended.
+size_t appendTriangles(HPS::ShellKey const & shell, HPS::MatrixKit const & matrix, std::vector<Triangle> & triangles);
+
+// Squared distance between two triangles, and where it is reached on each
+float triangleDistance(Triangle const & p, Triangle const & q, float onP[3], float onQ[3]);
@@ -1,37 +1,51 @@
 #include "UserMobileSurface.h"
 #include "dprintf.h"
+#include "Trace.h"
+#include "SceneGenerator.h"
+#include "SelectionBuffer.h"
+#include "SelectionOperators.h"
+#include <float.h>
 #include <string>
-#include <map>
+#include <string.h>
+#include <unistd.h>
+#include <unordered_set>
 
-static std::map<int, UserMobileSurface *> g_surfaces;
+// Implemented by the gui
+void ShowClearance(SurfaceHandle surface, float distance);
 
-// Users must implement createMobileSurface() to return a pointer to their derived MobileSurface
-// Only one surface is created is created in the sandbox apps.
+// Time between two checks of the cancel request while an import runs, in microseconds
+static const useconds_t IMPORT_CANCEL_POLL = 10000;
+
+// Users must implement createMobileSurface() to return a new instance of their derived MobileSurface
 MobileSurface *createMobileSurface(int guiSurfaceId)
 {
-    if (g_surfaces.count(guiSurfaceId) == 0)
-    {
-        auto surface = new UserMobileSurface();
-        g_surfaces.insert(std::make_pair(guiSurfaceId, surface));
-        return surface;
-    }
-    
-    return g_surfaces[guiSurfaceId];
+    return new UserMobileSurface();
 }
 
 UserMobileSurface::UserMobileSurface()
-:  displayResourceMonitor(false), currentRenderingMode(HPS::Rendering::Mode::Default), frameRateEnabled(false)
+:  displayPerformanceHUD(false), currentRenderingMode(HPS::Rendering::Mode::Default), frameRateEnabled(false), preselection(spatialIndex),
+   clashDetector(spatialIndex, highlightStyles), snapper(spatialIndex), measurement(snapper), volumeQuery(spatialIndex)
 {
 }
 
 UserMobileSurface::~UserMobileSurface()
 {
+    // Selections may be using spatialIndex, which goes before the base class' service
+    GetSelectionService().detach();
 }
 
 bool UserMobileSurface::bind(void *window)
 {
     bool status = MobileSurface::bind(window);
     // Perform surface init code here.
+    if (status)
+    {
+        preselection.attach(GetCanvas());
+        highlightStyles.attach(GetCanvas());
+        measurement.attach(GetCanvas(), GetHandle());
+        volumeQuery.attach(GetCanvas());
+        GetSelectionService().setIndex(&spatialIndex, GetCanvas());
+    }
     return status;
 }
 
@@ -39,6 +53,17 @@ void UserMobileSurface::release(int flags)
 {
     if ((flags & SCREEN_ROTATING) == 0)
     {
+        performanceHUD.hide();
+        displayPerformanceHUD = false;
+        clashDetector.cancel();
+        minimumDistance.cancel();
+        measurement.detach();
+        snapper.clear();
+        volumeQuery.detach();
+        highlightStyles.detach();
+        preselection.detach();
+        spatialIndex.clear();
+        
         HPS::Canvas canvas = GetCanvas();
         HPS::Layout layout = canvas.GetAttachedLayout();
         if (layout.Type() != HPS::Type::None)
@@ -67,6 +92,11 @@ void UserMobileSurface::release(int flags)
     MobileSurface::release(flags);
 }
 
+void UserMobileSurface::onUpdateCompleted(HPS::Time updateTime, HPS::Window::UpdateStatus status)
+{
+    performanceHUD.recordFrame(updateTime, status);
+}
+
 void UserMobileSurface::singleTap(int x, int y)
 {
     MobileSurface::singleTap(x, y);
@@ -101,8 +131,25 @@ void UserMobileSurface::SetMainDistantLight(HPS::DistantLightKit const & light)
     mainDistantLight = GetCanvas().GetFrontView().GetSegmentKey().InsertDistantLight(light);
 }
 
+HPS::IOResult UserMobileSurface::waitForImport(HPS::IONotifier & notifier)
+{
+    // Cancelled when the surface is released, so the gui does not wait for the whole import
+    while (notifier.Status() == HPS::IOResult::InProgress)
+    {
+        if (actionsCancelled())
+        {
+            notifier.Cancel();
+            notifier.Wait();
+            break;
+        }
+        usleep(IMPORT_CANCEL_POLL);
+    }
+    return notifier.Status();
+}
+
 bool UserMobileSurface::importHSFFile(const char * filename, HPS::Model const & model, HPS::Stream::ImportResultsKit & importResults)
 {
+    TRACE_SCOPE("import", "importHSFFile");
     HPS::IOResult			status = HPS::IOResult::Failure;
     HPS::Stream::ImportNotifier     notifier;
     
@@ -117,9 +164,7 @@ bool UserMobileSurface::importHSFFile(const char * filename, HPS::Model const &
         
         // Initiate import and wait.  Import is done on a separate thread.
         notifier = HPS::Stream::File::Import(filename, ioOpts);
-        notifier.Wait();
-        
-        status = notifier.Status();
+        status = waitForImport(notifier);
     }
     catch (HPS::IOException const & ex)
     {
@@ -135,6 +180,7 @@ bool UserMobileSurface::importHSFFile(const char * filename, HPS::Model const &
 
 bool UserMobileSurface::importSTLFile(const char * filename, HPS::Model const & model)
 {
+    TRACE_SCOPE("import", "importSTLFile");
     HPS::IOResult			status = HPS::IOResult::Failure;
     
     HPS::STL::ImportNotifier notifier;
@@ -147,9 +193,7 @@ bool UserMobileSurface::importSTLFile(const char * filename, HPS::Model const &
         
         // Initiate import and wait.  Import is done on a separate thread.
         notifier = HPS::STL::File::Import(filename, ioOpts);
-        notifier.Wait();
-        
-        status = notifier.Status();
+        status = waitForImport(notifier);
     }
     catch (HPS::IOException const & ex)
     {
@@ -164,6 +208,7 @@ bool UserMobileSurface::importSTLFile(const char * filename, HPS::Model const &
 
 bool UserMobileSurface::importOBJFile(const char * filename, HPS::Model const & model)
 {
+    TRACE_SCOPE("import", "importOBJFile");
     HPS::IOResult			status = HPS::IOResult::Failure;
     
     HPS::OBJ::ImportNotifier notifier;
@@ -177,9 +222,7 @@ bool UserMobileSurface::importOBJFile(const char * filename, HPS::Model const &
         
         // Initiate import and wait.  Import is done on a separate thread.
         notifier = HPS::OBJ::File::Import(filename, ioOpts);
-        notifier.Wait();
-        
-        status = notifier.Status();
+        status = waitForImport(notifier);
     }
     catch (HPS::IOException const & ex)
     {
@@ -196,6 +239,7 @@ bool UserMobileSurface::importOBJFile(const char * filename, HPS::Model const &
 
 bool UserMobileSurface::importExchangeFile(const char * filename, HPS::Exchange::ImportOptionsKit ioOpts)
 {
+    TRACE_SCOPE("import", "importExchangeFile");
     HPS::IOResult			status = HPS::IOResult::Failure;
     
     HPS::Exchange::ImportNotifier notifier;
@@ -210,9 +254,7 @@ bool UserMobileSurface::importExchangeFile(const char * filename, HPS::Exchange:
         
         // Initiate import and wait.  Import is done on a separate thread.
         notifier = HPS::Exchange::File::Import(filename, ioOpts);
-        notifier.Wait();
-        
-        status = notifier.Status();
+        status = waitForImport(notifier);
         
         if (status == HPS::IOResult::Success)
         {
@@ -233,6 +275,7 @@ bool UserMobileSurface::importExchangeFile(const char * filename, HPS::Exchange:
 
 bool UserMobileSurface::loadFile(const char* fileName)
 {
+    TRACE_SCOPE("import", "loadFile");
     std::string fileNameStr(fileName);
     size_t loc = fileNameStr.find_last_of(".");
     if (loc == std::string::npos)
@@ -241,6 +284,10 @@ bool UserMobileSurface::loadFile(const char* fileName)
     std::string extension = fileNameStr.substr(loc + 1,fileNameStr.size() - (loc + 1));
     std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
     
+    // Phase timings shown by the performance HUD
+    performanceHUD.clearImportTimings();
+    HPS::Time phaseStart = HPS::Database::GetTime();
+    
     bool fit_world = false;
     if (extension == "hsf")
     {
@@ -306,6 +353,54 @@ bool UserMobileSurface::loadFile(const char* fileName)
     else
         return false;
     
+    HPS::Time now = HPS::Database::GetTime();
+    performanceHUD.addImportTiming("import", now - phaseStart);
+    
+    setupLoadedScene(fit_world);
+    
+    return true;
+}
+
+bool UserMobileSurface::generateScene(int segmentCount, int shellCount, int triangleCount, float instanceRatio, int materialCount, float dispersion, int seed)
+{
+    if (segmentCount <= 0 || shellCount <= 0 || triangleCount <= 0)
+        return false;
+    
+    performanceHUD.clearImportTimings();
+    
+    SceneGenerator::Options options;
+    options.segmentCount = (unsigned int)segmentCount;
+    options.shellCount = (unsigned int)shellCount;
+    options.triangleCount = (size_t)triangleCount;
+    options.instanceRatio = instanceRatio;
+    options.materialCount = materialCount > 0 ? (unsigned int)materialCount : 0;
+    options.dispersion = dispersion;
+    options.seed = (uint32_t)seed;
+    
+    HPS::View view = HPS::Factory::CreateView();
+    HPS::Model model = HPS::Factory::CreateModel();
+    SceneGenerator::Statistics stats = SceneGenerator::generate(model, options, &actionsCancelled());
+    if (actionsCancelled())
+    {
+        view.Delete();
+        model.Delete();
+        return false;
+    }
+    
+    view.AttachModel(model);
+    GetCanvas().AttachViewAsLayout(view);
+    
+    performanceHUD.addImportTiming("generate", stats.buildTime);
+    
+    setupLoadedScene(true);
+    
+    return true;
+}
+
+void UserMobileSurface::setupLoadedScene(bool fit_world)
+{
+    HPS::Time phaseStart = HPS::Database::GetTime();
+    
     HPS::View view = GetCanvas().GetFrontView();
     HPS::Model model = view.GetAttachedModel();
     
@@ -321,9 +416,27 @@ bool UserMobileSurface::loadFile(const char* fileName)
     // Add a distant light
     SetMainDistantLight();
     
+    // Index the shells on a worker while the first update draws
+    clashDetector.cancel();
+    minimumDistance.cancel();
+    measurement.clear();
+    snapper.clear();
+    volumeQuery.showAll();
+    volumeQuery.clear();
+    spatialIndex.rebuild(model);
+    
+    HPS::Time now = HPS::Database::GetTime();
+    performanceHUD.addImportTiming("scene setup", now - phaseStart);
+    phaseStart = now;
+    
+    // Nothing to wait for when the surface is being released
+    if (actionsCancelled())
+        return;
+    
+    TRACE_SCOPE("update", "loadFile::Wait");
     GetCanvas().UpdateWithNotifier().Wait();
     
-    return true;
+    performanceHUD.addImportTiming("first update", HPS::Database::GetTime() - phaseStart);
 }
 
 void UserMobileSurface::setOperatorOrbit()
@@ -347,13 +460,87 @@ void UserMobileSurface::setOperatorFly()
 void UserMobileSurface::setOperatorSelectPoint()
 {
     GetCanvas().GetFrontView().GetOperatorControl().Pop();
-    GetCanvas().GetFrontView().GetOperatorControl().Push(new HPS::HighlightOperator());
+    GetCanvas().GetFrontView().GetOperatorControl().Push(new AsyncHighlightOperator(GetSelectionService()));
 }
 
 void UserMobileSurface::setOperatorSelectArea()
 {
     GetCanvas().GetFrontView().GetOperatorControl().Pop();
-    GetCanvas().GetFrontView().GetOperatorControl().Push(new HPS::HighlightAreaOperator());
+    GetCanvas().GetFrontView().GetOperatorControl().Push(new AsyncHighlightAreaOperator(GetSelectionService()));
+}
+
+void UserMobileSurface::setOperatorSelectLasso()
+{
+    GetCanvas().GetFrontView().GetOperatorControl().Pop();
+    GetCanvas().GetFrontView().GetOperatorControl().Push(new LassoOperator(GetSelectionService()));
+}
+
+void UserMobileSurface::setOperatorPreselect()
+{
+    GetCanvas().GetFrontView().GetOperatorControl().Pop();
+    GetCanvas().GetFrontView().GetOperatorControl().Push(new PreselectOperator(preselection));
+}
+
+void UserMobileSurface::setOperatorMeasure(int mode)
+{
+    if (mode < 0 || mode >= Measurement::ModeCount)
+        return;
+    
+    measurement.setMode((Measurement::Mode)mode);
+    GetCanvas().GetFrontView().GetOperatorControl().Pop();
+    GetCanvas().GetFrontView().GetOperatorControl().Push(new MeasureOperator(measurement));
+}
+
+void UserMobileSurface::clearMeasurements()
+{
+    measurement.clear();
+    requestUpdate();
+}
+
+bool UserMobileSurface::measureSelectionClearance()
+{
+    TRACE_SCOPE("measure", "measureSelectionClearance");
+    
+    std::vector<SpatialIndex::Instance> components[2];
+    size_t count = 0;
+    HPS::SelectionResults selection = GetSelectionService().activeSelection();
+    for (HPS::SelectionResultsIterator it = selection.GetIterator(); it.IsValid() && count < 2; it.Next())
+    {
+        // Selection paths may start above the selected key
+        HPS::Key selected;
+        HPS::KeyPath path;
+        HPS::KeyArray keys;
+        if (!it.GetItem().ShowSelectedItem(selected) || !it.GetItem().ShowPath(path) || !path.ShowKeys(keys))
+            continue;
+        if (keys.empty() || !(keys.front() == selected))
+        {
+            HPS::KeyPath full;
+            full.Append(selected).Append(path);
+            path = full;
+        }
+        
+        if (spatialIndex.instancesUnder(path, components[count]) > 0)
+            ++count;
+    }
+    if (count < 2)
+        return false;
+    
+    HPS::Canvas canvas = GetCanvas();
+    SurfaceHandle handle = GetHandle();
+    minimumDistance.start(components[0], components[1], FLT_MAX, [this, canvas, handle](bool found, MinimumDistance::Result const & result) {
+        if (found)
+        {
+            measurement.showDistance(result.points[0], result.points[1], result.distance);
+            HPS::Canvas(canvas).Update();
+        }
+        ShowClearance(handle, found ? result.distance : -1.0f);
+    });
+    return true;
+}
+
+void UserMobileSurface::cancelClearance()
+{
+    minimumDistance.cancel();
 }
 
 void UserMobileSurface::onModeSimpleShadow(bool enable)
@@ -379,7 +566,7 @@ void UserMobileSurface::onModeSimpleShadow(bool enable)
     }
     
     GetCanvas().GetFrontView().SetSimpleShadow(enable);
-    GetCanvas().Update();
+    requestUpdate();
 }
 
 void UserMobileSurface::onModeSmooth()
@@ -394,7 +581,7 @@ void UserMobileSurface::onModeSmooth()
         currentRenderingMode = HPS::Rendering::Mode::Phong;
     
     GetCanvas().GetFrontView().SetRenderingMode(currentRenderingMode);
-    GetCanvas().Update();
+    requestUpdate();
 }
 
 void UserMobileSurface::onModeHiddenLine()
@@ -418,7 +605,7 @@ void UserMobileSurface::onModeHiddenLine()
     }
     
     GetCanvas().GetFrontView().SetRenderingMode(currentRenderingMode);
-    GetCanvas().Update();
+    requestUpdate();
 }
 
 void UserMobileSurface::onModeFrameRate()
@@ -445,7 +632,218 @@ void UserMobileSurface::onModeFrameRate()
     else
         GetCanvas().SetFrameRate(0);
     
-    GetCanvas().Update();
+    requestUpdate();
+}
+
+void UserMobileSurface::onModePerformanceHUD()
+{
+    if (!isValid())
+        return;
+    
+    // Toggle the performance HUD overlay
+    displayPerformanceHUD = !displayPerformanceHUD;
+    
+    if (displayPerformanceHUD)
+        performanceHUD.show(GetCanvas(), &GetLatencyMonitor());
+    else
+        performanceHUD.hide();
+}
+
+int UserMobileSurface::getSelection(DirectBuffer buffer)
+{
+    SelectionBuffer::ComponentResolver component;
+#ifdef USING_EXCHANGE
+    if (activeCADModel.Type() != HPS::Type::None)
+    {
+        // Leaf component of the item (component paths are ordered leaf first)
+        component = [this](HPS::SelectionItem const & item) -> int64_t {
+            HPS::ComponentArray const components = activeCADModel.GetComponentPath(item).GetComponents();
+            return components.empty() ? 0 : (int64_t)components.front().GetInstanceID();
+        };
+    }
+#endif
+    return SelectionBuffer::write(GetSelectionService().activeSelection(), buffer.data, buffer.size, component);
+}
+
+size_t UserMobileSurface::applyHighlights(HighlightBatch const & batch)
+{
+    size_t const calls = batch.apply(highlightStyles, GetCanvas());
+    if (!batch.isEmpty())
+        requestUpdate();
+    return calls;
+}
+
+int UserMobileSurface::highlightSegmentsNamed(const char *name, int style)
+{
+    TRACE_SCOPE("selection", "highlightSegmentsNamed");
+    HPS::Model model = GetCanvas().GetFrontView().GetAttachedModel();
+    if (model.Type() == HPS::Type::None || !HighlightStyles::isValid(style))
+        return 0;
+    
+    HPS::SearchResults segments;
+    size_t found = model.GetSegmentKey().Find(HPS::Search::Type::Segment, HPS::Search::Space::SubsegmentsAndIncludes, segments);
+    
+    std::unordered_set<HPS::Key, HPS::KeyHasher> matches;
+    for (HPS::SearchResultsIterator it = segments.GetIterator(); it.IsValid(); it.Next())
+    {
+        HPS::SegmentKey segment(it.GetItem());
+        if (strstr(segment.Name().GetBytes(), name) != nullptr)
+            matches.insert(segment);
+    }
+    
+    // A search cannot select by name, so the results go in whole only when every segment matches.
+    //  Otherwise a segment's highlight covers its subsegments: only the topmost matches are added.
+    HighlightBatch batch;
+    if (matches.size() == found)
+        batch.add(style, segments);
+    else
+    {
+        for (auto const & match : matches)
+        {
+            bool covered = false;
+            for (HPS::SegmentKey owner = HPS::SegmentKey(match).Owner(); !covered && owner.Type() != HPS::Type::None; owner = owner.Owner())
+                covered = matches.count(owner) != 0;
+            if (!covered)
+                batch.add(style, match);
+        }
+    }
+    
+    applyHighlights(batch);
+    return (int)matches.size();
+}
+
+void UserMobileSurface::unhighlightStyle(int style)
+{
+    HighlightBatch batch;
+    batch.clear(style);
+    applyHighlights(batch);
+}
+
+void UserMobileSurface::unhighlightAll()
+{
+    HighlightBatch batch;
+    batch.clearAll();
+    applyHighlights(batch);
+}
+
+void UserMobileSurface::setHighlightColor(int style, float r, float g, float b)
+{
+    highlightStyles.setColor(style, HPS::RGBAColor(r, g, b));
+    requestUpdate();
+}
+
+int UserMobileSurface::detectClashes(const char *groupA, const char *groupB, float tolerance, int style)
+{
+    TRACE_SCOPE("clash", "detectClashes");
+    int pairs = clashDetector.start(GetCanvas(), GetHandle(), groupA, groupB, tolerance, style);
+    if (pairs >= 0)
+        requestUpdate();
+    return pairs;
+}
+
+void UserMobileSurface::cancelClashes()
+{
+    clashDetector.cancel();
+}
+
+int UserMobileSurface::queryBox(float minX, float minY, float minZ, float maxX, float maxY, float maxZ, bool contained, bool exact)
+{
+    return volumeQuery.box(HPS::Point(minX, minY, minZ), HPS::Point(maxX, maxY, maxZ), contained, exact);
+}
+
+int UserMobileSurface::queryWindowFrustum(float left, float bottom, float right, float top, bool contained)
+{
+    return volumeQuery.frustum(HPS::WindowPoint(left, bottom, 0), HPS::WindowPoint(right, top, 0), contained);
+}
+
+int UserMobileSurface::getVolumeSet(DirectBuffer buffer)
+{
+    VolumeQuery::ComponentResolver component;
+#ifdef USING_EXCHANGE
+    if (activeCADModel.Type() != HPS::Type::None)
+    {
+        component = [this](HPS::KeyPath const & path) -> int64_t {
+            HPS::ComponentArray const components = activeCADModel.GetComponentPath(path).GetComponents();
+            return components.empty() ? 0 : (int64_t)components.front().GetInstanceID();
+        };
+    }
+#endif
+    return volumeQuery.write(buffer.data, buffer.size, component);
+}
+
+int UserMobileSurface::hideOutsideVolumeSet()
+{
+    int hidden = (int)volumeQuery.hideOutside();
+    requestUpdate();
+    return hidden;
+}
+
+void UserMobileSurface::showAllItems()
+{
+    volumeQuery.showAll();
+    requestUpdate();
+}
+
+int UserMobileSurface::highlightVolumeSet(int style)
+{
+    if (!HighlightStyles::isValid(style))
+        return 0;
+    
+    HighlightBatch batch;
+    volumeQuery.addTo(batch, style);
+    applyHighlights(batch);
+    return (int)volumeQuery.size();
+}
+
+int UserMobileSurface::getTouchLatency(const char *operatorName, float stats[LatencyMonitor::StatCount])
+{
+    return GetLatencyMonitor().show(operatorName, stats);
+}
+
+void UserMobileSurface::resetTouchLatency()
+{
+    GetLatencyMonitor().reset();
+}
+
+int UserMobileSurface::getSelectionLatency(float stats[LatencyMonitor::StatCount])
+{
+    return GetSelectionService().showLatency(stats);
+}
+
+void UserMobileSurface::resetSelectionLatency()
+{
+    GetSelectionService().resetLatency();
+}
+
+void UserMobileSurface::startTouchRecording()
+{
+    beginTouchRecording();
+}
+
+bool UserMobileSurface::stopTouchRecording(const char *fileName)
+{
+    return endTouchRecording(fileName);
+}
+
+bool UserMobileSurface::replayTouches(const char *fileName, bool realTime)
+{
+    // Keep the HUD from redrawing during the replay: its own updates would be counted as frames
+    bool const hudVisible = performanceHUD.isVisible();
+    if (hudVisible)
+        performanceHUD.hide();
+    
+    bool const status = replayTouchRecording(fileName, realTime);
+    
+    if (hudVisible)
+        performanceHUD.show(GetCanvas(), &GetLatencyMonitor());
+    
+    return status;
+}
+
+int UserMobileSurface::getReplayStats(float stats[TouchRecording::ReplayStatCount])
+{
+    showReplayStats(stats);
+    return TouchRecording::ReplayStatCount;
 }
 
 void UserMobileSurface::onUserCode1()
@@ -1,8 +1,20 @@
 #pragma once
 
 #include "MobileSurface.h"
+#include "PerformanceHUD.h"
+#include "DirectBuffer.h"
+#include "SpatialIndex.h"
+#include "Preselection.h"
+#include "HighlightStyles.h"
+#include "ClashDetector.h"
+#include "Snapper.h"
+#include "Measurement.h"
+#include "MinimumDistance.h"
+#include "VolumeQuery.h"
 
 #define SURFACE_ACTION
+#define SURFACE_ACTION_CRITICAL
+#define SURFACE_ACTION_ASYNC
 
 // UserMobileSurface is a plaform-independent class which contains user-defined
 // action methods called by Android/iOS gui code.  This class (along with MobileApp)
@@ -38,6 +50,22 @@
 //   - long long []       -> long[]
 //   - float []           -> float[]
 //   - double []          -> double[]
+//   Arrays declared const (e.g. const float points[]) are input only: Java never gets a copy back.
+//   Arrays declared with a size (e.g. float stats[LatencyMonitor::StatCount]) are checked first:
+//   a shorter or null Java array returns -1 (0 for bool and char, nothing for void) without
+//   calling the method.
+//
+// Valid buffers (used in place, never copied):
+//   - DirectBuffer       -> java.nio.ByteBuffer (must be allocated with allocateDirect)
+//
+// Short, hot calls, such as getters reading state kept under a lock of its own, can be declared
+// SURFACE_ACTION_CRITICAL instead: they run on the calling thread rather than queuing behind a
+// long action on the action executor, with their arrays pinned by GetPrimitiveArrayCritical,
+// which avoids any copy.  Such a method must return quickly and must not call back into Java,
+// change the scene or wait on another thread.
+//
+// Long actions which must never block the gui can be declared SURFACE_ACTION_ASYNC instead: they
+// only get the <name>Async variant described below, which runs them on the action executor.
 //
 // Valid return values:
 //   - void               -> void
@@ -50,6 +78,14 @@
 //
 // Notes:
 //   - SURFACE_ACTION methods should be declared on a single line
+//   - void methods taking only input parameters (no arrays) can also be recorded in an
+//     AndroidUserMobileSurfaceView.CommandBuffer and run in a single JNI call by execute().
+//     Use requestUpdate() rather than Canvas::Update() so a batch is only drawn once.
+//   - Methods taking only input parameters (scalars, strings and const arrays) also get a
+//     <name>Async variant.  It copies its arguments, queues the action on a native thread
+//     which runs them one at a time, and returns a request id straight away.  The result is
+//     delivered as a double to AndroidMobileSurfaceView.Callback.onActionCompleted(), so
+//     long long results beyond 2^53 lose precision.
 //
 // Examples:
 //
@@ -75,36 +111,139 @@ public:
     
     SURFACE_ACTION bool		loadFile(const char *fileName);
     
+    // Replaces the model with a synthetic scene for scaling benchmarks (see SceneGenerator.h)
+    SURFACE_ACTION bool		generateScene(int segmentCount, int shellCount, int triangleCount, float instanceRatio, int materialCount, float dispersion, int seed);
+    
     SURFACE_ACTION void		setOperatorOrbit();
     SURFACE_ACTION void		setOperatorZoomArea();
     SURFACE_ACTION void		setOperatorFly();
 
     SURFACE_ACTION void		setOperatorSelectPoint();
     SURFACE_ACTION void		setOperatorSelectArea();
+    SURFACE_ACTION void		setOperatorSelectLasso();
+    SURFACE_ACTION void		setOperatorPreselect();
+    
+    // Measures with snapped picks; mode is a Measurement::Mode
+    SURFACE_ACTION void		setOperatorMeasure(int mode);
+    SURFACE_ACTION void		clearMeasurements();
+    
+    // Minimum distance between the first two items of the latest selection (shells, or the
+    // segments of whole parts), computed on a worker and drawn as a measurement.  The result goes
+    // to onClearanceCompleted().  Returns false if fewer than two indexed items are selected.
+    SURFACE_ACTION bool		measureSelectionClearance();
+    SURFACE_ACTION void		cancelClearance();
     
     SURFACE_ACTION void		onModeSimpleShadow(bool enable);
     SURFACE_ACTION void		onModeSmooth();
     SURFACE_ACTION void		onModeHiddenLine();
     SURFACE_ACTION void		onModeFrameRate();
+    SURFACE_ACTION void		onModePerformanceHUD();
+    
+    // Writes the results of the latest selection (point, area or lasso) into 'buffer', laid out as
+    // described in SelectionBuffer.h.  Returns the number of items written, -1 if the buffer is too small.
+    SURFACE_ACTION int		getSelection(DirectBuffer buffer);
+    
+    // Highlights in bulk with the pooled styles, then requests a single update.
+    // Returns the number of highlight calls made.
+    size_t					applyHighlights(HighlightBatch const & batch);
+    
+    // Highlights every model segment whose name contains 'name' (e.g. an IFC type) with one of the
+    // HighlightStyles::STYLE_COUNT pooled styles.  Returns the number of segments highlighted.
+    SURFACE_ACTION int		highlightSegmentsNamed(const char *name, int style);
+    SURFACE_ACTION void		unhighlightStyle(int style);
+    SURFACE_ACTION void		unhighlightAll();
+    SURFACE_ACTION void		setHighlightColor(int style, float r, float g, float b);
+    
+    // Starts a clash detection between the shells under segments whose name contains groupA and
+    // those under segments whose name contains groupB (empty for all shells), highlighting the
+    // clashing pairs with 'style' as they are found.  Progress goes to onClashProgress().
+    // Returns the number of candidate pairs, -1 if the model is not indexed yet.
+    SURFACE_ACTION int		detectClashes(const char *groupA, const char *groupB, float tolerance, int style);
+    SURFACE_ACTION void		cancelClashes();
+    
+    // Replaces the volume set with the items in a world space box, or in what the view shows
+    // inside a window rectangle: those entirely inside when 'contained', otherwise those touching
+    // it.  'exact' checks the geometry of items on the box's boundary; frustums go by boxes only.
+    // Returns the size of the set, -1 if the model is not indexed yet.
+    SURFACE_ACTION int		queryBox(float minX, float minY, float minZ, float maxX, float maxY, float maxZ, bool contained, bool exact);
+    SURFACE_ACTION int		queryWindowFrustum(float left, float bottom, float right, float top, bool contained);
+    
+    // Writes the volume set into 'buffer', laid out as described in VolumeQuery.h.  Returns the
+    // number of items written, -1 if the buffer is too small.
+    SURFACE_ACTION int		getVolumeSet(DirectBuffer buffer);
+    
+    // Hides every item outside the volume set, until showAllItems().  Returns the number hidden.
+    SURFACE_ACTION int		hideOutsideVolumeSet();
+    SURFACE_ACTION void		showAllItems();
+    
+    // Highlights the volume set with one of the pooled styles.  Returns the number of items.
+    SURFACE_ACTION int		highlightVolumeSet(int style);
+    
+    // Touch-to-photon latency for one operator (e.g. "PanOrbitZoomOperator").
+    // stats receives LatencyMonitor::StatCount values in ms: count, mean, p50, p90, p99, max.
+    // Returns -1 if stats is shorter.
+    SURFACE_ACTION_CRITICAL int		getTouchLatency(const char *operatorName, float stats[LatencyMonitor::StatCount]);
+    SURFACE_ACTION void		resetTouchLatency();
+    
+    // Request-to-highlight latency of the last SelectionService::LATENCY_SAMPLES selections,
+    // in the same layout as getTouchLatency().  Returns -1 if stats is shorter.
+    SURFACE_ACTION_CRITICAL int		getSelectionLatency(float stats[LatencyMonitor::StatCount]);
+    SURFACE_ACTION void		resetSelectionLatency();
+    
+    // Touch stream recording and replay, for benchmarks on identical interactions.
+    // A replay only runs on the action executor: replayTouchesAsync() reports whether every event was
+    // replayed.  Then getReplayStats() fills stats with TouchRecording::ReplayStatCount values: events,
+    // frames, duration, mean/p50/p95/max frame ms, fps.  It returns -1 if stats is shorter.
+    SURFACE_ACTION void		startTouchRecording();
+    SURFACE_ACTION bool		stopTouchRecording(const char *fileName);
+    SURFACE_ACTION_ASYNC bool	replayTouches(const char *fileName, bool realTime);
+    SURFACE_ACTION_CRITICAL int		getReplayStats(float stats[TouchRecording::ReplayStatCount]);
     
     SURFACE_ACTION void		onUserCode1();
     SURFACE_ACTION void		onUserCode2();
     SURFACE_ACTION void		onUserCode3();
     SURFACE_ACTION void		onUserCode4();
     
+protected:
+    virtual void			onUpdateCompleted(HPS::Time updateTime, HPS::Window::UpdateStatus status);
+    
 private:
     
 #ifdef USING_EXCHANGE
     HPS::CADModel           activeCADModel;
 #endif
-    // User code 1 test
-    bool					displayResourceMonitor;
+    // Performance HUD overlay
+    bool					displayPerformanceHUD;
+    PerformanceHUD			performanceHUD;
     
     HPS::DistantLightKey	mainDistantLight;
     HPS::Rendering::Mode	currentRenderingMode;
     bool                    frameRateEnabled;
     
+    // Bounding boxes of the loaded model's shells, for picks and proximity queries
+    SpatialIndex			spatialIndex;
+    
+    // Item under the finger, highlighted by setOperatorPreselect(); uses spatialIndex
+    Preselection			preselection;
+    
+    HighlightStyles			highlightStyles;
+    
+    // Runs detectClashes(); uses spatialIndex and highlightStyles
+    ClashDetector			clashDetector;
+    
+    // Snaps and measurements of setOperatorMeasure(); use spatialIndex
+    Snapper					snapper;
+    Measurement				measurement;
+    
+    // Runs measureSelectionClearance(); reports to measurement, so is declared after it
+    MinimumDistance			minimumDistance;
+    
+    // Set of queryBox() and queryWindowFrustum(); uses spatialIndex
+    VolumeQuery				volumeQuery;
+    
+    void					setupLoadedScene(bool fit_world);
     void 					loadCamera(HPS::View & view, HPS::Stream::ImportResultsKit const & results);
+    HPS::IOResult waitForImport(HPS::IONotifier & notifier);
     bool importHSFFile(const char * filename, HPS::Model const & model, HPS::Stream::ImportResultsKit &);
     bool importSTLFile(const char * filename, HPS::Model const & model);
     bool importOBJFile(const char * filename, HPS::Model const & model);
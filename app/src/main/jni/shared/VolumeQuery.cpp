@@ -0,0 +1,305 @@
+#include "VolumeQuery.h"
+#include "HighlightStyles.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+const char * const VolumeQuery::HIDDEN_STYLE_NAME = "volumeHidden";
+
+namespace
+{
+	// Instance ids of a shell and of the includes leading to it, innermost first
+	typedef std::vector<intptr_t>	Identity;
+
+	struct IdentityHasher
+	{
+		size_t operator()(Identity const & identity) const
+		{
+			size_t hash = 0;
+			for (intptr_t id : identity)
+				hash = hash * 31 + std::hash<intptr_t>()(id);
+			return hash;
+		}
+	};
+
+	typedef std::unordered_set<Identity, IdentityHasher>	IdentitySet;
+
+	Identity identity(SpatialIndex::Item const & item)
+	{
+		Identity result(1, item.shell.GetInstanceID());
+		for (auto const & include : item.includes)
+			result.push_back(include.GetInstanceID());
+		return result;
+	}
+
+	// Identity of the item selected through 'keys', from the selected shell up to the window:
+	//  the shell, then the includes met before reaching the model's root segment
+	Identity selectedIdentity(HPS::KeyArray const & keys, HPS::SegmentKey const & root)
+	{
+		Identity result(1, keys.front().GetInstanceID());
+		for (size_t i = 1; i < keys.size() && !(keys[i] == root); ++i)
+		{
+			if (keys[i].Type() == HPS::Type::IncludeKey)
+				result.push_back(keys[i].GetInstanceID());
+		}
+		return result;
+	}
+}
+
+VolumeQuery::VolumeQuery(SpatialIndex const & index)
+	: _index(index)
+{
+}
+
+VolumeQuery::~VolumeQuery()
+{
+	detach();
+}
+
+void VolumeQuery::attach(HPS::Canvas const & canvas)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// bind() calls this again after each rotation
+	if (_canvas.Type() != HPS::Type::None)
+		return;
+
+	_canvas = canvas;
+
+	_style = HPS::Database::CreateRootSegment();
+	_style.GetVisibilityControl().SetEverything(false);
+
+	_portfolio = HPS::Database::CreatePortfolio();
+	_portfolio.DefineNamedStyle(HIDDEN_STYLE_NAME, _style);
+	_canvas.GetWindowKey().GetPortfolioControl().Push(_portfolio);
+}
+
+void VolumeQuery::detach()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_canvas.Type() == HPS::Type::None)
+		return;
+
+	_canvas.GetWindowKey().GetHighlightControl().Unhighlight(hiddenOptions());
+
+	HPS::PortfolioControl portfolios = _canvas.GetWindowKey().GetPortfolioControl();
+	HPS::PortfolioKeyArray inUse;
+	portfolios.Show(inUse);
+	inUse.erase(std::remove(inUse.begin(), inUse.end(), _portfolio), inUse.end());
+	if (inUse.empty())
+		portfolios.UnsetEverything();
+	else
+		portfolios.Set(inUse);
+	_portfolio.Delete();
+	_style.Delete();
+	_canvas = HPS::Canvas();
+	_items.clear();
+}
+
+int VolumeQuery::box(HPS::Point const & min, HPS::Point const & max, bool contained, bool exact)
+{
+	TRACE_SCOPE("index", "VolumeQuery::box");
+	if (!_index.isReady())
+		return -1;
+
+	std::vector<float> planes;
+	SpatialIndex::boxPlanes(min, max, planes);
+
+	std::vector<SpatialIndex::Item> inside, crossing;
+	_index.volume(planes, inside, crossing);
+
+	// Boxes inside a box hold geometry inside it; the others only may touch it
+	if (contained || !exact || crossing.empty())
+		return assign(inside, crossing, !contained);
+
+	HPS::Canvas canvas;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		canvas = _canvas;
+	}
+	HPS::Model model = canvas.Type() != HPS::Type::None ? canvas.GetFrontView().GetAttachedModel() : HPS::Model();
+	if (model.Type() == HPS::Type::None)
+		return assign(inside, crossing, true);
+
+	HPS::KeyPath scope;
+	scope.Append(model.GetSegmentKey()).Append(SpatialIndex::viewPath(canvas));
+
+	HPS::SelectionOptionsKit options = HPS::SelectionOptionsKit::GetDefault();
+	options.SetLevel(HPS::Selection::Level::Entity)
+		.SetRelatedLimit(_index.itemCount())
+		.SetSorting(false)
+		.SetScope(scope);
+
+	HPS::SelectionResults results;
+	canvas.GetWindowKey().GetSelectionControl().SelectByVolume(HPS::SimpleCuboid(min, max), options, results);
+
+	// Selection paths may start above the selected key
+	IdentitySet touching;
+	HPS::KeyArray keys;
+	for (HPS::SelectionResultsIterator it = results.GetIterator(); it.IsValid(); it.Next())
+	{
+		HPS::Key selected;
+		HPS::KeyPath path;
+		keys.clear();
+		if (!it.GetItem().ShowSelectedItem(selected) || !it.GetItem().ShowPath(path) || !path.ShowKeys(keys))
+			continue;
+		if (keys.empty() || !(keys.front() == selected))
+			keys.insert(keys.begin(), selected);
+		touching.insert(selectedIdentity(keys, model.GetSegmentKey()));
+	}
+
+	crossing.erase(std::remove_if(crossing.begin(), crossing.end(), [&touching](SpatialIndex::Item const & item) {
+		return touching.count(identity(item)) == 0;
+	}), crossing.end());
+	return assign(inside, crossing, true);
+}
+
+int VolumeQuery::frustum(HPS::WindowPoint const & min, HPS::WindowPoint const & max, bool contained)
+{
+	TRACE_SCOPE("index", "VolumeQuery::frustum");
+	if (!_index.isReady())
+		return -1;
+
+	HPS::Canvas canvas;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		canvas = _canvas;
+	}
+
+	std::vector<float> planes;
+	if (canvas.Type() == HPS::Type::None || !SpatialIndex::frustumPlanes(canvas, min, max, planes))
+		return -1;
+
+	std::vector<SpatialIndex::Item> inside, crossing;
+	_index.volume(planes, inside, crossing);
+	return assign(inside, crossing, !contained);
+}
+
+int VolumeQuery::assign(std::vector<SpatialIndex::Item> & inside, std::vector<SpatialIndex::Item> & crossing, bool keepCrossing)
+{
+	if (keepCrossing)
+		inside.insert(inside.end(), crossing.begin(), crossing.end());
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_items.swap(inside);
+	return (int)_items.size();
+}
+
+void VolumeQuery::clear()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_items.clear();
+}
+
+size_t VolumeQuery::size() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _items.size();
+}
+
+HPS::HighlightOptionsKit VolumeQuery::hiddenOptions() const
+{
+	// Thousands of highlights at once: no event for each of them
+	HPS::HighlightOptionsKit options(HIDDEN_STYLE_NAME);
+	options.SetNotification(false);
+	return options;
+}
+
+size_t VolumeQuery::hideOutside()
+{
+	TRACE_SCOPE("index", "VolumeQuery::hideOutside");
+	HPS::Canvas canvas;
+	IdentitySet kept;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_canvas.Type() == HPS::Type::None)
+			return 0;
+
+		canvas = _canvas;
+		kept.reserve(_items.size());
+		for (auto const & item : _items)
+			kept.insert(identity(item));
+	}
+
+	// Whole segments outside the set are hidden with one highlight each
+	size_t hidden = 0;
+	std::vector<HPS::KeyPath> paths;
+	_index.coveringPaths([&kept, &hidden](SpatialIndex::Item const & item) {
+		bool const outside = kept.count(identity(item)) == 0;
+		if (outside)
+			++hidden;
+		return outside;
+	}, canvas, paths);
+
+	// Still attached: detach() removes the style the highlights use
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_canvas != canvas)
+		return 0;
+
+	HPS::HighlightOptionsKit const options = hiddenOptions();
+	HPS::HighlightControl highlight = _canvas.GetWindowKey().GetHighlightControl();
+	highlight.Unhighlight(options);
+	for (auto const & path : paths)
+		highlight.Highlight(path, options);
+	return hidden;
+}
+
+void VolumeQuery::showAll()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_canvas.Type() != HPS::Type::None)
+		_canvas.GetWindowKey().GetHighlightControl().Unhighlight(hiddenOptions());
+}
+
+void VolumeQuery::addTo(HighlightBatch & batch, int style) const
+{
+	HPS::Canvas canvas;
+	IdentitySet selected;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_canvas.Type() == HPS::Type::None)
+			return;
+
+		canvas = _canvas;
+		selected.reserve(_items.size());
+		for (auto const & item : _items)
+			selected.insert(identity(item));
+	}
+
+	// Segments whose every shell is in the set take one highlight
+	std::vector<HPS::KeyPath> paths;
+	_index.coveringPaths([&selected](SpatialIndex::Item const & item) {
+		return selected.count(identity(item)) != 0;
+	}, canvas, paths);
+	for (auto const & path : paths)
+		batch.add(style, path);
+}
+
+int VolumeQuery::write(void * memory, size_t size, ComponentResolver const & component) const
+{
+	if (memory == nullptr || size < sizeof(VolumeBufferHeader))
+		return -1;
+
+	TRACE_SCOPE("index", "VolumeQuery::write");
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	VolumeBufferHeader * const header = static_cast<VolumeBufferHeader *>(memory);
+	VolumeRecord * const records = reinterpret_cast<VolumeRecord *>(header + 1);
+
+	size_t const count = std::min(_items.size(), (size - sizeof(VolumeBufferHeader)) / sizeof(VolumeRecord));
+	for (size_t i = 0; i < count; ++i)
+	{
+		SpatialIndex::Item const & item = _items[i];
+		VolumeRecord & record = records[i];
+		record.key = (int64_t)item.shell.GetInstanceID();
+		record.include = item.includes.empty() ? 0 : (int64_t)item.includes.front().GetInstanceID();
+		record.component = component && _canvas.Type() != HPS::Type::None ? component(SpatialIndex::keyPath(item, _canvas)) : 0;
+	}
+
+	header->count = (int32_t)count;
+	header->total = (int32_t)_items.size();
+	header->reserved[0] = 0;
+	header->reserved[1] = 0;
+	return (int)count;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "hps.h"
+#include "sprk.h"
+#include "SpatialIndex.h"
+
+#include <functional>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class HighlightBatch;
+
+// VolumeQuery finds the shell instances in a world space box or in the part of the view
+//  inside a window rectangle, and keeps them as the current set for bulk operations: hiding
+//  everything else, highlighting them, or handing them to the gui in one block.
+//
+// The spatial index answers on its own for items whose box lies inside the volume, or
+//  outside it.  For a box, the items whose box crosses its boundary can be checked against
+//  their geometry with one SelectByVolume over the model; a frustum has no HPS volume
+//  selection, so it keeps them (or drops them when the items must be contained).
+//
+// The set travels to the gui laid out as below, in native byte order, and mirrored by the
+//  VOLUME_* constants in AndroidMobileSurfaceView.java:
+//   VolumeBufferHeader
+//   VolumeRecord[header.count]
+// Records are written while they fit; header.total tells how many items the set holds.
+
+struct VolumeBufferHeader
+{
+	int32_t			count;			// Records written
+	int32_t			total;			// Items in the set
+	int32_t			reserved[2];
+};
+
+struct VolumeRecord
+{
+	int64_t			key;			// HPS::Key::GetInstanceID() of the shell
+	int64_t			include;		// Innermost include leading to it, 0 if none
+	int64_t			component;		// Identifies the owning component, 0 if unknown
+};
+
+static_assert(sizeof(VolumeBufferHeader) == 16, "VolumeBufferHeader layout must match AndroidMobileSurfaceView.VOLUME_HEADER_BYTES");
+static_assert(sizeof(VolumeRecord) == 24, "VolumeRecord layout must match AndroidMobileSurfaceView.VOLUME_RECORD_BYTES");
+static_assert(offsetof(VolumeRecord, include) == 8 && offsetof(VolumeRecord, component) == 16,
+	"VolumeRecord layout must match AndroidMobileSurfaceView.VOLUME_* offsets");
+
+class VolumeQuery
+{
+public:
+	static const char * const	HIDDEN_STYLE_NAME;
+
+	// Returns the component id of an item, given its full key path
+	typedef std::function<int64_t(HPS::KeyPath const &)>	ComponentResolver;
+
+	VolumeQuery(SpatialIndex const & index);
+	~VolumeQuery();
+
+	// Defines the hidden style in the window's portfolios.  Does nothing when already attached.
+	void			attach(HPS::Canvas const & canvas);
+	void			detach();
+
+	// Replaces the set with the items in a world space box: those entirely inside it when
+	//  'contained', otherwise those touching it.  'exact' checks the geometry of items whose box
+	//  crosses the boundary.  Returns the size of the set, -1 if the model is not indexed yet.
+	int				box(HPS::Point const & min, HPS::Point const & max, bool contained, bool exact);
+
+	// Same for what the front view shows inside a window space rectangle, from the boxes only
+	int				frustum(HPS::WindowPoint const & min, HPS::WindowPoint const & max, bool contained);
+
+	// Forgets the set, for a new model
+	void			clear();
+
+	size_t			size() const;
+
+	// Hides every indexed item outside the set, replacing what was hidden before.  A segment
+	//  with no item in the set is hidden whole, with its other geometry.  Returns the number of
+	//  items hidden.  The caller updates.
+	size_t			hideOutside();
+
+	// Shows again what hideOutside() hid.  The caller updates.
+	void			showAll();
+
+	void			addTo(HighlightBatch & batch, int style) const;
+
+	// Writes the set into 'memory'.  Returns the number of records written, or -1 if the memory
+	//  cannot hold the header.
+	int				write(void * memory, size_t size, ComponentResolver const & component = nullptr) const;
+
+private:
+	VolumeQuery(VolumeQuery const &);
+	void operator=(VolumeQuery const &);
+
+	int				assign(std::vector<SpatialIndex::Item> & inside, std::vector<SpatialIndex::Item> & crossing, bool keepCrossing);
+	HPS::HighlightOptionsKit	hiddenOptions() const;
+
+	SpatialIndex const &		_index;
+
+	// Guards everything below
+	mutable std::mutex			_mutex;
+	HPS::Canvas					_canvas;
+	HPS::PortfolioKey			_portfolio;
+	HPS::SegmentKey				_style;
+	std::vector<SpatialIndex::Item>	_items;
+};
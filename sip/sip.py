@@ -38,9 +38,26 @@ JTYPES = {
     'double': ('D', 'jdouble', 'double', 'D', 'DoubleArray'),
     'const char *': ('Ljava/lang/String;', 'jstring', 'String', 'S', 'NA'),
     'char *': ('Ljava/lang/StringBuffer;', 'jobject', 'StringBuffer', 'SB', 'NA'),
-    'char': ('B', 'jbyte', 'byte', 'B', 'ByteArray')
+    'char': ('B', 'jbyte', 'byte', 'B', 'ByteArray'),
+    'DirectBuffer': ('Ljava/nio/ByteBuffer;', 'jobject', 'ByteBuffer', 'BB', 'NA')
     }
 
+# Types which can be recorded in a command buffer
+BATCH_TYPES = {
+    #type: (JNIHelpers::CommandReader method, CommandBuffer.java put method)
+    'bool': ('readBool', 'putBoolean'),
+    'char': ('readByte', 'putByte'),
+    'int': ('readInt', 'putInt'),
+    'long long': ('readLong', 'putLong'),
+    'float': ('readFloat', 'putFloat'),
+    'double': ('readDouble', 'putDouble'),
+    'const char *': ('readString', 'putString')
+    }
+
+# Types an async action can take: their values are copied before the call returns to Java
+ASYNC_TYPES = ('bool', 'char', 'int', 'long long', 'float', 'double', 'const char *')
+ASYNC_ARRAY_TYPES = ('char', 'int', 'long long', 'float', 'double')
+
 # ------------------------------------
 
 def getTemplate(fn):
@@ -53,17 +70,20 @@ def getTemplate(fn):
 
 class Param:
     def __init__(self, rawParam):
-        reConstArray = re.compile(r'const\s*(.*?)\s*(\w+)\[\]\s*$')
-        reArray      = re.compile(r'\s*(.*?)\s*(\w+)\[\]\s*$')
+        reConstArray = re.compile(r'\s*const\s+(.*?)\s*(\w+)\[([^\]]*)\]\s*$')
+        reArray      = re.compile(r'\s*(.*?)\s*(\w+)\[([^\]]*)\]\s*$')
         reRest       = re.compile(r'\s*(.*?)\s*(\w+?)\s*$')
 
         reInString   = re.compile(r'\s*const\s+char\s*\*')
         reOutString  = re.compile(r'\s*char\s*\*')
 
+        # Arrays may give the number of elements the action reads or writes, e.g. 'float stats[Count]'
+        self.minLength = None
+
         # try const array
         m = reConstArray.match(rawParam)
         if m:
-            self.ctype, self.name = m.groups()
+            self.ctype, self.name, self.minLength = m.groups()
             self.isConst = True
             self.isArray = True
 
@@ -71,10 +91,13 @@ class Param:
         if not m:
             m = reArray.match(rawParam)
             if m:
-                self.ctype, self.name = m.groups()
+                self.ctype, self.name, self.minLength = m.groups()
                 self.isConst = False
                 self.isArray = True
 
+        if not self.minLength:
+            self.minLength = None
+
         # rest
         # handles 'const char *name'
         if not m:
@@ -101,12 +124,18 @@ class Param:
 
 class Method:
     def __init__(self, rawMethod, prefix):
-        p = prefix + r'\s+(.+?)\s*(\w+)\s*\(\s*(.*?)\s*\)\s*;'
+        p = prefix + r'(_CRITICAL|_ASYNC)?\s+(.+?)\s*(\w+)\s*\(\s*(.*?)\s*\)\s*;'
         m = re.match(p, rawMethod)
         if not m:
             raise Exception('Error parsing method: ' + rawMethod)
 
-        ret, name, params = m.groups()
+        kind, ret, name, params = m.groups()
+
+        # *_ACTION_CRITICAL methods run on the calling thread, their arrays pinned with GetPrimitiveArrayCritical
+        self.isCritical = kind == '_CRITICAL'
+
+        # *_ACTION_ASYNC methods only get their <name>Async variant, so the gui never waits on them
+        self.isAsyncOnly = kind == '_ASYNC'
 
         self.cRet = ret
         self.jniRet = JTYPES[ret][1]
@@ -133,6 +162,20 @@ class Method:
         else:
             self.overloadName = self.name + 'V'
 
+        # Actions with no result to hand back can be recorded in a command buffer
+        self.isBatchable = self.cRet == 'void' and all(
+            not p.isArray and p.ctype in BATCH_TYPES for p in (self.params or []))
+
+        # Actions taking only inputs also get an <name>Async variant run on the action executor
+        self.isAsync = all(
+            (p.isArray and p.isConst and p.ctype in ASYNC_ARRAY_TYPES) or
+            (not p.isArray and p.ctype in ASYNC_TYPES) for p in (self.params or []))
+
+        if self.isAsyncOnly:
+            if not self.isAsync:
+                raise Exception('Error: ' + name + ' takes parameters an asynchronous action cannot have')
+            self.isBatchable = False
+
 class Actions:
     def __init__(self, filename, prefix):
         lines = None
@@ -146,6 +189,9 @@ class Actions:
 
         self.methods = [Method(line, prefix) for line in lines]
 
+        # Opcodes are the index in this list, shared by the generated Java and JNI code
+        self.commands = [method for method in self.methods if method.isBatchable]
+
     def emit(self, className, package, jni, java_src, jpath, header, needsPtrArg):
         emitJNI(self, className, jni, 'tpl-actionsJNI.cpp.txt', jpath, header, needsPtrArg)
         emitJava(self, className, java_src, package, 'tpl-'+className+'.java.txt', needsPtrArg)
@@ -157,18 +203,54 @@ def buildJNIFunc(method, needsPtrArg):
     header = ''
     args = ''
 
+    jret = method.jniRet
+    rtemp = ''
+    rdecl = ''
+    rassign = ''
+    sret = ''
+    invalid = 'return;'
+    tooShort = 'return;'
+    if method.cRet != 'void':
+        sret = 'return ret;'
+        rtemp = '{} ret = '.format(jret)
+        rdecl = '{} ret = 0;'.format(jret)
+        rassign = 'ret = '
+        invalid = 'return 0;'
+        tooShort = 'return 0;' if method.cRet in ('bool', 'char') else 'return -1;'
+
     if method.params:
         params = []
+        checks = []
         header = []
+        criticalHeader = []
         args = []
         for param in method.params:
             params.append('{} {}'.format(param.jnitype, param.name))
 
-            if param.isArray:
-                f = 'JNIHelpers::{0} {1}_arr(env, {1});'
-                header.append(f.format(param.arrayName, param.name))
+            # Sized arrays are checked before anything is pinned
+            if param.isArray and param.minLength:
+                f = 'if ({0} == nullptr || env->GetArrayLength({0}) < ({1}))\n\t\t{2}'
+                checks.append(f.format(param.name, param.minLength, tooShort))
+
+            # const arrays are read-only: released with JNI_ABORT, without copy-back
+            readOnly = ', true' if param.isConst else ''
+
+            if param.isArray and method.isCritical:
+                # Pinned last (and released first) so no other JNI call happens while they are held
+                f = 'JNIHelpers::CriticalArray<{0}, {1}> {2}_arr(env, {2}{3});'
+                criticalHeader.append(f.format(param.ctype, param.jnitype, param.name, readOnly))
                 args.append('{}_arr.arr()'.format(param.name))
 
+            elif param.isArray:
+                f = 'JNIHelpers::{0} {1}_arr(env, {1}{2});'
+                header.append(f.format(param.arrayName, param.name, readOnly))
+                args.append('{}_arr.arr()'.format(param.name))
+
+            elif param.jtype == 'ByteBuffer':
+                f = 'JNIHelpers::ByteBuffer {0}_buf(env, {0});'
+                header.append(f.format(param.name))
+                args.append('{}_buf.buffer()'.format(param.name))
+
             elif param.jtype == 'String':
                 f = 'JNIHelpers::String c{0}(env, {0});'
                 header.append(f.format(param.name))
@@ -182,28 +264,122 @@ def buildJNIFunc(method, needsPtrArg):
             else:
                 args.append(param.name)
 
-        header = '\n'.join(header)
+        header = '\n\t'.join(checks + header + criticalHeader)
         args = ', '.join(args)
         sparams = ', ' + ', '.join(params)
 
-    jret = method.jniRet
-    rtemp = ''
-    sret = ''
-    if method.cRet != 'void':
-        sret = 'return ret;'
-        rtemp = '{} ret ='.format(jret)
-
     d = {'jret': jret, 'name': method.name, 'params': sparams,
          'overloadName': method.overloadName,
-         'header': header, 'return': sret, 'rtemp': rtemp,
+         'header': header, 'return': sret, 'rtemp': rtemp, 'rdecl': rdecl, 'rassign': rassign, 'invalid': invalid,
          'args': args, 'className': 'alkdj'
         }
     tplName = 'tpl-jnifunction-static.cpp.txt'
     if needsPtrArg:
-        tplName = 'tpl-jnifunction.cpp.txt'
+        # Critical actions never cross the action executor: nothing may block while arrays are pinned
+        tplName = 'tpl-jnifunction-critical.cpp.txt' if method.isCritical else 'tpl-jnifunction.cpp.txt'
     tpl = getTemplate(tplName)
     return tpl.substitute(d)
 
+def buildJNIAsyncFunc(method):
+    sparams = ''
+    header = ''
+    args = ''
+
+    if method.params:
+        params = []
+        header = []
+        args = []
+        for param in method.params:
+            params.append('{} {}'.format(param.jnitype, param.name))
+
+            if param.isArray and param.minLength:
+                f = 'if ({0} == nullptr || env->GetArrayLength({0}) < ({1}))\n\t\treturn -1;'
+                header.append(f.format(param.name, param.minLength))
+
+            # The Java objects are only valid during this call, the action gets copies
+            if param.isArray:
+                f = ('JNIHelpers::{0} {1}_arr(env, {1}, true);\n'
+                     '\tstd::vector<{2}> {1}_copy({1}_arr.arr(), {1}_arr.arr() + env->GetArrayLength({1}));')
+                header.append(f.format(param.arrayName, param.name, param.ctype))
+                args.append('{}_copy.data()'.format(param.name))
+
+            elif param.jtype == 'String':
+                f = 'std::string {0}_copy(JNIHelpers::String(env, {0}).str());'
+                header.append(f.format(param.name))
+                args.append('{}_copy.c_str()'.format(param.name))
+
+            else:
+                args.append(param.name)
+
+        header = '\n\t'.join(header)
+        args = ', '.join(args)
+        sparams = ', ' + ', '.join(params)
+
+    call = 'surface->{}({});'.format(method.name, args)
+    if method.cRet == 'void':
+        call = call + '\n\t\treturn 0.0;'
+    elif method.cRet == 'bool':
+        call = 'return ' + call[:-1] + ' ? 1.0 : 0.0;'
+    else:
+        call = 'return (double)' + call
+
+    d = {'name': method.name, 'params': sparams,
+         'overloadName': method.overloadName,
+         'header': header, 'call': call
+        }
+    tpl = getTemplate('tpl-jnifunction-async.cpp.txt')
+    return tpl.substitute(d)
+
+def buildCommandCase(opcode, method):
+    reads = []
+    args = []
+    for param in (method.params or []):
+        readFunc = BATCH_TYPES[param.ctype][0]
+        if param.ctype == 'const char *':
+            reads.append('\t\t\t\tstd::string {} = in.{}();'.format(param.name, readFunc))
+            args.append('{}.c_str()'.format(param.name))
+        else:
+            reads.append('\t\t\t\t{} {} = in.{}();'.format(param.ctype, param.name, readFunc))
+            args.append(param.name)
+
+    lines = []
+    lines.append('\t\t\tcase {}:'.format(opcode))
+    lines.append('\t\t\t{')
+    lines.extend(reads)
+    if reads:
+        lines.append('\t\t\t\tif (in.ok())')
+        lines.append('\t\t\t\t\tsurface->{}({});'.format(method.name, ', '.join(args)))
+    else:
+        lines.append('\t\t\t\tsurface->{}();'.format(method.name))
+    lines.append('\t\t\t\tbreak;')
+    lines.append('\t\t\t}')
+    return '\n'.join(lines)
+
+def buildJNICommandFunc(actions):
+    cases = [buildCommandCase(opcode, method) for opcode, method in enumerate(actions.commands)]
+    tpl = getTemplate('tpl-executeCommands.cpp.txt')
+    return tpl.substitute({'cases': '\n'.join(cases)})
+
+def buildJavaCommandMethod(opcode, method):
+    sparams = ''
+    puts = []
+    if method.params:
+        sparams = ', '.join(['{} {}'.format(p.jtype, p.name) for p in method.params])
+        puts = ['\t\t\t{}({});'.format(BATCH_TYPES[p.ctype][1], p.name) for p in method.params]
+
+    lines = []
+    lines.append('\t\tpublic CommandBuffer {}({}) {{'.format(method.name, sparams))
+    lines.append('\t\t\tputCommand({});'.format(opcode))
+    lines.extend(puts)
+    lines.append('\t\t\treturn this;')
+    lines.append('\t\t}')
+    return '\n'.join(lines)
+
+def buildJavaCommandBuffer(actions):
+    methods = [buildJavaCommandMethod(opcode, method) for opcode, method in enumerate(actions.commands)]
+    tpl = getTemplate('tpl-commandBuffer.java.txt')
+    return tpl.substitute({'command_methods': '\n\n'.join(methods)})
+
 def buildJNIMethodSig(method, needsPtrArg):
     sret = method.jniSymbolRet
     if needsPtrArg:
@@ -225,6 +401,26 @@ def buildJNIMethodSig(method, needsPtrArg):
     tplstr = '\t\t{"$overloadName", "$sig", (void*)$overloadName},'
     tpl = string.Template(tplstr)
     return tpl.substitute(d)
+
+def buildJNIAsyncMethodSig(method):
+    stypes = ''.join([param.stype for param in (method.params or [])])
+    return '\t\t{{"{0}Async", "(J{1})I", (void*){0}Async}},'.format(method.overloadName, stypes)
+
+def buildNativeJavaAsyncMethodSeg(method):
+    fmt = lambda p: '{}[] {}' if p.isArray else '{} {}'
+    vparams = ['long ptr'] + [fmt(p).format(p.jtype, p.name) for p in (method.params or [])]
+    return '\tprivate static native int {}Async({});'.format(method.overloadName, ', '.join(vparams))
+
+def buildJavaAsyncMethod(method):
+    fmt = lambda p: '{}[] {}' if p.isArray else '{} {}'
+    vparams = [fmt(p).format(p.jtype, p.name) for p in (method.params or [])]
+    vargs = ['mSurfacePointer'] + [p.name for p in (method.params or [])]
+
+    d = {'name': method.name, 'params': ', '.join(vparams),
+         'overloadName': method.overloadName, 'args': ', '.join(vargs)
+        }
+    tpl = getTemplate('tpl-javaAsyncMethod.java.txt')
+    return tpl.substitute(d)
     
 def buildNativeJavaMethodSeg(method, needsPtrArg):
 
@@ -286,8 +482,21 @@ def emitJNI(actions, className, jni, jniTemplate, jpathDefine, includeFile, need
     jniMethodLines = []
 
     for method in actions.methods:
-        jniFuncLines.append(buildJNIFunc(method, needsPtrArg))
-        jniMethodLines.append(buildJNIMethodSig(method, needsPtrArg))
+        if method.isAsyncOnly and not needsPtrArg:
+            raise Exception('Error: ' + method.name + ' cannot be asynchronous without a surface')
+        if not method.isAsyncOnly:
+            jniFuncLines.append(buildJNIFunc(method, needsPtrArg))
+            jniMethodLines.append(buildJNIMethodSig(method, needsPtrArg))
+
+    # Surface actions can also run asynchronously, and be sent in batches through a command buffer
+    if needsPtrArg:
+        for method in actions.methods:
+            if method.isAsync:
+                jniFuncLines.append(buildJNIAsyncFunc(method))
+                jniMethodLines.append(buildJNIAsyncMethodSig(method))
+
+        jniFuncLines.append(buildJNICommandFunc(actions))
+        jniMethodLines.append('\t\t{"executeCommands", "(JLjava/nio/ByteBuffer;I)V", (void*)executeCommands},')
 
     jniFuncLines = '\n'.join(jniFuncLines)
     jniMethodLines = '\n'.join(jniMethodLines)
@@ -305,14 +514,25 @@ def emitJava(actions, className, java_src, packageName, javaTemplate, needsPtrAr
     javaMethodLines = []
 
     for method in actions.methods:
-        javaNativeMethodLines.append(buildNativeJavaMethodSeg(method, needsPtrArg))
-        javaMethodLines.append(buildJavaMethod(method, needsPtrArg))
+        if not method.isAsyncOnly:
+            javaNativeMethodLines.append(buildNativeJavaMethodSeg(method, needsPtrArg))
+            javaMethodLines.append(buildJavaMethod(method, needsPtrArg))
+
+    commandBuffer = ''
+    if needsPtrArg:
+        for method in actions.methods:
+            if method.isAsync:
+                javaNativeMethodLines.append(buildNativeJavaAsyncMethodSeg(method))
+                javaMethodLines.append(buildJavaAsyncMethod(method))
+
+        javaNativeMethodLines.append('\tprivate static native void executeCommands(long ptr, ByteBuffer commands, int size);')
+        commandBuffer = buildJavaCommandBuffer(actions)
 
     javaNativeMethodLines = '\n'.join(javaNativeMethodLines)
     javaMethodLines = '\n'.join(javaMethodLines)
 
     tpl = getTemplate(javaTemplate)
-    x = tpl.substitute({'className': className, 'package': packageName, 'native_methods': javaNativeMethodLines, 'methods': javaMethodLines})
+    x = tpl.substitute({'className': className, 'package': packageName, 'native_methods': javaNativeMethodLines, 'methods': javaMethodLines, 'command_buffer': commandBuffer})
     javaFile = join(java_src, className + '.java')
     with open(javaFile, 'w') as f:
         f.write(x)